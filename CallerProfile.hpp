@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cwchar>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RuleImage.hpp"
+#include "Transcode.hpp"
+
+// Who creates the fonts: the hook hands over a few return addresses and the requested
+// face per call, counts and GDI time add up per distinct (stack, face) in a fixed size
+// table without locks. Addresses are turned into module+offset only for the report.
+namespace callers {
+
+constexpr size_t STACK_DEPTH = 6;   // return addresses kept per call
+constexpr size_t TABLE_SIZE = 4096; // distinct (stack, face) pairs, a power of two
+constexpr size_t MAX_PROBES = 32;
+
+class Table
+{
+public:
+	explicit Table(size_t size = TABLE_SIZE) : mask(size - 1), slots(new slot[size]) {}
+	Table(const Table&) = delete;
+	Table& operator=(const Table&) = delete;
+
+	// Safe from any number of threads. False if the pair found no free slot, it is then only counted as dropped.
+	bool Record(const uintptr_t* frames, size_t depth, const wchar_t* face, uint64_t ns)
+	{
+		depth = std::min(depth, STACK_DEPTH);
+		size_t len = wcsnlen(face, FACE_SIZE - 1);
+		uint64_t key = Hash(frames, depth, face, len);
+		for (size_t probe = 0, i = key & mask; probe < MAX_PROBES; ++probe, i = (i + 1) & mask)
+		{
+			slot& s = slots[i];
+			uint64_t k = s.key.load(std::memory_order_acquire);
+			if (k == 0 && s.key.compare_exchange_strong(k, key, std::memory_order_acq_rel))
+			{
+				std::copy(frames, frames + depth, s.frames);
+				s.depth = static_cast<uint32_t>(depth);
+				std::copy(face, face + len, s.face);
+				s.face[len] = L'\0';
+				s.ready.store(true, std::memory_order_release);
+			}
+			else if (k != key)
+			{
+				continue;
+			}
+			// a 64 bit key stands for the pair, colliding pairs would share a slot
+			s.count.fetch_add(1, std::memory_order_relaxed);
+			s.ns.fetch_add(ns, std::memory_order_relaxed);
+			return true;
+		}
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Not safe against threads recording at the same time
+	void Reset()
+	{
+		for (size_t i = 0; i <= mask; ++i)
+		{
+			slot& s = slots[i];
+			s.ready.store(false, std::memory_order_relaxed);
+			s.count.store(0, std::memory_order_relaxed);
+			s.ns.store(0, std::memory_order_relaxed);
+			s.key.store(0, std::memory_order_release);
+		}
+		dropped.store(0, std::memory_order_relaxed);
+	}
+
+	struct entry
+	{
+		std::vector<uintptr_t> frames; // innermost first
+		std::wstring face;
+		uint64_t count, ns;
+	};
+
+	// The pairs recorded so far, a pair still being inserted is left out
+	std::vector<entry> Snapshot() const
+	{
+		std::vector<entry> out;
+		for (size_t i = 0; i <= mask; ++i)
+		{
+			const slot& s = slots[i];
+			if (!s.ready.load(std::memory_order_acquire)) continue;
+			out.push_back({ std::vector<uintptr_t>(s.frames, s.frames + s.depth), s.face,
+				s.count.load(std::memory_order_relaxed), s.ns.load(std::memory_order_relaxed) });
+		}
+		return out;
+	}
+
+	uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+	size_t Capacity() const { return mask + 1; }
+
+private:
+	struct slot
+	{
+		std::atomic<uint64_t> key{ 0 }; // 0 if free
+		std::atomic<bool> ready{ false }; // frames and face written
+		uint32_t depth = 0;
+		uintptr_t frames[STACK_DEPTH];
+		wchar_t face[FACE_SIZE];
+		std::atomic<uint64_t> count{ 0 };
+		std::atomic<uint64_t> ns{ 0 };
+	};
+
+	size_t mask;
+	std::unique_ptr<slot[]> slots;
+	std::atomic<uint64_t> dropped{ 0 };
+
+	// A word at a time, FNV-1a on bytes is most of the cost of a Record
+	static uint64_t Hash(const uintptr_t* frames, size_t depth, const wchar_t* face, size_t len)
+	{
+		uint64_t h = 14695981039346656037ull ^ depth;
+		auto mix = [&h](uint64_t v) {
+			h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+			h ^= h >> 29;
+		};
+		for (size_t i = 0; i < depth; ++i)
+			mix(frames[i]);
+		for (size_t i = 0; i < len; i += 4)
+		{
+			uint64_t v = 0;
+			for (size_t j = i; j < len && j < i + 4; ++j)
+				v = v << 16 | static_cast<uint16_t>(face[j]);
+			mix(v);
+		}
+		return h ? h : 1;
+	}
+};
+
+struct module
+{
+	std::string name; // file name, UTF-8
+	uintptr_t base;
+	size_t size;
+};
+
+// Address ranges of the loaded modules, filled by the platform before a report
+class ModuleMap
+{
+public:
+	void Add(std::string name, uintptr_t base, size_t size)
+	{
+		module m = { std::move(name), base, size };
+		auto at = std::upper_bound(modules.begin(), modules.end(), base, [](uintptr_t b, const module& x) { return b < x.base; });
+		modules.insert(at, std::move(m));
+	}
+
+	const module* Find(uintptr_t addr) const
+	{
+		auto at = std::upper_bound(modules.begin(), modules.end(), addr, [](uintptr_t a, const module& x) { return a < x.base; });
+		if (at == modules.begin()) return nullptr;
+		--at;
+		return addr - at->base < at->size ? &*at : nullptr;
+	}
+
+	// "name+0x1a2b", or the bare address outside every module
+	std::string Symbolize(uintptr_t addr) const
+	{
+		char buf[32];
+		if (auto m = Find(addr))
+		{
+			snprintf(buf, sizeof(buf), "+0x%llx", static_cast<unsigned long long>(addr - m->base));
+			return m->name + buf;
+		}
+		snprintf(buf, sizeof(buf), "0x%llx", static_cast<unsigned long long>(addr));
+		return buf;
+	}
+
+	size_t Size() const { return modules.size(); }
+
+private:
+	std::vector<module> modules; // by base
+};
+
+// One line of the report: a call site and the face asked for there
+struct site
+{
+	std::string caller; // module+offset of the first frame outside the skipped modules
+	std::wstring face;
+	uint64_t count = 0, ns = 0;
+	std::vector<uintptr_t> via; // the stack that created most of them
+	uint64_t viaCount = 0;
+};
+
+inline bool SameName(const std::string& a, const std::string& b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+		return tolower(static_cast<unsigned char>(x)) == tolower(static_cast<unsigned char>(y));
+	});
+}
+
+// Merges the table's stacks by call site and face, the sites creating the most fonts first.
+// Frames in `skip` (GDI itself, FontMod) are not a call site.
+inline std::vector<site> Rank(const Table& table, const ModuleMap& modules, const std::vector<std::string>& skip)
+{
+	std::map<std::pair<std::string, std::wstring>, site> merged;
+	for (auto& e : table.Snapshot())
+	{
+		std::string caller;
+		for (auto f : e.frames)
+		{
+			auto m = modules.Find(f);
+			if (m && std::any_of(skip.begin(), skip.end(), [&](const std::string& s) { return SameName(s, m->name); })) continue;
+			caller = modules.Symbolize(f);
+			break;
+		}
+		if (caller.empty()) caller = "?";
+
+		site& s = merged[{ caller, e.face }];
+		if (s.caller.empty())
+		{
+			s.caller = caller;
+			s.face = e.face;
+		}
+		s.count += e.count;
+		s.ns += e.ns;
+		if (e.count > s.viaCount)
+		{
+			s.via = e.frames;
+			s.viaCount = e.count;
+		}
+	}
+
+	std::vector<site> out;
+	for (auto& m : merged)
+		out.push_back(std::move(m.second));
+	std::stable_sort(out.begin(), out.end(), [](const site& a, const site& b) {
+		return a.count != b.count ? a.count > b.count : a.ns > b.ns;
+	});
+	return out;
+}
+
+inline std::string Report(const Table& table, const ModuleMap& modules, const std::vector<std::string>& skip, size_t top = 50)
+{
+	auto sites = Rank(table, modules, skip);
+	std::string out;
+	char line[96];
+	snprintf(line, sizeof(line), "%10s %12s  %-32s %s\n", "fonts", "GDI ms", "face", "caller < callers");
+	out += line;
+	for (size_t i = 0; i < sites.size() && i < top; ++i)
+	{
+		auto& s = sites[i];
+		std::string face;
+		Utf16ToUtf8(s.face, face);
+		snprintf(line, sizeof(line), "%10llu %12.3f  ", static_cast<unsigned long long>(s.count), s.ns / 1e6);
+		out += line;
+		out += "\"" + face + "\"";
+		out.append(face.size() + 2 < 32 ? 32 - face.size() - 2 : 0, ' ');
+		out += " " + s.caller;
+		// the rest of the heaviest stack, after the call site
+		bool after = false;
+		for (auto f : s.via)
+		{
+			std::string name = modules.Symbolize(f);
+			if (after) out += " < " + name;
+			else after = name == s.caller;
+		}
+		out += "\n";
+	}
+	if (sites.size() > top)
+		out += std::to_string(sites.size() - top) + " more call sites\n";
+	if (auto n = table.Dropped())
+		out += std::to_string(n) + " calls not recorded, table full\n";
+	return out;
+}
+
+} // namespace callers
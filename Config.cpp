@@ -0,0 +1,405 @@
+#include "Config.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "yaml-cpp/yaml.h"
+
+#include "Transcode.hpp"
+
+namespace fs = std::filesystem;
+
+namespace config {
+
+namespace {
+
+bool stol(const std::string& str, long& out)
+{
+	int& errno_ref = errno;
+	const char *ptr = str.c_str();
+	char *eptr;
+	errno_ref = 0;
+	out = strtol(ptr, &eptr, 10);
+
+	if (ptr == eptr)
+		return false;
+	if (errno_ref == ERANGE)
+		return false;
+	return true;
+}
+
+// LOGFONTW fields are 32 bit where long is not
+[[maybe_unused]] bool stol(const std::string& str, int& out)
+{
+	long value;
+	if (!stol(str, value))
+		return false;
+	out = static_cast<int>(value);
+	return true;
+}
+
+bool stoul(const std::string& str, unsigned long& out)
+{
+	int& errno_ref = errno;
+	const char *ptr = str.c_str();
+	char *eptr;
+	errno_ref = 0;
+	out = strtoul(ptr, &eptr, 10);
+
+	if (ptr == eptr)
+		return false;
+	if (errno_ref == ERANGE)
+		return false;
+	return true;
+}
+
+template <typename Key>
+YAML::Node FindNode(const YAML::Node& node, const Key& key)
+{
+	if (auto merge = node["<<"]; merge.IsDefined())
+	{
+		if (auto child = FindNode(merge, key); child.IsDefined())
+		{
+			return child;
+		}
+	}
+	return node[key];
+}
+
+} // namespace
+
+bool LoadSettings(std::istream& fin, std::string& errMsg, settings& result)
+{
+	bool ret = false; // TODO remove this unnecessary variable with boolean return
+	do {
+		YAML::Node config; // TODO promote this variable
+		try
+		{
+			config = YAML::Load(fin);
+		}
+		catch (const std::exception& e)
+		{
+			errMsg = std::string("YAML::Load error.\n") + e.what();
+			break;
+		}
+
+		if (!config.IsMap())
+		{
+			errMsg = "Root node is not a map.";
+			break;
+		}
+
+		auto& fontsMap = result.fonts;
+		auto& order = result.order;
+		if (auto node = FindNode(config, "fonts"); node && node.IsMap()) // TODO extract function GetMapChild: function<T (string)>
+		{
+			for (const auto& i : node)
+			{
+				if (i.first.IsScalar() && i.second.IsMap())
+				{
+					YAML::Node replace;
+					if (auto r = FindNode(i.second, "replace"); r && (r.IsScalar() || r.IsSequence()))
+					{
+						replace = r;
+					}
+					else
+					{
+						replace = FindNode(i.second, "name");
+					}
+					// a list is a fallback chain, the first installed candidate is used
+					std::vector<std::wstring> candidates;
+					if (replace && replace.IsSequence())
+					{
+						for (const auto& c : replace)
+						{
+							std::wstring candidate;
+							if (c.IsScalar() && Utf8ToUtf16(c.as<std::string>(), candidate) && !candidate.empty())
+								candidates.push_back(candidate.substr(0, FACE_SIZE - 1));
+						}
+					}
+					if ((replace && replace.IsScalar()) || !candidates.empty())
+					{
+						font fontInfo = {};
+						std::wstring replaceName;
+						if (candidates.empty())
+							Utf8ToUtf16(replace.as<std::string>(), replaceName);
+						else
+							replaceName = candidates.front();
+						replaceName.copy(fontInfo.replace, FACE_SIZE - 1);
+						fontInfo.overrideFlags = _NONE;
+
+						if (auto node = FindNode(i.second, "size"); node && node.IsScalar())
+						{
+							if (stol(node.as<std::string>(), fontInfo.height))
+								fontInfo.overrideFlags |= _HEIGHT;
+						}
+
+						if (auto node = FindNode(i.second, "width"); node && node.IsScalar())
+						{
+							if (stol(node.as<std::string>(), fontInfo.width))
+								fontInfo.overrideFlags |= _WIDTH;
+						}
+
+						if (auto node = FindNode(i.second, "weight"); node && node.IsScalar())
+						{
+							if (stol(node.as<std::string>(), fontInfo.weight))
+								fontInfo.overrideFlags |= _WEIGHT;
+						}
+
+						if (auto node = FindNode(i.second, "italic"); node && node.IsScalar())
+						{
+							fontInfo.overrideFlags |= _ITALIC;
+							fontInfo.italic = node.as<bool>();
+						}
+
+						if (auto node = FindNode(i.second, "underLine"); node && node.IsScalar())
+						{
+							fontInfo.overrideFlags |= _UNDERLINE;
+							fontInfo.underLine = node.as<bool>();
+						}
+
+						if (auto node = FindNode(i.second, "strikeOut"); node && node.IsScalar())
+						{
+							fontInfo.overrideFlags |= _STRIKEOUT;
+							fontInfo.strikeOut = node.as<bool>();
+						}
+
+						if (auto node = FindNode(i.second, "charSet"); node && node.IsScalar())
+						{
+							unsigned long out;
+							if (stoul(node.as<std::string>(), out))
+							{
+								fontInfo.overrideFlags |= _CHARSET;
+								fontInfo.charSet = static_cast<uint8_t>(out);
+							}
+						}
+
+						if (auto node = FindNode(i.second, "outPrecision"); node && node.IsScalar())
+						{
+							unsigned long out;
+							if (stoul(node.as<std::string>(), out))
+							{
+								fontInfo.overrideFlags |= _OUTPRECISION;
+								fontInfo.outPrecision = static_cast<uint8_t>(out);
+							}
+						}
+
+						if (auto node = FindNode(i.second, "clipPrecision"); node && node.IsScalar())
+						{
+							unsigned long out;
+							if (stoul(node.as<std::string>(), out))
+							{
+								fontInfo.overrideFlags |= _CLIPPRECISION;
+								fontInfo.clipPrecision = static_cast<uint8_t>(out);
+							}
+						}
+
+						if (auto node = FindNode(i.second, "quality"); node && node.IsScalar())
+						{
+							unsigned long out;
+							if (stoul(node.as<std::string>(), out))
+							{
+								fontInfo.overrideFlags |= _QUALITY;
+								fontInfo.quality = static_cast<uint8_t>(out);
+							}
+						}
+
+						if (auto node = FindNode(i.second, "pitchAndFamily"); node && node.IsScalar())
+						{
+							unsigned long out;
+							if (stoul(node.as<std::string>(), out))
+							{
+								fontInfo.overrideFlags |= _PITCHANDFAMILY;
+								fontInfo.pitchAndFamily = static_cast<uint8_t>(out);
+							}
+						}
+
+						std::wstring find;
+						Utf8ToUtf16(i.first.as<std::string>(), find);
+						if (fontsMap.find(find) == fontsMap.end())
+							order.push_back(find);
+						fontsMap[find] = fontInfo;
+						if (candidates.size() > 1)
+							result.chains[find] = candidates;
+						else
+							result.chains.erase(find);
+					}
+				}
+			}
+		}
+
+		auto& fixGSOFont = result.fixGSOFont;
+		auto& userGSOFont = result.userGSOFont;
+		if (auto node = FindNode(config, "fixGSOFont"); node)
+		{
+			if (node.IsScalar())
+			{
+				if (node.as<bool>())
+					fixGSOFont = USE_NCM_FONT;
+			}
+			else if (node.IsMap())
+			{
+				YAML::Node name;
+				if (auto r = FindNode(node, "replace"); r && r.IsScalar())
+				{
+					name = r;
+				}
+				else if (r && r.IsSequence() && r.size())
+				{
+					name = r[0]; // stock fonts are created once, a chain is not resolved
+				}
+				else
+				{
+					name = FindNode(node, "name");
+				}
+				if (name && name.IsScalar())
+				{
+					fixGSOFont = USE_USER_FONT;
+
+					std::wstring faceName;
+					Utf8ToUtf16(name.as<std::string>(), faceName);
+					faceName.copy(userGSOFont.lfFaceName, LF_FACESIZE - 1);
+
+					if (auto n = FindNode(node, "size"); n && n.IsScalar())
+					{
+						stol(n.as<std::string>(), userGSOFont.lfHeight);
+					}
+
+					if (auto n = FindNode(node, "width"); n && n.IsScalar())
+					{
+						stol(n.as<std::string>(), userGSOFont.lfWidth);
+					}
+
+					if (auto n = FindNode(node, "weight"); n && n.IsScalar())
+					{
+						stol(n.as<std::string>(), userGSOFont.lfWeight);
+					}
+
+					if (auto n = FindNode(node, "italic"); n && n.IsScalar())
+					{
+						userGSOFont.lfItalic = n.as<bool>();
+					}
+
+					if (auto n = FindNode(node, "underLine"); n && n.IsScalar())
+					{
+						userGSOFont.lfUnderline = n.as<bool>();
+					}
+
+					if (auto n = FindNode(node, "strikeOut"); n && n.IsScalar())
+					{
+						userGSOFont.lfStrikeOut = n.as<bool>();
+					}
+
+					if (auto n = FindNode(node, "charSet"); n && n.IsScalar())
+					{
+						unsigned long out;
+						stoul(n.as<std::string>(), out);
+						userGSOFont.lfCharSet = static_cast<uint8_t>(out);
+					}
+
+					if (auto n = FindNode(node, "outPrecision"); n && n.IsScalar())
+					{
+						unsigned long out;
+						stoul(n.as<std::string>(), out);
+						userGSOFont.lfOutPrecision = static_cast<uint8_t>(out);
+					}
+
+					if (auto n = FindNode(node, "clipPrecision"); n && n.IsScalar())
+					{
+						unsigned long out;
+						stoul(n.as<std::string>(), out);
+						userGSOFont.lfClipPrecision = static_cast<uint8_t>(out);
+					}
+
+					if (auto n = FindNode(node, "quality"); n && n.IsScalar())
+					{
+						unsigned long out;
+						stoul(n.as<std::string>(), out);
+						userGSOFont.lfQuality = static_cast<uint8_t>(out);
+					}
+
+					if (auto n = FindNode(node, "pitchAndFamily"); n && n.IsScalar())
+					{
+						unsigned long out;
+						stoul(n.as<std::string>(), out);
+						userGSOFont.lfPitchAndFamily = static_cast<uint8_t>(out);
+					}
+				}
+			}
+		} // TODO extract duplicate logics
+
+		auto& opts = result.opts;
+		if (auto node = FindNode(config, "debug"); node)
+		{
+			if (node.IsScalar())
+			{
+				opts.debug = node.as<bool>();
+			}
+			else if (node.IsMap())
+			{
+				opts.debug = true;
+				unsigned long out;
+				if (auto n = FindNode(node, "size"); n && n.IsScalar() && stoul(n.as<std::string>(), out) && out)
+					opts.logSegmentSize = static_cast<size_t>(out) * 1024;
+				if (auto n = FindNode(node, "generations"); n && n.IsScalar() && stoul(n.as<std::string>(), out) && out)
+					opts.logGenerations = static_cast<unsigned>(out);
+			}
+		}
+
+		if (auto node = FindNode(config, "introspect"); node && node.IsScalar())
+			opts.introspect = node.as<bool>();
+
+		if (auto node = FindNode(config, "traceStartup"); node && node.IsScalar())
+			opts.traceStartup = node.as<bool>();
+
+		if (auto node = FindNode(config, "prewarm"); node && node.IsScalar())
+		{
+			if (node.as<std::string>() == "select")
+				opts.prewarm = PREWARM_SELECT;
+			else if (node.as<bool>(false))
+				opts.prewarm = PREWARM_CREATE;
+		}
+
+		if (auto node = FindNode(config, "cacheMetrics"); node && node.IsScalar())
+			opts.cacheMetrics = node.as<bool>();
+
+		if (auto node = FindNode(config, "cacheEnum"); node && node.IsScalar())
+			opts.cacheEnum = node.as<bool>();
+
+		if (auto node = FindNode(config, "watchFonts"); node && node.IsScalar())
+			opts.watchFonts = node.as<bool>();
+
+		if (auto node = FindNode(config, "profileRules"); node && node.IsScalar())
+			opts.profileRules = node.as<bool>();
+
+		if (auto node = FindNode(config, "profileCallers"); node && node.IsScalar())
+			opts.profileCallers = node.as<bool>();
+
+		ret = true;
+	} while (0);
+	return ret;
+}
+
+bool LoadSettings(const fs::path& fileName, std::string& errMsg, settings& result)
+{
+	std::ifstream fin(fileName);
+	if (!fin)
+	{
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 4996) // 'strerror': This function or variable may be unsafe.
+#endif
+		errMsg = "Can not open " + fileName.filename().u8string() + ".\n" + strerror(errno);
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+		return false;
+	}
+	return LoadSettings(fin, errMsg, result);
+}
+
+
+} // namespace config
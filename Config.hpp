@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "LogFont.hpp"
+#include "RuleImage.hpp"
+
+// FontMod.yaml loader, shared by the DLL and the native tools.
+namespace config {
+
+// Switches read from the config besides the rules
+struct options
+{
+	bool debug = false;
+	bool introspect = false;
+	bool traceStartup = false;
+	PrewarmMode prewarm = PREWARM_OFF;
+	bool cacheMetrics = false;
+	bool cacheEnum = false;
+	bool watchFonts = false;
+	bool profileRules = false;
+	bool profileCallers = false;
+	size_t logSegmentSize = 0; // bytes, 0 keeps the default
+	unsigned logGenerations = 0;
+};
+
+struct settings
+{
+	std::vector<std::wstring> order; // rule keys in config order
+	std::unordered_map<std::wstring, font> fonts;
+	std::unordered_map<std::wstring, std::vector<std::wstring>> chains; // rule key to `replace` candidates, for lists of two or more
+	GSOFontMode fixGSOFont = DISABLED;
+	LOGFONTW userGSOFont = {};
+	options opts;
+};
+
+// False with a UTF-8 message in `errMsg` if the config can not be read
+bool LoadSettings(const std::filesystem::path& fileName, std::string& errMsg, settings& out);
+bool LoadSettings(std::istream& in, std::string& errMsg, settings& out);
+
+} // namespace config
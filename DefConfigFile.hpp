@@ -31,4 +31,5 @@ const char defConfigFile[] = ""
 "\r\n"
 "fixGSOFont: true # true is to use system UI font\r\n"
 "#fixGSOFont: *zh-cn-font # Or replace with user defined font\r\n"
-"debug: false\r\n";
+"debug: false\r\n"
+"#debug: { size: 1024, generations: 3 } # Or log with segment size in KiB and number of kept files\r\n";
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "RuleImage.hpp"
+
+// Font enumeration results kept in FontMod.enumcache across runs. Each query (charset,
+// pitch and family, face) maps to the records the enumeration callback was called with,
+// in order. The file only counts for the font set it was written with: a fingerprint of
+// the installed and the user fonts is stored with it, and a different one drops it.
+// Results listing fonts outside the fingerprint are kept for the run only and never saved.
+namespace enumcache {
+
+constexpr uint32_t FILE_MAGIC = 0x43454D46; // "FMEC"
+constexpr uint32_t FILE_VERSION = 1;
+
+struct key
+{
+	uint32_t charSet;
+	uint32_t pitchAndFamily;
+	wchar_t face[FACE_SIZE]; // zero filled past the name
+
+	bool operator<(const key& other) const { return memcmp(this, &other, sizeof(key)) < 0; }
+};
+
+inline key MakeKey(uint8_t charSet, uint8_t pitchAndFamily, const wchar_t* face)
+{
+	key k = {};
+	k.charSet = charSet;
+	k.pitchAndFamily = pitchAndFamily;
+	for (size_t i = 0; i < FACE_SIZE - 1 && face[i]; ++i)
+		k.face[i] = face[i];
+	return k;
+}
+
+// FNV-1a over what the enumeration depends on, fed in a fixed order
+class Fingerprint
+{
+public:
+	void Add(const void* data, size_t size)
+	{
+		auto p = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+			h = (h ^ p[i]) * 1099511628211ull;
+	}
+
+	template <typename T>
+	void Add(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "hashed as bytes");
+		Add(&value, sizeof(value));
+	}
+
+	void Add(const std::wstring& s) { Add(s.data(), s.size() * sizeof(wchar_t)); Add(s.size()); }
+
+	uint64_t Value() const { return h; }
+
+private:
+	uint64_t h = 14695981039346656037ull;
+};
+
+// `Record` is what one callback is called with, stored as bytes
+template <typename Record>
+class Cache
+{
+	static_assert(std::is_trivially_copyable<Record>::value, "records are saved as bytes");
+
+public:
+	struct entry
+	{
+		std::vector<Record> records;
+		int emptyResult; // what the enumeration returned without calling back
+		bool persist;    // saved with the file
+	};
+	using found = std::shared_ptr<const entry>;
+
+	// Null if the query was not enumerated yet
+	found Find(const key& k) const
+	{
+		std::shared_lock<std::shared_mutex> hold(lock);
+		auto it = entries.find(k);
+		return it == entries.end() ? nullptr : it->second;
+	}
+
+	// Taken before enumerating, a Reset meanwhile makes Insert drop the result
+	uint64_t Generation() const
+	{
+		std::shared_lock<std::shared_mutex> hold(lock);
+		return generation;
+	}
+
+	// Returns the entry kept, a query enumerated by two threads at once keeps the first.
+	// A result enumerated before the last Reset is returned to its caller only.
+	found Insert(const key& k, std::vector<Record> records, int emptyResult, uint64_t since, bool persist = true)
+	{
+		auto e = std::make_shared<const entry>(entry{ std::move(records), emptyResult, persist });
+		std::unique_lock<std::shared_mutex> hold(lock);
+		if (since != generation) return e;
+		auto inserted = entries.emplace(k, std::move(e));
+		if (inserted.second && persist) ++changes;
+		return inserted.first->second;
+	}
+
+	// Starts over for the font set `fingerprint` stands for
+	void Reset(uint64_t fingerprint)
+	{
+		std::unique_lock<std::shared_mutex> hold(lock);
+		entries.clear();
+		print = fingerprint;
+		saved = changes;
+		++generation;
+	}
+
+	// False, and an empty cache for `fingerprint`, if the file is missing, damaged or for other fonts
+	bool Load(const std::filesystem::path& fileName, uint64_t fingerprint)
+	{
+		Reset(fingerprint);
+		std::ifstream in(fileName, std::ios::binary);
+		header h;
+		if (!in || !Read(in, h) || h.magic != FILE_MAGIC || h.version != FILE_VERSION ||
+			h.recordSize != sizeof(Record) || h.fingerprint != fingerprint)
+			return false;
+
+		std::map<key, found> loaded;
+		for (uint32_t q = 0; q < h.queries; ++q)
+		{
+			key k;
+			int32_t emptyResult;
+			uint32_t count;
+			if (!Read(in, k) || !Read(in, emptyResult) || !Read(in, count) || count > MAX_RECORDS) return false;
+			std::vector<Record> records(count);
+			if (count && !in.read(reinterpret_cast<char*>(records.data()), count * sizeof(Record))) return false;
+			loaded.emplace(k, std::make_shared<const entry>(entry{ std::move(records), emptyResult, true }));
+		}
+
+		std::unique_lock<std::shared_mutex> hold(lock);
+		entries.swap(loaded);
+		return true;
+	}
+
+	// Written to a temporary file first, a concurrent reader sees the old or the new cache.
+	// Queries added while saving leave the cache dirty for the next save.
+	bool Save(const std::filesystem::path& fileName) const
+	{
+		namespace fs = std::filesystem;
+		uint64_t written;
+		auto tmp = fileName;
+		tmp += "." + std::to_string(std::random_device()()) + ".tmp";
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			if (!out) return false;
+			std::shared_lock<std::shared_mutex> hold(lock);
+			written = changes;
+			auto persisted = std::count_if(entries.begin(), entries.end(), [](auto& ke) { return ke.second->persist; });
+			header h = { FILE_MAGIC, FILE_VERSION, sizeof(Record), static_cast<uint32_t>(persisted), print };
+			Write(out, h);
+			for (auto& [k, e] : entries)
+			{
+				if (!e->persist) continue;
+				int32_t emptyResult = e->emptyResult;
+				uint32_t count = static_cast<uint32_t>(e->records.size());
+				Write(out, k);
+				Write(out, emptyResult);
+				Write(out, count);
+				out.write(reinterpret_cast<const char*>(e->records.data()), count * sizeof(Record));
+			}
+			out.close();
+			if (!out)
+			{
+				std::error_code ec;
+				fs::remove(tmp, ec);
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		fs::rename(tmp, fileName, ec);
+		if (!ec)
+		{
+			std::unique_lock<std::shared_mutex> hold(lock);
+			saved = std::max(saved, written);
+			return true;
+		}
+		fs::remove(tmp, ec);
+		return false;
+	}
+
+	// Something was enumerated that the file does not have yet
+	bool Dirty() const
+	{
+		std::shared_lock<std::shared_mutex> hold(lock);
+		return changes != saved;
+	}
+
+	size_t Size() const
+	{
+		std::shared_lock<std::shared_mutex> hold(lock);
+		return entries.size();
+	}
+
+private:
+	static constexpr uint32_t MAX_RECORDS = 1u << 20; // per query, more means a damaged file
+
+	struct header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t recordSize;
+		uint32_t queries;
+		uint64_t fingerprint;
+	};
+
+	mutable std::shared_mutex lock; // readers replay from their own reference, never under the lock
+	std::map<key, found> entries;
+	uint64_t print = 0;
+	uint64_t generation = 0;   // Resets so far
+	uint64_t changes = 0;      // queries inserted to be saved
+	mutable uint64_t saved = 0; // of those, in the file
+
+	template <typename T>
+	static bool Read(std::istream& in, T& value) { return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value))); }
+
+	template <typename T>
+	static void Write(std::ostream& out, const T& value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+};
+
+// Calls `callback` with the records until it returns 0, the result is what EnumFontFamiliesExW returns
+template <typename Record, typename Callback>
+int Replay(const typename Cache<Record>::entry& e, Callback callback)
+{
+	int ret = e.emptyResult;
+	for (auto& r : e.records)
+	{
+		ret = callback(r);
+		if (!ret) break;
+	}
+	return ret;
+}
+
+} // namespace enumcache
@@ -1,459 +1,1274 @@
 ﻿#define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <windows.h>
+#include <tlhelp32.h>
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <chrono>
+#include <functional>
+#include <mutex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <string>
 #include <string_view>
 #include <fstream>
 #include <filesystem>
 namespace fs = std::filesystem;
 
-#include "yaml-cpp/yaml.h"
-
 #include "orig_winmm/winmm.hpp"
 #include "Util.hpp"
+#include "CallerProfile.hpp"
+#include "Config.hpp"
+#include "HookEngine.hpp"
+#include "HookPath.hpp"
+#include "Stats.hpp"
+#include "FontEnumCache.hpp"
+#include "FontPack.hpp"
+#include "FontWatch.hpp"
+#include "Introspect.hpp"
+#include "MappedLog.hpp"
+#include "MetricsCache.hpp"
+#include "RuleFilter.hpp"
+#include "RuleEngine.hpp"
+#include "RuleImage.hpp"
+#include "RuleProfile.hpp"
+#include "RuleStore.hpp"
+#include "StartupGraph.hpp"
+#include "StartupTrace.hpp"
+#include "Transcode.hpp"
+#ifdef FONTMOD_EMBEDDED_RULES // configured with FONTMOD_EMBED_CONFIG, generated into the build directory
+#include "EmbeddedRules.gen.hpp"
+#define EMBEDDED_RULES
+#endif
 #include "DefConfigFile.hpp"
 
-const char CONFIG_FILE[] = L"FontMod.yaml";
-const char LOG_FILE[] = L"FontMod.log";
+const wchar_t CONFIG_FILE[] = L"FontMod.yaml";
+const wchar_t LOG_FILE[] = L"FontMod.log";
+const wchar_t TRACE_FILE[] = L"FontMod.trace.json";
+const wchar_t PACK_FILE[] = L"fonts.pack";
+const wchar_t PROFILE_FILE[] = L"FontMod.profile";
+const wchar_t CALLERS_FILE[] = L"FontMod.callers.txt";
+const wchar_t ENUM_CACHE_FILE[] = L"FontMod.enumcache";
+
+decltype(&CreateFontIndirectExW) origCreateFontIndirectExW = nullptr;
+decltype(&CreateFontIndirectExW) origFullCreateFontIndirectExW = nullptr; // gdi32full's, since Windows 10
+decltype(&GetStockObject) origGetStockObject = nullptr;
+decltype(&GetTextMetricsW) origGetTextMetricsW = nullptr;
+decltype(&GetCharWidth32W) origGetCharWidth32W = nullptr;
+decltype(&GetCharABCWidthsW) origGetCharABCWidthsW = nullptr;
+decltype(&DeleteObject) origDeleteObject = nullptr;
+decltype(&EnumFontFamiliesExW) origEnumFontFamiliesExW = nullptr;
+decltype(&AddFontResourceExW) origAddFontResourceExW = nullptr;
+decltype(&AddFontMemResourceEx) origAddFontMemResourceEx = nullptr;
+decltype(&RemoveFontResourceExW) origRemoveFontResourceExW = nullptr;
+decltype(&ExitProcess) origExitProcess = nullptr;
+
+rules::Engine ruleEngine;
+bool useEmbedded = false; // rules compiled in, no FontMod.yaml present
+rules::Profile ruleProfile; // hits of earlier runs, saved with this run's by SaveRunData
+bool profiling = false;
+std::unique_ptr<callers::Table> callerTable; // only with profileCallers, written to CALLERS_FILE by SaveRunData
+
+std::atomic<logsink::MappedLog*> logFile{ nullptr }; // null while tracing is off
+logsink::MappedLog logSink; // stays mapped until detach once opened
+size_t logSegmentSize = logsink::DEFAULT_SEGMENT_SIZE;
+unsigned logGenerations = logsink::DEFAULT_GENERATIONS;
+fs::path modulePath;
+trace::Recorder startupTrace; // written to TRACE_FILE if traceStartup is set
+uint64_t startupCriticalUs = 0; // longest chain of dependent startup steps
+hook::TrampolineArena hookArena;
+stats::SharedSegment statsSegment;
+stats::instance localStats; // used when the shared segment is unavailable
+stats::instance* procStats = &localStats;
+introspect::LatencyHistogram rewriteLatency, createLatency;
+introspect::Endpoint endpoint;
+metrics::MetricsCache<HGDIOBJ, TEXTMETRICW, ABC> metricsCache; // by the HFONT selected into the DC
+
+struct userFont
+{
+	fs::path path;
+	int ret;
+};
+std::vector<userFont> userFonts;
+std::mutex userFontsLock; // the font watcher changes userFonts while introspection reads it
+pack::Reader fontPack;           // read by packFamilies, which installs one family at a time
+pack::LazyFamilies packFamilies; // of fontPack, not installed yet
+fontwatch::Registry* fontRegistry = nullptr; // with watchFonts, never freed: the module stays pinned
+fontwatch::Watcher* fontWatcher = nullptr;
+std::vector<HFONT> prewarmedFonts; // kept alive so GDI keeps the mapped fonts cached, the module is pinned
+
+void InstallPackFont(size_t i);
+
+// Installs the fonts.pack fonts of `face` before GDI looks for it, a single load once none is left.
+// Faces not in the pack, or installed already, are looked up without a lock or an allocation.
+void EnsurePackFamily(const WCHAR* face)
+{
+	if (!packFamilies.Pending()) return;
+	if (face[0] == L'@') ++face; // the vertical variant of the family
+	if (face[0])
+		packFamilies.Install(std::wstring_view(face, wcsnlen(face, LF_FACESIZE)), InstallPackFont);
+}
 
-using namespace bitflag;
+// Rewrites `lf` by the rule for its face, false if there is none
+template <bool Embedded>
+bool RewriteFont(LOGFONTW& lf)
+{
+#ifdef EMBEDDED_RULES
+	if constexpr (Embedded)
+	{
+		auto rule = embedded::Find(lf.lfFaceName, wcsnlen(lf.lfFaceName, LF_FACESIZE));
+		if (!rule) return false;
+		rules::ApplyRule(rule->image, lf);
+		return true;
+	}
+#endif
+	return ruleEngine.Rewrite(lf);
+}
 
-#pragma pack(push, 1)
-// 8-bit opcode, Immediate number machine word size address
-struct x86Ins8Iaddr
+// Copies what GDI reads of `from`: the design vector only holds dvNumAxes values,
+// callers may allocate just that much
+void CopyEnumLogFont(const ENUMLOGFONTEXDVW& from, ENUMLOGFONTEXDVW& to)
 {
-	uint8_t opcode;
-	size_t address;
-};
-#pragma pack(pop)
-
-size_t addrCreateFontIndirectW = 0;
-size_t addrGetStockObject = 0;
-
-// overrideflags
-const uint32_t _NONE   = 0;
-const uint32_t _HEIGHT = bitflagAt(1);
-const uint32_t _WIDTH  = bitflagAt(2);
-const uint32_t _WEIGHT = bitflagAt(3);
-const uint32_t _ITALIC = bitflagAt(4);
-const uint32_t _UNDERLINE = bitflagAt(5);
-const uint32_t _STRIKEOUT = bitflagAt(6);
-const uint32_t _CHARSET   = bitflagAt(7);
-const uint32_t _OUTPRECISION  = bitflagAt(8);
-const uint32_t _CLIPPRECISION = bitflagAt(9);
-const uint32_t _QUALITY = bitflagAt(10);
-const uint32_t _PITCHANDFAMILY = bitflagAt(11);
-
-struct font
-{
-	std::wstring replace;
-	uint32_t overrideFlags;
-	long height, width;
-	long weight;
-	bool italic, underLine, strikeOut;
-	BYTE charSet;
-	BYTE outPrecision, clipPrecision;
-	BYTE quality;
-	BYTE pitchAndFamily;
+	to.elfEnumLogfontEx = from.elfEnumLogfontEx;
+	to.elfDesignVector.dvReserved = from.elfDesignVector.dvReserved;
+	to.elfDesignVector.dvNumAxes = std::min<DWORD>(from.elfDesignVector.dvNumAxes, MM_MAX_NUMAXES);
+	memcpy(to.elfDesignVector.dvValues, from.elfDesignVector.dvValues, to.elfDesignVector.dvNumAxes * sizeof(LONG));
+}
+
+// CreateFontA/W and CreateFontIndirectA/W all end up here, A names already widened by GDI,
+// so every font is rewritten once whichever API the application uses. Since Windows 10 they call
+// gdi32full's CreateFontIndirectExW, hooked as well (Full), which gdi32's may call in turn:
+// the hook entered second on a thread passes the font on as it is.
+// One variant per feature set, DllMain installs the one the config asks for:
+// Embedded looks up the built-in rules, Logging may trace to FontMod.log (toggled at runtime by
+// introspection), Counting keeps the stats fontmod-top and introspection read, Timing fills the
+// latency histograms, Profiling adds the call and its GDI time to the caller profile.
+// With everything off the hook is the rule lookup and the call. The portable part is hookpath::Call.
+template <bool Embedded, bool Logging, bool Counting, bool Timing, bool Profiling, bool Full>
+HFONT WINAPI MyCreateFontIndirectExW(const ENUMLOGFONTEXDVW* lpelfe)
+{
+	const auto orig = Full ? origFullCreateFontIndirectExW : origCreateFontIndirectExW;
+	hookpath::Reentry reentry;
+	if (reentry.Nested()) return orig(lpelfe);
+	if constexpr (Counting) stats::Add(procStats->hookCalls);
+	if (!lpelfe) return orig(lpelfe);
+
+	// skipping this frame, the first one is where CreateFontIndirectExW was called from
+	uintptr_t frames[callers::STACK_DEPTH];
+	WORD depth = 0;
+	if constexpr (Profiling) depth = RtlCaptureStackBackTrace(1, callers::STACK_DEPTH, reinterpret_cast<PVOID*>(frames), nullptr);
+
+	const hookpath::shared s = { procStats, &logFile, &rewriteLatency, &createLatency, callerTable.get() };
+	return hookpath::Call<Logging, Counting, Timing, Profiling>(s, lpelfe->elfEnumLogfontEx.elfLogFont, frames, depth,
+		RewriteFont<Embedded>, [lpelfe, orig](const LOGFONTW& lf, bool hit) {
+			EnsurePackFamily(lf.lfFaceName);
+			if (!hit) return orig(lpelfe);
+			// the caller's struct is const, a rewritten font is passed on in a copy
+			ENUMLOGFONTEXDVW rewritten;
+			CopyEnumLogFont(*lpelfe, rewritten);
+			rewritten.elfEnumLogfontEx.elfLogFont = lf;
+			return orig(&rewritten);
+		});
+}
+
+using CreateFontIndirectExWHook = decltype(&CreateFontIndirectExW);
+
+template <size_t... Variant>
+constexpr std::array<CreateFontIndirectExWHook, sizeof...(Variant)> CreateFontHooks(std::index_sequence<Variant...>)
+{
+	return { &MyCreateFontIndirectExW<(Variant & 1) != 0, (Variant & 2) != 0, (Variant & 4) != 0, (Variant & 8) != 0, (Variant & 16) != 0, (Variant & 32) != 0>... };
+}
+
+CreateFontIndirectExWHook SelectCreateFontHook(bool full, bool embedded, bool logging, bool counting, bool timing, bool profiling)
+{
+	static constexpr auto hooks = CreateFontHooks(std::make_index_sequence<64>());
+#ifndef EMBEDDED_RULES
+	embedded = false; // both variants do the same
+#endif
+	return hooks[embedded | logging << 1 | counting << 2 | timing << 3 | profiling << 4 | full << 5];
+}
+
+// Creates a font FontMod chose itself as it is, the hooks pass it on
+HFONT CreateFontUnhooked(const LOGFONTW& lf)
+{
+	EnsurePackFamily(lf.lfFaceName);
+	ENUMLOGFONTEXDVW elf = {};
+	elf.elfEnumLogfontEx.elfLogFont = lf;
+	hookpath::Reentry bypass;
+	return CreateFontIndirectExW(&elf);
+}
+
+// Where the replacement of a stock font comes from
+enum stockSource : uint8_t
+{
+	STOCK_ORIGINAL, // not replaced
+	STOCK_GSO,      // the fixGSOFont font, shared by the proportional stock fonts
+	STOCK_RULES     // the stock font itself through the fonts: rules, so fixed pitch ones stay fixed
 };
 
-enum GSOFontMode {
-	DISABLED,
-	USE_NCM_FONT, // Use default font from SystemParametersInfo SPI_GETNONCLIENTMETRICS
-	USE_USER_FONT // Use user defined font
+struct stockFont
+{
+	stockSource source = STOCK_ORIGINAL;
+	std::once_flag created; // on the first GetStockObject asking for it
+	HGDIOBJ font = nullptr;
 };
 
-std::unordered_map<std::wstring, font> fontsMap;
-FILE *logFile = nullptr;
-HFONT newGSOFont = nullptr;
+std::array<stockFont, SYSTEM_FIXED_FONT + 1> stockFonts; // by stock object ID
+bool gsoReady = false;  // gsoLogFont holds the font to create
+LOGFONTW gsoLogFont = {}; // with USE_NCM_FONT the message font, read at startup
+std::once_flag gsoCreated;
+HFONT gsoFont = nullptr;
 
-__declspec(naked) HFONT WINAPI CallOrigCreateFontIndirectW(const LOGFONTW* lplf)
+// Creates the font GetStockObject hands out for the proportional stock fonts. Runs inside
+// call_once from the hook, so it must not call anything that may ask for a stock object again.
+void CreateGSOFont()
 {
-	_asm
+	// bypass the hook, the GSO font is used as configured
+	if (gsoReady)
+		gsoFont = CreateFontUnhooked(gsoLogFont);
+}
+
+HGDIOBJ CreateStockFont(int i)
+{
+	HGDIOBJ stock = origGetStockObject(i);
+	if (stockFonts[i].source == STOCK_GSO)
+	{
+		std::call_once(gsoCreated, CreateGSOFont);
+		return gsoFont ? gsoFont : stock;
+	}
+
+	// keeps the stock font's size and pitch unless the rule sets them
+	LOGFONTW lf;
+	if (!stock || !GetObjectW(stock, sizeof(lf), &lf) || !(useEmbedded ? RewriteFont<true>(lf) : RewriteFont<false>(lf)))
+		return stock;
+	HFONT font = CreateFontUnhooked(lf);
+	if (auto log = logFile.load())
 	{
-		mov edi, edi
-		push ebp
-		mov ebp, esp
-		jmp addrCreateFontIndirectW
+		std::string name;
+		Utf16ToUtf8(lf.lfFaceName, name);
+		log->Printf("[GetStockObject] stock font %d -> \"%s\"%s\n", i, name.c_str(), font ? "" : " failed");
 	}
+	return font ? font : stock;
 }
 
-__declspec(naked) HGDIOBJ WINAPI CallOrigGetStockObject(int i)
+HGDIOBJ WINAPI MyGetStockObject(int i)
 {
-	_asm
+	if (i >= 0 && static_cast<size_t>(i) < stockFonts.size() && stockFonts[i].source != STOCK_ORIGINAL)
 	{
-		mov edi, edi
-		push ebp
-		mov ebp, esp
-		jmp addrGetStockObject
+		stockFont& entry = stockFonts[i];
+		std::call_once(entry.created, [&entry, i] { entry.font = CreateStockFont(i); });
+		return entry.font;
 	}
+	return origGetStockObject(i);
 }
 
-const size_t SIZE_FN_PROLOG_OFFSET = 5;
+// The font selected into `dc` if its metrics are the same in every DC that can be cached.
+// That holds on display DCs in MM_TEXT without a world transform, where units are pixels.
+HGDIOBJ CachedFont(HDC dc)
+{
+	if (GetMapMode(dc) != MM_TEXT || GetGraphicsMode(dc) != GM_COMPATIBLE) return nullptr;
+	if (GetDeviceCaps(dc, TECHNOLOGY) != DT_RASDISPLAY) return nullptr;
+	return GetCurrentObject(dc, OBJ_FONT);
+}
 
-HFONT WINAPI MyCreateFontIndirectW(LOGFONTW* lplf)
+BOOL WINAPI MyGetTextMetricsW(HDC dc, LPTEXTMETRICW tm)
 {
-	if (logFile ISNULL) { goto callorig; }
-	std::string name;
-	if (Utf16ToUtf8(lplf->lfFaceName, name))
-	{
-		fprintf_s(logFile,
-			"[CreateFont] name = \"%s\", height = %d, "
-			"width = %d, escapement = %d, "
-			"orientation = %d, weight = %d, "
-			"italic = %s, underline = %s, "
-			"strikeout = %s, charset = %d, "
-			"outprecision = %d, clipprecision = %d, "
-			"quality = %d, pitchandfamily = %d\n",
-			name.c_str(), lplf->lfHeight,
-			lplf->lfWidth, lplf->lfEscapement,
-			lplf->lfOrientation, lplf->lfWeight,
-			bool_string(lplf->lfItalic), bool_string(lplf->lfUnderline),
-			bool_string(lplf->lfStrikeOut), lplf->lfCharSet,
-			lplf->lfOutPrecision, lplf->lfClipPrecision,
-			lplf->lfQuality, lplf->lfPitchAndFamily);
-	}
+	HGDIOBJ font = tm ? CachedFont(dc) : nullptr;
+	if (font ISNULL) return origGetTextMetricsW(dc, tm);
+	return metricsCache.TextMetricsFor(font, *tm, [dc](TEXTMETRICW& out) {
+		return origGetTextMetricsW(dc, &out) != FALSE;
+	});
+}
+
+BOOL WINAPI MyGetCharWidth32W(HDC dc, UINT first, UINT last, LPINT widths)
+{
+	HGDIOBJ font = widths ? CachedFont(dc) : nullptr;
+	if (font ISNULL) return origGetCharWidth32W(dc, first, last, widths);
+	return metricsCache.WidthsFor(font, first, last, widths, [dc](uint32_t from, uint32_t to, int* out) {
+		return origGetCharWidth32W(dc, from, to, out) != FALSE;
+	});
+}
+
+BOOL WINAPI MyGetCharABCWidthsW(HDC dc, UINT first, UINT last, LPABC widths)
+{
+	HGDIOBJ font = widths ? CachedFont(dc) : nullptr;
+	if (font ISNULL) return origGetCharABCWidthsW(dc, first, last, widths);
+	return metricsCache.AbcWidthsFor(font, first, last, widths, [dc](uint32_t from, uint32_t to, ABC* out) {
+		return origGetCharABCWidthsW(dc, from, to, out) != FALSE;
+	});
+}
 
-	auto it = fontsMap.find(lplf->lfFaceName);
-	if (it == fontsMap.end()) { goto callorig; }
+// Forgets a font before GDI can hand its handle out again
+BOOL WINAPI MyDeleteObject(HGDIOBJ obj)
+{
+	if (GetObjectType(obj) == OBJ_FONT)
+		metricsCache.Invalidate(obj);
+	return origDeleteObject(obj);
+}
 
-	size_t len = it->second.replace._Copy_s(lplf->lfFaceName, LF_FACESIZE, LF_FACESIZE);
-	lplf->lfFaceName[len] = L'\0';
+// What one EnumFontFamiliesExW callback is called with.
+// The design vector and axes of multiple master fonts are not kept.
+struct enumRecord
+{
+	ENUMLOGFONTEXW elf;
+	NEWTEXTMETRICEXW ntm;
+	DWORD type;
+};
 
-	auto flags = it->second.overrideFlags;
-	if (flags & _HEIGHT)
-		lplf->lfHeight = it->second.height;
-	if (flags & _WIDTH)
-		lplf->lfWidth = it->second.width;
-	if (flags & _WEIGHT)
-		lplf->lfWeight = it->second.weight;
-	if (flags & _ITALIC)
-		lplf->lfItalic = it->second.italic;
-	if (flags & _UNDERLINE)
-		lplf->lfUnderline = it->second.underLine;
-	if (flags & _STRIKEOUT)
-		lplf->lfStrikeOut = it->second.strikeOut;
-	if (flags & _CHARSET)
-		lplf->lfCharSet = it->second.charSet;
-	if (flags & _OUTPRECISION)
-		lplf->lfOutPrecision = it->second.outPrecision;
-	if (flags & _CLIPPRECISION)
-		lplf->lfClipPrecision = it->second.clipPrecision;
-	if (flags & _QUALITY)
-		lplf->lfQuality = it->second.quality;
-	if (flags & _PITCHANDFAMILY)
-		lplf->lfPitchAndFamily = it->second.pitchAndFamily;
+enumcache::Cache<enumRecord> enumCache; // saved to ENUM_CACHE_FILE by SaveRunData
+bool enumCaching = false; // cacheEnum, with EnumFontFamiliesExW hooked
+std::atomic<bool> appFonts{ false }; // the program registered fonts itself, enumerations are no longer saved
 
-callorig:
-	return CallOrigCreateFontIndirectW(lplf);
+int CALLBACK RecordEnumFont(const LOGFONTW* lf, const TEXTMETRICW* tm, DWORD type, LPARAM param)
+{
+	enumRecord r = {};
+	r.elf = *reinterpret_cast<const ENUMLOGFONTEXW*>(lf);
+	// only TrueType fonts come with a NEWTEXTMETRICEX, the others with a TEXTMETRIC
+	if (type & TRUETYPE_FONTTYPE)
+		r.ntm = *reinterpret_cast<const NEWTEXTMETRICEXW*>(tm);
+	else
+		memcpy(&r.ntm.ntmTm, tm, sizeof(TEXTMETRICW));
+	r.type = type;
+	reinterpret_cast<std::vector<enumRecord>*>(param)->push_back(r);
+	return 1;
 }
 
-HGDIOBJ WINAPI MyGetStockObject(int i)
+// A query is enumerated once in full, every call then replays it to the caller's callback.
+// Pack fonts are left alone: AddFontMemResourceEx fonts are never enumerated, installed or not.
+int WINAPI MyEnumFontFamiliesExW(HDC hdc, LPLOGFONTW lpLogfont, FONTENUMPROCW lpProc, LPARAM lParam, DWORD dwFlags)
 {
-	switch (i)
+	// printer and metafile DCs have fonts of their own
+	if (!lpLogfont || !lpProc || dwFlags || GetDeviceCaps(hdc, TECHNOLOGY) != DT_RASDISPLAY)
+		return origEnumFontFamiliesExW(hdc, lpLogfont, lpProc, lParam, dwFlags);
+
+	auto key = enumcache::MakeKey(lpLogfont->lfCharSet, lpLogfont->lfPitchAndFamily, lpLogfont->lfFaceName);
+	auto entry = enumCache.Find(key);
+	if (!entry)
 	{
-	case OEM_FIXED_FONT:
-	case SYSTEM_FONT:
-	case ANSI_FIXED_FONT:
-	case ANSI_VAR_FONT:
-	case SYSTEM_FIXED_FONT:
-	case DEVICE_DEFAULT_FONT:
-		return newGSOFont;
+		// fonts changing meanwhile reset the cache, this result then only goes to the caller
+		auto since = enumCache.Generation();
+		std::vector<enumRecord> records;
+		int emptyResult = origEnumFontFamiliesExW(hdc, lpLogfont, RecordEnumFont, reinterpret_cast<LPARAM>(&records), 0);
+		entry = enumCache.Insert(key, std::move(records), emptyResult, since, !appFonts);
 	}
-	return CallOrigGetStockObject(i);
+	// the callback may enumerate again, it runs on this thread's reference without a lock held
+	return enumcache::Replay<enumRecord>(*entry, [&](const enumRecord& r) {
+		return lpProc(&r.elf.elfLogFont, reinterpret_cast<const TEXTMETRICW*>(&r.ntm), r.type, lParam);
+	});
 }
 
-bool LoadSettings(HMODULE hModule, const fs::path& fileName, wchar_t* errMsg, GSOFontMode& fixGSOFont, LOGFONT& userGSOFont, bool& debug)
+// What ScanUserFonts found, registered by RegisterUserFonts
+struct userFontScan
+{
+	fs::path packPath;
+	bool packOpened = false;     // into fontPack
+	std::vector<fs::path> files; // fonts/
+	std::string error;
+};
+
+// Lists fonts/ and reads the index of fonts.pack. Needs no config and runs beside LoadSettings,
+// nothing is logged yet.
+void ScanUserFonts(const fs::path& path, userFontScan& scan)
 {
-	bool ret = false; // TODO remove this unnecessary variable with boolean return
-	std::ifstream fin(fileName);
-	if (fin) // TODO replace this with early return
+	try
 	{
-		do {
-			YAML::Node config; // TODO promote this variable
-			try
-			{
-				config = YAML::Load(fin);
-			}
-			catch (const std::exception& e)
-			{
-				swprintf(errMsg, 512, L"YAML::Load error.\n%hs", e.what());
-				break;
-			}
+		if (auto packPath = path / PACK_FILE; fs::exists(packPath))
+		{
+			scan.packPath = packPath;
+			startupTrace.Begin("OpenFontPack");
+			scan.packOpened = fontPack.Open(packPath);
+			startupTrace.End();
+		}
 
-			if (!config.IsMap())
+		auto fontsPath = path / L"fonts";
+		if (fs::is_directory(fontsPath))
+		{
+			for (auto& f : fs::directory_iterator(fontsPath))
 			{
-				swprintf(errMsg, 512, L"Root node is not a map.");
-				break;
+				if (!f.is_directory()) scan.files.push_back(f.path());
 			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		scan.error = e.what();
+	}
+}
 
-			if (auto node = FindNode(config, "fonts"); node && node.IsMap()) // TODO extract function GetMapChild: function<T (string)>
-			{
-				for (const auto& i : node)
-				{
-					if (i.first.IsScalar() && i.second.IsMap())
-					{
-						YAML::Node replace;
-						if (auto r = FindNode(i.second, "replace"); r && r.IsScalar())
-						{
-							replace = r;
-						}
-						else
-						{
-							replace = FindNode(i.second, "name");
-						}
-						if (replace && replace.IsScalar())
-						{
-							font fontInfo;
-							Utf8ToUtf16(replace.as<std::string>(), fontInfo.replace);
-							fontInfo.overrideFlags = _NONE;
-
-							if (auto node = FindNode(i.second, "size"); node && node.IsScalar())
-							{
-								if (stol(node.as<std::string>(), fontInfo.height))
-									fontInfo.overrideFlags |= _HEIGHT;
-							}
-
-							if (auto node = FindNode(i.second, "width"); node && node.IsScalar())
-							{
-								if (stol(node.as<std::string>(), fontInfo.width))
-									fontInfo.overrideFlags |= _WIDTH;
-							}
-
-							if (auto node = FindNode(i.second, "weight"); node && node.IsScalar())
-							{
-								if (stol(node.as<std::string>(), fontInfo.weight))
-									fontInfo.overrideFlags |= _WEIGHT;
-							}
-
-							if (auto node = FindNode(i.second, "italic"); node && node.IsScalar())
-							{
-								fontInfo.overrideFlags |= _ITALIC;
-								fontInfo.italic = node.as<bool>();
-							}
-
-							if (auto node = FindNode(i.second, "underLine"); node && node.IsScalar())
-							{
-								fontInfo.overrideFlags |= _UNDERLINE;
-								fontInfo.underLine = node.as<bool>();
-							}
-
-							if (auto node = FindNode(i.second, "strikeOut"); node && node.IsScalar())
-							{
-								fontInfo.overrideFlags |= _STRIKEOUT;
-								fontInfo.strikeOut = node.as<bool>();
-							}
-
-							if (auto node = FindNode(i.second, "charSet"); node && node.IsScalar())
-							{
-								unsigned long out;
-								if (stoul(node.as<std::string>(), out))
-								{
-									fontInfo.overrideFlags |= _CHARSET;
-									fontInfo.charSet = static_cast<BYTE>(out);
-								}
-							}
-
-							if (auto node = FindNode(i.second, "outPrecision"); node && node.IsScalar())
-							{
-								unsigned long out;
-								if (stoul(node.as<std::string>(), out))
-								{
-									fontInfo.overrideFlags |= _OUTPRECISION;
-									fontInfo.outPrecision = static_cast<BYTE>(out);
-								}
-							}
-
-							if (auto node = FindNode(i.second, "clipPrecision"); node && node.IsScalar())
-							{
-								unsigned long out;
-								if (stoul(node.as<std::string>(), out))
-								{
-									fontInfo.overrideFlags |= _CLIPPRECISION;
-									fontInfo.clipPrecision = static_cast<BYTE>(out);
-								}
-							}
-
-							if (auto node = FindNode(i.second, "quality"); node && node.IsScalar())
-							{
-								unsigned long out;
-								if (stoul(node.as<std::string>(), out))
-								{
-									fontInfo.overrideFlags |= _QUALITY;
-									fontInfo.quality = static_cast<BYTE>(out);
-								}
-							}
-
-							if (auto node = FindNode(i.second, "pitchAndFamily"); node && node.IsScalar())
-							{
-								unsigned long out;
-								if (stoul(node.as<std::string>(), out))
-								{
-									fontInfo.overrideFlags |= _PITCHANDFAMILY;
-									fontInfo.pitchAndFamily = static_cast<BYTE>(out);
-								}
-							}
-
-							std::wstring find;
-							Utf8ToUtf16(i.first.as<std::string>(), find);
-							fontsMap[find] = fontInfo;
-						}
-					}
-				}
-			}
+// Inflates and installs pack entry `i`, once packFamilies is first asked for its family
+void InstallPackFont(size_t i)
+{
+	std::string fileName(fontPack.Name(i));
+	std::vector<uint8_t> buffer; // AddFontMemResourceEx copies the font
+	DWORD installed = 0;
+	HANDLE handle = nullptr;
+	bool extracted = fontPack.Extract(i, buffer);
+	if (extracted)
+	{
+		auto add = origAddFontMemResourceEx ? origAddFontMemResourceEx : &AddFontMemResourceEx;
+		handle = add(buffer.data(), static_cast<DWORD>(buffer.size()), nullptr, &installed);
+	}
+	if (handle) stats::Add(procStats->userFonts);
+	{
+		std::lock_guard<std::mutex> hold(userFontsLock);
+		userFonts.push_back({ modulePath / PACK_FILE / fs::u8path(fileName), static_cast<int>(installed) });
+	}
+	if (auto log = logFile.load())
+	{
+		std::string family(fontPack.Family(i));
+		log->Printf("[LoadFontPack] filename = \"%s\", family = \"%s\", ret = %d, %s\n", fileName.c_str(), family.c_str(),
+			static_cast<int>(installed), extracted ? "ok" : "damaged");
+	}
+}
 
-			if (auto node = FindNode(config, "fixGSOFont"); node)
-			{
-				if (node.IsScalar())
-				{
-					if (node.as<bool>())
-						fixGSOFont = USE_NCM_FONT;
-				}
-				else if (node.IsMap())
-				{
-					YAML::Node name;
-					if (auto r = FindNode(node, "replace"); r && r.IsScalar())
-					{
-						name = r;
-					}
-					else
-					{
-						name = FindNode(node, "name");
-					}
-					if (name && name.IsScalar())
-					{
-						fixGSOFont = USE_USER_FONT;
-
-						std::wstring faceName;
-						Utf8ToUtf16(name.as<std::string>(), faceName);
-						memcpy_s(userGSOFont.lfFaceName, sizeof(userGSOFont.lfFaceName), faceName.c_str(), faceName.size() * sizeof(decltype(faceName)::value_type));
-
-						if (auto n = FindNode(node, "size"); n && n.IsScalar())
-						{
-							stol(n.as<std::string>(), userGSOFont.lfHeight);
-						}
-
-						if (auto n = FindNode(node, "width"); n && n.IsScalar())
-						{
-							stol(n.as<std::string>(), userGSOFont.lfWidth);
-						}
-
-						if (auto n = FindNode(node, "weight"); n && n.IsScalar())
-						{
-							stol(n.as<std::string>(), userGSOFont.lfWeight);
-						}
-
-						if (auto n = FindNode(node, "italic"); n && n.IsScalar())
-						{
-							userGSOFont.lfItalic = n.as<bool>();
-						}
-
-						if (auto n = FindNode(node, "underLine"); n && n.IsScalar())
-						{
-							userGSOFont.lfUnderline = n.as<bool>();
-						}
-
-						if (auto n = FindNode(node, "strikeOut"); n && n.IsScalar())
-						{
-							userGSOFont.lfStrikeOut = n.as<bool>();
-						}
-
-						if (auto n = FindNode(node, "charSet"); n && n.IsScalar())
-						{
-							unsigned long out;
-							stoul(n.as<std::string>(), out);
-							userGSOFont.lfCharSet = static_cast<BYTE>(out);
-						}
-
-						if (auto n = FindNode(node, "outPrecision"); n && n.IsScalar())
-						{
-							unsigned long out;
-							stoul(n.as<std::string>(), out);
-							userGSOFont.lfOutPrecision = static_cast<BYTE>(out);
-						}
-
-						if (auto n = FindNode(node, "clipPrecision"); n && n.IsScalar())
-						{
-							unsigned long out;
-							stoul(n.as<std::string>(), out);
-							userGSOFont.lfClipPrecision = static_cast<BYTE>(out);
-						}
-
-						if (auto n = FindNode(node, "quality"); n && n.IsScalar())
-						{
-							unsigned long out;
-							stoul(n.as<std::string>(), out);
-							userGSOFont.lfQuality = static_cast<BYTE>(out);
-						}
-
-						if (auto n = FindNode(node, "pitchAndFamily"); n && n.IsScalar())
-						{
-							unsigned long out;
-							stoul(n.as<std::string>(), out);
-							userGSOFont.lfPitchAndFamily = static_cast<BYTE>(out);
-						}
-					}
-				}
-			} // TODO extract duplicate logics
+// Indexes the families of a pack built by tools/fontpack, nothing is inflated until a family is used
+void RegisterFontPack(const userFontScan& scan)
+{
+	if (!scan.packOpened)
+	{
+		if (auto log = logFile.load())
+			log->Printf("[LoadFontPack] can not read %s\n", scan.packPath.u8string().c_str());
+		return;
+	}
+
+	// the names are converted once, lookups on the CreateFontIndirectExW path compare them as they come
+	std::wstring family;
+	for (size_t i = 0; i < fontPack.Count(); ++i)
+	{
+		if (Utf8ToUtf16(fontPack.Family(i), family)) packFamilies.Add(family, i);
+	}
+	packFamilies.Seal();
+	if (auto log = logFile.load())
+		log->Printf("[LoadFontPack] %zu fonts in %zu families, installed when first used\n", fontPack.Count(), packFamilies.Size());
+}
 
-			if (auto node = FindNode(config, "debug"); node && node.IsScalar())
-				debug = node.as<bool>();
+// FontMod's own fonts pass the hooks below unseen, the enumeration fingerprint covers them
+int AddOwnFont(const fs::path& path)
+{
+	auto add = origAddFontResourceExW ? origAddFontResourceExW : &AddFontResourceExW;
+	return add(path.c_str(), FR_PRIVATE, 0);
+}
 
-			ret = true;
-		} while (0);
+void RegisterUserFonts(userFontScan& scan)
+{
+	if (!scan.packPath.empty())
+	{
+		RegisterFontPack(scan);
 	}
-	else
+
+	for (auto& path : scan.files)
+	{
+		auto fileName = path.filename().u8string();
+		startupTrace.Begin("AddFontResourceExW", fileName.c_str());
+		int ret = AddOwnFont(path);
+		startupTrace.End();
+		if (ret) stats::Add(procStats->userFonts);
+		{
+			std::lock_guard<std::mutex> hold(userFontsLock);
+			userFonts.push_back({ path, ret });
+		}
+		if (auto log = logFile.load()) // TODO remove unnecessary indentation
+		{
+			log->Printf("[LoadUserFonts] filename = \"%s\", ret = %d, lasterror = %d\n", fileName.c_str(), ret, GetLastError());
+		}
+	}
+
+	if (!scan.error.empty())
+	{
+		if (auto log = logFile.load()) // TODO extract with preprocessor macro
+		{
+			log->Printf("[LoadUserFonts] exception: \"%s\"\n", scan.error.c_str());
+		}
+	}
+}
+
+// What enumeration results depend on: the fonts installed for the machine and the user,
+// the UI language names are localized in, the screen DPI the metrics are scaled to,
+// and the fonts registered from fonts/ and fonts.pack
+uint64_t EnumFingerprint()
+{
+	enumcache::Fingerprint print;
+	print.Add(sizeof(enumRecord));
+	print.Add(GetUserDefaultUILanguage());
+	int dpi = 0;
+	if (HDC screen = GetDC(nullptr))
+	{
+		dpi = GetDeviceCaps(screen, LOGPIXELSY);
+		ReleaseDC(nullptr, screen);
+	}
+	print.Add(dpi);
+	for (HKEY root : { HKEY_LOCAL_MACHINE, HKEY_CURRENT_USER })
+	{
+		HKEY key;
+		DWORD values = 0;
+		FILETIME written = {};
+		if (RegOpenKeyExW(root, L"Software\\Microsoft\\Windows NT\\CurrentVersion\\Fonts", 0, KEY_READ, &key) == ERROR_SUCCESS)
+		{
+			RegQueryInfoKeyW(key, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &values, nullptr, nullptr, nullptr, &written);
+			RegCloseKey(key);
+		}
+		print.Add(values);
+		print.Add(written);
+	}
+
+	// pack entries have no file of their own, fonts.pack stands for them whether installed yet or not
+	std::vector<fs::path> files = { modulePath / PACK_FILE };
+	{
+		std::lock_guard<std::mutex> hold(userFontsLock);
+		for (auto& f : userFonts)
+		{
+			if (f.path.parent_path() == files.front()) continue;
+			print.Add(f.path.native());
+			print.Add(f.ret);
+			files.push_back(f.path);
+		}
+	}
+	std::error_code ec;
+	for (auto& path : files)
+	{
+		print.Add(static_cast<uint64_t>(fs::file_size(path, ec)));
+		print.Add(fs::last_write_time(path, ec).time_since_epoch().count());
+	}
+	return print.Value();
+}
+
+void LoadEnumCache()
+{
+	auto cachePath = modulePath/ENUM_CACHE_FILE;
+	bool loaded = enumCache.Load(cachePath, EnumFingerprint());
+	if (auto log = logFile.load())
+	{
+		if (loaded)
+			log->Printf("[DllMain] %zu font enumerations loaded from %s\n", enumCache.Size(), cachePath.u8string().c_str());
+		else
+			log->Printf("[DllMain] no font enumerations for the installed fonts in %s\n", cachePath.u8string().c_str());
+	}
+}
+
+int CALLBACK CollectFace(const LOGFONTW* lf, const TEXTMETRICW*, DWORD, LPARAM param)
+{
+	reinterpret_cast<rules::FaceSet*>(param)->Add(lf->lfFaceName);
+	return 1;
+}
+
+// The face GDI creates for `face`, as GetTextFaceW names it
+std::wstring CreatedFace(HDC dc, const std::wstring& face)
+{
+	LOGFONTW lf = {};
+	lf.lfCharSet = DEFAULT_CHARSET;
+	face.copy(lf.lfFaceName, LF_FACESIZE - 1);
+	WCHAR created[LF_FACESIZE] = {};
+	if (HFONT font = CreateFontUnhooked(lf))
+	{
+		HGDIOBJ old = SelectObject(dc, font);
+		GetTextFaceW(dc, LF_FACESIZE, created);
+		SelectObject(dc, old);
+		DeleteObject(font);
+	}
+	return created;
+}
+
+// Chooses the replacement of every rule with a `replace` list from one enumeration of the fonts
+// installed and registered now, lookups only ever read the choice
+void ResolveChains()
+{
+	if (useEmbedded || !ruleEngine.Chained()) return;
+
+	rules::FaceSet available;
+	LOGFONTW lf = {};
+	lf.lfCharSet = DEFAULT_CHARSET;
+	// unhooked, resolving must not fill the enumeration cache
+	auto enumerate = origEnumFontFamiliesExW ? origEnumFontFamiliesExW : &EnumFontFamiliesExW;
+	HDC dc = CreateCompatibleDC(nullptr);
+	if (dc)
+		enumerate(dc, &lf, CollectFace, reinterpret_cast<LPARAM>(&available), 0);
+	// A font is listed under its localized name only, on a Chinese UI Microsoft YaHei is missing
+	// from the list. GDI creates it by either name: a candidate not listed is created, and counts
+	// if GDI names it as asked or gives it another face than it gives a name it does not know.
+	std::wstring fallback = dc ? CreatedFace(dc, L"FontMod Unknown Face") : std::wstring();
+	if (!fallback.empty())
+	{
+		available.SetProbe([dc, &fallback](const std::wstring& face) {
+			auto created = CreatedFace(dc, face);
+			return !created.empty() && (_wcsicmp(created.c_str(), face.c_str()) == 0 || created != fallback);
+		});
+	}
+	// pack families count as well, the first font using one installs it
+	for (auto& family : packFamilies.PendingNames())
+		available.Add(family);
+
+	auto choices = ruleEngine.Resolve(available);
+	if (dc) DeleteDC(dc);
+	if (auto log = logFile.load())
 	{
-#pragma warning(push)
-#pragma warning(disable: 4996) // 'strerror': This function or variable may be unsafe.
-		swprintf(errMsg, 512, L"Can not open " CONFIG_FILE ".\n%hs", strerror(errno));
-#pragma warning(pop)
+		for (auto& r : choices)
+		{
+			std::string key, face;
+			Utf16ToUtf8(r.key, key);
+			Utf16ToUtf8(r.face, face);
+			if (r.available)
+				log->Printf("[ResolveFonts] \"%s\" -> \"%s\", candidate %zu of %zu\n", key.c_str(), face.c_str(), r.candidate + 1, r.candidates);
+			else
+				log->Printf("[ResolveFonts] \"%s\" -> \"%s\", none of %zu candidates among %zu faces\n", key.c_str(), face.c_str(), r.candidates, available.Size());
+		}
 	}
+}
+
+// What depends on the registered user fonts starts over after the watcher changed them
+void UserFontsChanged()
+{
+	ResolveChains();
+	if (enumCaching)
+		enumCache.Reset(EnumFingerprint());
+}
+
+// Fonts the program registers are in no fingerprint: what was enumerated so far starts over,
+// and what is enumerated from now on is replayed for this run but never saved
+void AppFontsChanged(const char* api)
+{
+	appFonts = true;
+	enumCache.Reset(EnumFingerprint());
+	if (auto log = logFile.load())
+		log->Printf("[EnumCache] %s, enumerations start over and are no longer saved\n", api);
+}
+
+int WINAPI MyAddFontResourceExW(LPCWSTR name, DWORD fl, PVOID res)
+{
+	int ret = origAddFontResourceExW(name, fl, res);
+	if (ret) AppFontsChanged("AddFontResourceExW");
 	return ret;
 }
 
-void LoadUserFonts(const fs::path& path)
+HANDLE WINAPI MyAddFontMemResourceEx(PVOID pFileView, DWORD cjSize, PVOID pvResrved, DWORD* pNumFonts)
 {
-	try
+	HANDLE ret = origAddFontMemResourceEx(pFileView, cjSize, pvResrved, pNumFonts);
+	if (ret) AppFontsChanged("AddFontMemResourceEx");
+	return ret;
+}
+
+BOOL WINAPI MyRemoveFontResourceExW(LPCWSTR name, DWORD fl, PVOID pdv)
+{
+	BOOL ret = origRemoveFontResourceExW(name, fl, pdv);
+	if (ret) AppFontsChanged("RemoveFontResourceExW");
+	return ret;
+}
+
+// Fonts installed or removed for the whole session, by another program or the Fonts folder
+LRESULT CALLBACK FontChangeProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	if (msg != WM_FONTCHANGE)
+		return DefWindowProcW(hwnd, msg, wParam, lParam);
+	enumCache.Reset(EnumFingerprint());
+	if (auto log = logFile.load())
+		log->Printf("[EnumCache] WM_FONTCHANGE, enumerations start over\n");
+	return 0;
+}
+
+// The broadcast only reaches top-level windows, a message-only one would miss it
+DWORD WINAPI ListenFontChanges(LPVOID param)
+{
+	WNDCLASSW wc = {};
+	wc.lpfnWndProc = FontChangeProc;
+	wc.hInstance = static_cast<HINSTANCE>(param);
+	wc.lpszClassName = L"FontModFontChange";
+	if (!RegisterClassW(&wc) || !CreateWindowExW(0, wc.lpszClassName, L"", 0, 0, 0, 0, 0, nullptr, nullptr, wc.hInstance, nullptr))
 	{
-		auto fontsPath = path / L"fonts";
-		if (fs::is_directory(fontsPath)) // TODO replace with early-return
+		if (auto log = logFile.load())
+			log->Printf("[EnumCache] can not listen for WM_FONTCHANGE (%d)\n", static_cast<int>(GetLastError()));
+		return 1;
+	}
+	MSG msg;
+	while (GetMessageW(&msg, nullptr, 0, 0) > 0)
+		DispatchMessageW(&msg);
+	return 0;
+}
+
+// Registers a file dropped into fonts/ or rewritten there, replacing its earlier entry
+bool AddWatchedFont(const fs::path& path)
+{
+	int ret = AddOwnFont(path);
+	DWORD err = GetLastError();
+	if (ret) stats::Add(procStats->userFonts);
+	{
+		std::lock_guard<std::mutex> hold(userFontsLock);
+		userFonts.erase(std::remove_if(userFonts.begin(), userFonts.end(), [&](const userFont& f) { return f.path == path; }), userFonts.end());
+		userFonts.push_back({ path, ret });
+	}
+	if (auto log = logFile.load())
+		log->Printf("[WatchFonts] added \"%s\", ret = %d, lasterror = %d\n", path.filename().u8string().c_str(), ret, static_cast<int>(err));
+	return ret != 0;
+}
+
+bool RemoveWatchedFont(const fs::path& path)
+{
+	auto remove = origRemoveFontResourceExW ? origRemoveFontResourceExW : &RemoveFontResourceExW;
+	BOOL ok = remove(path.c_str(), FR_PRIVATE, 0);
+	if (ok) procStats->userFonts.fetch_sub(1, std::memory_order_relaxed);
+	if (auto log = logFile.load())
+		log->Printf("[WatchFonts] removed \"%s\", ret = %d\n", path.filename().u8string().c_str(), static_cast<int>(ok));
+	return ok != FALSE;
+}
+
+void SyncUserFonts()
+{
+	auto changes = fontRegistry->Sync(fontwatch::Scan(modulePath / L"fonts"));
+	if (changes.Empty()) return;
+	{
+		// files that never registered have no font to remove but still an entry
+		std::lock_guard<std::mutex> hold(userFontsLock);
+		for (auto& path : changes.removed)
+			userFonts.erase(std::remove_if(userFonts.begin(), userFonts.end(), [&](const userFont& f) { return f.path == path; }), userFonts.end());
+	}
+	UserFontsChanged();
+}
+
+// Picks up fonts/ changes from the files registered at startup on. The watcher thread is never
+// joined, so the module is pinned: FreeLibrary would unload code it still runs.
+void StartFontWatch(const userFontScan& scan)
+{
+	fontRegistry = new fontwatch::Registry(AddWatchedFont, RemoveWatchedFont);
+	{
+		std::lock_guard<std::mutex> hold(userFontsLock);
+		for (auto& f : userFonts)
 		{
-			for (auto& f : fs::directory_iterator(fontsPath))
-			{
-				if (f.is_directory()) continue;
-				int ret = AddFontResourceExW(f.path().c_str(), FR_PRIVATE, 0);
-				if (logFile) // TODO remove unnecessary indentation
-				{
-					fprintf_s(logFile, "[LoadUserFonts] filename = \"%s\", ret = %d, lasterror = %d\n", f.path().filename().u8string().c_str(), ret, GetLastError());
-				}
-			}
+			fontwatch::fileState state;
+			bool fromFolder = std::find(scan.files.begin(), scan.files.end(), f.path) != scan.files.end();
+			if (fromFolder && fontwatch::Stat(f.path, state))
+				fontRegistry->Seed(f.path, state, f.ret != 0);
 		}
 	}
-	catch (const std::exception& e)
+
+	auto fontsPath = modulePath / L"fonts";
+	HMODULE self;
+	fontWatcher = new fontwatch::Watcher;
+	bool started = GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+		reinterpret_cast<LPCWSTR>(&StartFontWatch), &self) &&
+		fontWatcher->Start(fontsPath, std::chrono::milliseconds(500), SyncUserFonts);
+	if (auto log = logFile.load())
+	{
+		if (started)
+			log->Printf("[WatchFonts] watching %s\n", fontsPath.u8string().c_str());
+		else
+			log->Printf("[WatchFonts] can not watch %s\n", fontsPath.u8string().c_str());
+	}
+}
+
+template <typename F>
+void InlineHook(hook::HookTransaction& hooks, const char* name, FARPROC func, F hookFunc, F* origFunc)
+{
+	startupTrace.Begin("InlineHook", name);
+	if (!hooks.Add(reinterpret_cast<F>(func), reinterpret_cast<void*>(hookFunc), origFunc))
+	{
+		if (auto log = logFile.load())
+			log->Printf("[InlineHook] can not hook %s\n", name);
+	}
+	startupTrace.End();
+}
+
+bool OpenLogFile()
+{
+	if (!logSink.Open(modulePath/LOG_FILE, logSegmentSize, logGenerations))
+		return false;
+	logFile = &logSink;
+	return true;
+}
+
+std::string FormatRules()
+{
+	std::string out;
+	// built-in rules are not counted
+	auto format = [&out](std::wstring_view find, std::wstring_view replace, uint32_t overrideFlags, const uint64_t* hits) {
+		std::string from, to;
+		char flags[48];
+		Utf16ToUtf8(find, from);
+		Utf16ToUtf8(replace, to);
+		if (hits)
+			snprintf(flags, sizeof(flags), "%#x hits = %llu", overrideFlags, static_cast<unsigned long long>(*hits));
+		else
+			snprintf(flags, sizeof(flags), "%#x", overrideFlags);
+		out += "\"" + from + "\" -> \"" + to + "\" flags = " + flags + "\n";
+	};
+#ifdef EMBEDDED_RULES
+	if (useEmbedded)
+	{
+		for (size_t i = 0; i < embedded::RULE_COUNT; ++i)
+			format(embedded::RULES[i].find, embedded::RULES[i].image.replace, embedded::RULES[i].image.overrideFlags, nullptr);
+		return out;
+	}
+#endif
+	auto& ruleStore = ruleEngine.Store();
+	std::vector<uint64_t> hits;
+	uint64_t misses;
+	ruleEngine.ReadCounters(hits, misses);
+	for (size_t i = 0; i < ruleStore.Size(); ++i)
+	{
+		auto& hot = ruleStore.Hot(i);
+		auto& cold = ruleStore.Cold(i);
+		format(ruleStore.Text(cold.keyOffset, cold.keyLen), ruleStore.Replace(hot), hot.overrideFlags & ~rules::CHAINED, &hits[i]);
+	}
+
+	auto fp = ruleStore.Footprint();
+	char summary[200];
+	snprintf(summary, sizeof(summary), "%zu rules, %zu bytes: hot %zu, cold %zu, index %zu, arena %zu\n%llu lookups without a rule\n",
+		ruleStore.Size(), fp.Total(), fp.hot, fp.cold, fp.index, fp.arena, static_cast<unsigned long long>(misses));
+	return out + summary;
+}
+
+// For code running in the host: the hits of up to `capacity` rules since startup,
+// returns the number of rules. Built-in rules are not counted.
+extern "C" __declspec(dllexport) size_t WINAPI FontModRuleHits(rules::ruleHits* out, size_t capacity, uint64_t* misses)
+{
+	std::vector<uint64_t> hits;
+	uint64_t missed;
+	ruleEngine.ReadCounters(hits, missed);
+	auto& ruleStore = ruleEngine.Store();
+	for (size_t i = 0; out && i < capacity && i < hits.size(); ++i)
+	{
+		auto& cold = ruleStore.Cold(i);
+		auto key = ruleStore.Text(cold.keyOffset, cold.keyLen);
+		key.copy(out[i].face, FACE_SIZE - 1);
+		out[i].face[key.size()] = L'\0';
+		out[i].hits = hits[i];
+	}
+	if (misses) *misses = missed;
+	return hits.size();
+}
+
+void LogRuleHits(logsink::MappedLog* log)
+{
+	std::vector<uint64_t> hits;
+	uint64_t misses;
+	ruleEngine.ReadCounters(hits, misses);
+	auto& ruleStore = ruleEngine.Store();
+	for (size_t i = 0; i < hits.size(); ++i)
+	{
+		auto& cold = ruleStore.Cold(i);
+		std::string key;
+		if (hits[i] && Utf16ToUtf8(ruleStore.Text(cold.keyOffset, cold.keyLen), key))
+			log->Printf("[DllMain] rule \"%s\" hits = %llu\n", key.c_str(), static_cast<unsigned long long>(hits[i]));
+	}
+	log->Printf("[DllMain] %llu lookups without a rule, counted on %zu threads\n", static_cast<unsigned long long>(misses), ruleEngine.CounterShards());
+}
+
+std::string FormatStats()
+{
+	char out[320];
+	snprintf(out, sizeof(out),
+		"hookCalls = %llu\nruleHits = %llu\nruleMisses = %llu\n"
+		"fontsCreated = %llu\nuserFonts = %llu\ninitTimeUs = %llu\ncriticalPathUs = %llu\n",
+		static_cast<unsigned long long>(procStats->hookCalls.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(procStats->ruleHits.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(procStats->ruleMisses.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(procStats->fontsCreated.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(procStats->userFonts.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(procStats->initTimeUs.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(startupCriticalUs));
+	return out;
+}
+
+std::string FormatMetrics()
+{
+	auto& s = metricsCache.Stats();
+	char out[192];
+	snprintf(out, sizeof(out), "fonts = %zu\nhits = %llu\nmisses = %llu\ninvalidations = %llu\nhitRate = %.1f%%\n",
+		metricsCache.Size(),
+		static_cast<unsigned long long>(s.hits.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(s.misses.load(std::memory_order_relaxed)),
+		static_cast<unsigned long long>(s.invalidations.load(std::memory_order_relaxed)),
+		metricsCache.HitRate() * 100);
+	return out;
+}
+
+// The call sites creating the most fonts, by module+offset of the loaded modules
+std::string FormatCallers()
+{
+	if (!callerTable) return "profileCallers is off\n";
+	callers::ModuleMap modules;
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, 0);
+	if (snapshot != INVALID_HANDLE_VALUE)
+	{
+		MODULEENTRY32W me = { sizeof(me) };
+		for (BOOL more = Module32FirstW(snapshot, &me); more; more = Module32NextW(snapshot, &me))
+		{
+			std::string name;
+			Utf16ToUtf8(me.szModule, name);
+			modules.Add(name, reinterpret_cast<uintptr_t>(me.modBaseAddr), me.modBaseSize);
+		}
+		CloseHandle(snapshot);
+	}
+	// GDI forwarding the call and this DLL are not who asked for the font
+	std::vector<std::string> skip = { "gdi32.dll", "gdi32full.dll" };
+	if (auto self = modules.Find(reinterpret_cast<uintptr_t>(&FormatCallers)))
+		skip.push_back(self->name);
+	return callers::Report(*callerTable, modules, skip);
+}
+
+std::string FormatUserFonts()
+{
+	std::string out;
+	std::lock_guard<std::mutex> hold(userFontsLock);
+	for (auto& f : userFonts)
+		out += "\"" + f.path.filename().u8string() + "\" ret = " + std::to_string(f.ret) + "\n";
+	return out;
+}
+
+void SaveRunData();
+
+// The listener thread is never stopped, so the module is pinned as for the font watcher
+void StartIntrospection()
+{
+	endpoint.On("rules", [](const std::string&) { return FormatRules(); });
+	endpoint.On("stats", [](const std::string&) { return FormatStats(); });
+	endpoint.On("latency", [](const std::string& args) {
+		std::string out = rewriteLatency.Format("rewrite") + createLatency.Format("CreateFontIndirectExW");
+		if (args == "reset")
+		{
+			rewriteLatency.Reset();
+			createLatency.Reset();
+		}
+		return out;
+	});
+	endpoint.On("fonts", [](const std::string&) { return FormatUserFonts(); });
+	endpoint.On("metrics", [](const std::string&) { return FormatMetrics(); });
+	endpoint.On("callers", [](const std::string&) { return FormatCallers(); });
+	endpoint.On("trace", [](const std::string& args) -> std::string {
+		if (args == "on")
+			return OpenLogFile() ? "tracing to FontMod.log\n" : "can not open FontMod.log\n";
+		if (args == "off")
+		{
+			logFile = nullptr;
+			return "tracing off\n";
+		}
+		return logFile.load() ? "on\n" : "off\n";
+	});
+	endpoint.On("save", [](const std::string&) {
+		SaveRunData();
+		return std::string("saved\n");
+	});
+	endpoint.On("help", [](const std::string&) -> std::string {
+		return "rules | stats | latency [reset] | fonts | metrics | callers | trace [on|off] | save\n";
+	});
+
+	HMODULE self;
+	if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+		reinterpret_cast<LPCWSTR>(&StartIntrospection), &self) || !endpoint.Start())
+	{
+		if (auto log = logFile.load())
+			log->Printf("[DllMain] can not start introspection endpoint. (%d)\n", GetLastError());
+	}
+	else if (auto log = logFile.load())
+	{
+		std::string name;
+		Utf16ToUtf8(endpoint.Name(), name);
+		log->Printf("[DllMain] introspection endpoint \"%s\"\n", name.c_str());
+	}
+}
+
+// Creates the replacement fonts once at the system UI size, unless a rule sets its own
+DWORD WINAPI PrewarmFonts(LPVOID param)
+{
+	auto mode = static_cast<PrewarmMode>(reinterpret_cast<uintptr_t>(param));
+	auto prewarmStart = std::chrono::steady_clock::now();
+
+	LOGFONTW base = {};
+	NONCLIENTMETRICSW ncm = { sizeof(ncm) };
+	if (SystemParametersInfoW(SPI_GETNONCLIENTMETRICS, sizeof(ncm), &ncm, 0))
+		base = ncm.lfMessageFont;
+
+	std::vector<LOGFONTW> fonts;
+	auto add = [&fonts](const LOGFONTW& lf) {
+		for (auto& f : fonts)
+		{
+			if (memcmp(&f, &lf, sizeof(lf)) == 0) return;
+		}
+		fonts.push_back(lf);
+	};
+#ifdef EMBEDDED_RULES
+	if (useEmbedded)
+	{
+		for (size_t i = 0; i < embedded::RULE_COUNT; ++i)
+		{
+			LOGFONTW lf = base;
+			rules::ApplyRule(embedded::RULES[i].image, lf);
+			add(lf);
+		}
+	}
+#endif
+	auto& ruleStore = ruleEngine.Store();
+	for (size_t i = 0; !useEmbedded && i < ruleStore.Size(); ++i)
+	{
+		LOGFONTW lf = base;
+		ruleStore.CopyReplace(ruleStore.Hot(i), lf.lfFaceName);
+		rules::ApplyStyle(ruleStore.Hot(i), lf);
+		add(lf);
+	}
+
+	HDC dc = mode == PREWARM_SELECT ? CreateCompatibleDC(nullptr) : nullptr;
+	for (auto& lf : fonts)
+	{
+		// bypass the hook, these are already rewritten
+		HFONT font = CreateFontUnhooked(lf);
+		if (!font) continue;
+		if (dc)
+		{
+			// selecting alone is lazy, asking for metrics makes GDI realize the font
+			HGDIOBJ old = SelectObject(dc, font);
+			TEXTMETRICW tm;
+			GetTextMetricsW(dc, &tm);
+			SelectObject(dc, old);
+		}
+		prewarmedFonts.push_back(font);
+	}
+	if (dc) DeleteDC(dc);
+
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - prewarmStart).count();
+	procStats->prewarmUs.store(std::max<uint64_t>(us, 1), std::memory_order_release);
+	if (auto log = logFile.load())
+		log->Printf("[PrewarmFonts] %zu fonts in %lld us\n", prewarmedFonts.size(), static_cast<long long>(us));
+	return 0;
+}
+
+void WriteStartupTrace()
+{
+	FILE* f;
+	auto tracePath = modulePath/TRACE_FILE;
+	if (_wfopen_s(&f, tracePath.c_str(), L"wb") != 0)
+	{
+		if (auto log = logFile.load())
+			log->Printf("[DllMain] can not write %s\n", tracePath.u8string().c_str());
+		return;
+	}
+	startupTrace.Write(f, GetCurrentProcessId(), GetCurrentThreadId());
+	fclose(f);
+}
+
+// Written beside and renamed over the report, which is written again by every save
+void WriteCallers()
+{
+	FILE* f;
+	auto callersPath = modulePath/CALLERS_FILE;
+	auto tmpPath = callersPath;
+	tmpPath += L".tmp";
+	bool written = _wfopen_s(&f, tmpPath.c_str(), L"wb") == 0;
+	if (written)
+	{
+		written = fputs(FormatCallers().c_str(), f) >= 0;
+		written = fclose(f) == 0 && written;
+		written = written && MoveFileExW(tmpPath.c_str(), callersPath.c_str(), MOVEFILE_REPLACE_EXISTING);
+		if (!written) DeleteFileW(tmpPath.c_str());
+	}
+	if (!written)
+	{
+		if (auto log = logFile.load())
+			log->Printf("[DllMain] can not write %s\n", callersPath.u8string().c_str());
+	}
+}
+
+void OpenStats()
+{
+	if (!statsSegment.Open()) return;
+
+	wchar_t exePath[MAX_PATH];
+	DWORD len = GetModuleFileNameW(nullptr, exePath, MAX_PATH);
+	std::string exe;
+	Utf16ToUtf8(fs::path(std::wstring_view(exePath, len)).filename().native(), exe);
+	if (auto inst = statsSegment.Claim(stats::CurrentPid(), exe.c_str()))
+		procStats = inst;
+}
+
+// Fills the stock font table, the fonts themselves are created when first asked for
+// SystemParametersInfo is asked here, before the hook is installed: USER may call GetStockObject
+// from it, which would enter call_once for the GSO font from inside itself
+void PrepareStockFonts(GSOFontMode fixGSOFont, const LOGFONTW& userGSOFont)
+{
+	gsoLogFont = userGSOFont;
+	gsoReady = true;
+	if (fixGSOFont == USE_NCM_FONT)
 	{
-		if (logFile) // TODO extract with preprocessor macro
+		NONCLIENTMETRICSW ncm = { sizeof(ncm) };
+		gsoReady = SystemParametersInfoW(SPI_GETNONCLIENTMETRICS, sizeof(ncm), &ncm, 0) != FALSE;
+		if (!gsoReady)
+		{
+			if (auto log = logFile.load())
+				log->Printf("[GetStockObject] SystemParametersInfo failed. (%d)\n", GetLastError());
+		}
+		else
 		{
-			fprintf_s(logFile, "[LoadUserFonts] exception: \"%s\"\n", e.what());
+			gsoLogFont = ncm.lfMessageFont;
+			std::string name;
+			if (auto log = logFile.load(); log && Utf16ToUtf8(gsoLogFont.lfFaceName, name))
+				log->Printf("[GetStockObject] SystemParametersInfo NONCLIENTMETRICS.lfMessageFont.lfFaceName=\"%s\"\n", name.c_str());
 		}
 	}
+	for (int i : { SYSTEM_FONT, ANSI_VAR_FONT, DEVICE_DEFAULT_FONT })
+		stockFonts[i].source = STOCK_GSO;
+	for (int i : { OEM_FIXED_FONT, ANSI_FIXED_FONT, SYSTEM_FIXED_FONT })
+		stockFonts[i].source = STOCK_RULES;
+}
+
+std::mutex saving; // the ExitProcess hook and the `save` command may run at once
+
+// Writes what this run learned: the rule profile, the caller report and new enumerations. Called by the ExitProcess hook while every thread
+// still runs and no loader lock is held, by the `save` introspection command, and on FreeLibrary,
+// never in DLL_PROCESS_DETACH at process exit: the other threads are gone with the locks they held.
+void SaveRunData()
+{
+	std::lock_guard<std::mutex> hold(saving);
+	if (profiling)
+	{
+		// the loaded scores are kept as they are, each save adds this run's hits so far to them
+		rules::Profile run = ruleProfile;
+		run.Decay();
+		ruleEngine.Record(run);
+		run.Save(modulePath/PROFILE_FILE);
+	}
+	if (callerTable)
+		WriteCallers();
+	if (enumCaching && enumCache.Dirty())
+		enumCache.Save(modulePath/ENUM_CACHE_FILE);
+}
+
+// The end of a run: its data saved and the rule hits in the debug log
+void FinishRun()
+{
+	SaveRunData();
+	if (auto log = logFile.load(); log && !useEmbedded)
+		LogRuleHits(log);
 }
 
-void InlineHook(void* func, void* hookFunc, size_t* origAddr)
+bool FinishesRun(const config::options& opts)
 {
-	DWORD oldProtect;
-	if (VirtualProtect(func, SIZE_FN_PROLOG_OFFSET, PAGE_EXECUTE_READWRITE, &oldProtect))
+	// introspection may turn logging on later
+	return profiling || callerTable || enumCaching || (!useEmbedded && (opts.debug || opts.introspect));
+}
+
+void WINAPI MyExitProcess(UINT exitCode)
+{
+	FinishRun();
+	origExitProcess(exitCode);
+}
+
+void InstallHooks(GSOFontMode fixGSOFont, const LOGFONTW& userGSOFont, const config::options& opts)
+{
+	HMODULE hGdi32 = GetModuleHandleW(L"gdi32.dll");
+	hook::HookTransaction hooks(hookArena);
+
+	if (fixGSOFont != DISABLED)
+	{
+		auto pfnGetStockObject = GetProcAddress(hGdi32, "GetStockObject");
+		if (pfnGetStockObject)
+		{
+			PrepareStockFonts(fixGSOFont, userGSOFont);
+			InlineHook(hooks, "GetStockObject", pfnGetStockObject, &MyGetStockObject, &origGetStockObject);
+		}
+	}
+
+	// Since Windows 10 the other CreateFont APIs live in gdi32full and call its CreateFontIndirectExW,
+	// gdi32's export may be forwarded to it, then one hook covers both
+	auto pfnCreateFontIndirectExW = GetProcAddress(hGdi32, "CreateFontIndirectExW");
+	HMODULE hGdi32Full = GetModuleHandleW(L"gdi32full.dll");
+	auto pfnFullCreateFontIndirectExW = hGdi32Full ? GetProcAddress(hGdi32Full, "CreateFontIndirectExW") : nullptr;
+	if (pfnFullCreateFontIndirectExW == pfnCreateFontIndirectExW)
+		pfnFullCreateFontIndirectExW = nullptr;
+	// logging stays compiled in with introspection, which can turn it on later
+	bool counting = procStats != &localStats || opts.introspect;
+	bool logging = opts.debug || opts.introspect;
+	if (pfnCreateFontIndirectExW)
+	{
+		auto hook = SelectCreateFontHook(false, useEmbedded, logging, counting, opts.introspect, callerTable != nullptr);
+		InlineHook(hooks, "CreateFontIndirectExW", pfnCreateFontIndirectExW, hook, &origCreateFontIndirectExW);
+	}
+	if (pfnFullCreateFontIndirectExW)
+	{
+		auto hook = SelectCreateFontHook(true, useEmbedded, logging, counting, opts.introspect, callerTable != nullptr);
+		InlineHook(hooks, "gdi32full!CreateFontIndirectExW", pfnFullCreateFontIndirectExW, hook, &origFullCreateFontIndirectExW);
+	}
+
+	if (opts.cacheEnum)
+	{
+		auto pfnEnumFontFamiliesExW = GetProcAddress(hGdi32, "EnumFontFamiliesExW");
+		if (pfnEnumFontFamiliesExW)
+		{
+			enumCaching = true;
+			InlineHook(hooks, "EnumFontFamiliesExW", pfnEnumFontFamiliesExW, &MyEnumFontFamiliesExW, &origEnumFontFamiliesExW);
+		}
+	}
+
+	// fonts the program registers itself change what an enumeration lists
+	if (enumCaching)
+	{
+		auto pfnAddFontResourceExW = GetProcAddress(hGdi32, "AddFontResourceExW");
+		auto pfnAddFontMemResourceEx = GetProcAddress(hGdi32, "AddFontMemResourceEx");
+		auto pfnRemoveFontResourceExW = GetProcAddress(hGdi32, "RemoveFontResourceExW");
+		if (pfnAddFontResourceExW)
+			InlineHook(hooks, "AddFontResourceExW", pfnAddFontResourceExW, &MyAddFontResourceExW, &origAddFontResourceExW);
+		if (pfnAddFontMemResourceEx)
+			InlineHook(hooks, "AddFontMemResourceEx", pfnAddFontMemResourceEx, &MyAddFontMemResourceEx, &origAddFontMemResourceEx);
+		if (pfnRemoveFontResourceExW)
+			InlineHook(hooks, "RemoveFontResourceExW", pfnRemoveFontResourceExW, &MyRemoveFontResourceExW, &origRemoveFontResourceExW);
+	}
+
+	if (opts.cacheMetrics)
+	{
+		auto pfnGetTextMetricsW = GetProcAddress(hGdi32, "GetTextMetricsW");
+		auto pfnGetCharWidth32W = GetProcAddress(hGdi32, "GetCharWidth32W");
+		auto pfnGetCharABCWidthsW = GetProcAddress(hGdi32, "GetCharABCWidthsW");
+		auto pfnDeleteObject = GetProcAddress(hGdi32, "DeleteObject");
+		// without invalidation a reused handle would get a deleted font's metrics
+		if (pfnGetTextMetricsW && pfnGetCharWidth32W && pfnGetCharABCWidthsW && pfnDeleteObject)
+		{
+			InlineHook(hooks, "DeleteObject", pfnDeleteObject, &MyDeleteObject, &origDeleteObject);
+			InlineHook(hooks, "GetTextMetricsW", pfnGetTextMetricsW, &MyGetTextMetricsW, &origGetTextMetricsW);
+			InlineHook(hooks, "GetCharWidth32W", pfnGetCharWidth32W, &MyGetCharWidth32W, &origGetCharWidth32W);
+			InlineHook(hooks, "GetCharABCWidthsW", pfnGetCharABCWidthsW, &MyGetCharABCWidthsW, &origGetCharABCWidthsW);
+		}
+	}
+
+	if (FinishesRun(opts))
+	{
+		auto pfnExitProcess = GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "ExitProcess");
+		if (pfnExitProcess)
+			InlineHook(hooks, "ExitProcess", pfnExitProcess, &MyExitProcess, &origExitProcess);
+	}
+
+	startupTrace.Begin("HookCommit");
+	bool hooked = hooks.Commit();
+	startupTrace.End();
+	if (!hooked)
 	{
-		x86Ins8Iaddr* hookjmp = reinterpret_cast<x86Ins8Iaddr*>(func);
-		size_t funce_offset = static_cast<size_t>(func + SIZE_FN_PROLOG_OFFSET);
-		*origAddr = funce_offset;
-		hookjmp->opcode = 0xE9; // jmp
-		hookjmp->address = reinterpret_cast<size_t>(hookFunc) - funce_offset;
-		VirtualProtect(func, SIZE_FN_PROLOG_OFFSET, oldProtect, &oldProtect);
-	} // TODO extract VirtualProtect logic
+		if (auto log = logFile.load())
+			log->Printf("[DllMain] failed to apply hooks. (%d)\n", GetLastError());
+	}
+}
+
+// A startup step recorded as a trace span
+template <typename F>
+startup::task_id Step(startup::Graph& graph, const char* name, F work, std::initializer_list<startup::task_id> deps = {}, bool concurrent = false)
+{
+	return graph.Add(name, [name, work] {
+		startupTrace.Begin(name);
+		work();
+		startupTrace.End();
+	}, deps, concurrent);
+}
+
+VOID CALLBACK RunStartupHelper(PTP_CALLBACK_INSTANCE, PVOID param)
+{
+	auto work = static_cast<std::function<void()>*>(param);
+	(*work)();
+	delete work;
+}
+
+// Startup helpers come from the process thread pool. Under the loader lock a new pool thread
+// can not start before DllMain returns, the graph then runs serially on the loading thread.
+void SpawnStartupHelper(std::function<void()> work)
+{
+	auto context = new std::function<void()>(std::move(work));
+	if (!TrySubmitThreadpoolCallback(RunStartupHelper, context, nullptr))
+		delete context;
 }
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD reason, LPVOID lpReserved)
@@ -461,99 +1276,184 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD reason, LPVOID lpReserved)
 	switch (reason) {
 	case DLL_PROCESS_ATTACH:
 		DisableThreadLibraryCalls(hModule);
+		auto initStart = std::chrono::steady_clock::now();
+		startupTrace.Begin("DllMain");
+		startupTrace.Begin("OpenStats");
+		OpenStats();
+		startupTrace.End();
 
 #if _DEBUG
 		MessageBoxW(0, L"DLL_PROCESS_ATTACH", L"", 0);
 #endif
 
-		if (!LoadDLL()) return false;
-
 		auto path = GetModuleFsPath(hModule);
+		modulePath = path;
 		auto configPath = path/CONFIG_FILE;
-		if (!fs::exists(configPath))
+		GSOFontMode fixGSOFont = DISABLED;
+		LOGFONT userGSOFont = {};
+		config::options opts;
+		bool loaded = true;
+		std::string errMsg;
+		userFontScan scan;
+
+#ifdef EMBEDDED_RULES
+		// A FontMod.yaml next to the DLL overrides the rules built in
+		useEmbedded = !fs::exists(configPath);
+		if (useEmbedded)
 		{
-			FILE* f;
-			if (_wfopen_s(&f, configPath.c_str(), L"wb") == 0)
-			{
-				fputs(defConfigFile, f);
-				fclose(f);
-			}
+			fixGSOFont = embedded::FIX_GSO_FONT;
+			rules::ApplyRule(embedded::GSO_FONT, userGSOFont);
+			opts.debug = embedded::DEBUG_LOG;
+			opts.introspect = embedded::INTROSPECT;
+			opts.traceStartup = embedded::TRACE_STARTUP;
+			opts.prewarm = embedded::PREWARM;
+			opts.cacheMetrics = embedded::CACHE_METRICS;
+			opts.logSegmentSize = embedded::LOG_SEGMENT_SIZE;
+			opts.logGenerations = embedded::LOG_GENERATIONS;
 		}
+#endif
 
-		GSOFontMode fixGSOFont = DISABLED;
-		LOGFONT userGSOFont = {};
+		// The steps by what they need: settings and the user font scan run side by side, this thread
+		// may wait for them under the loader lock. They only read files and build tables in memory,
+		// everything else, GDI, USER and the registry included, stays on this thread.
+		startup::Graph graph;
+		auto loadSettings = Step(graph, "LoadSettings", [&] {
+			if (useEmbedded) return;
+			if (!fs::exists(configPath))
+			{
+				startupTrace.Begin("WriteDefaultConfig");
+				FILE* f;
+				if (_wfopen_s(&f, configPath.c_str(), L"wb") == 0)
+				{
+					fputs(defConfigFile, f);
+					fclose(f);
+				}
+				startupTrace.End();
+			}
 
-		wchar_t errMsg[512];
-		bool debug;
-		if (!LoadSettings(hModule, configPath, errMsg, fixGSOFont, userGSOFont, debug))
+			config::settings settings;
+			loaded = config::LoadSettings(configPath, errMsg, settings);
+			if (!loaded) return;
+			// lay the rules out by the hits of earlier runs
+			profiling = settings.opts.profileRules;
+			if (profiling) ruleProfile.Load(path/PROFILE_FILE);
+			ruleEngine.Build(settings.order, settings.fonts, profiling ? &ruleProfile : nullptr, &settings.chains);
+			if (settings.opts.profileCallers) callerTable = std::make_unique<callers::Table>();
+			fixGSOFont = settings.fixGSOFont;
+			userGSOFont = settings.userGSOFont;
+			opts = settings.opts;
+		}, {}, true);
+		auto scanFonts = Step(graph, "ScanUserFonts", [&] { ScanUserFonts(path, scan); }, {}, true);
+		auto openLog = Step(graph, "OpenLogFile", [&] {
+			if (!loaded) return;
+			if (opts.logSegmentSize) logSegmentSize = opts.logSegmentSize;
+			if (opts.logGenerations) logGenerations = opts.logGenerations;
+			if (opts.debug) OpenLogFile();
+		}, { loadSettings });
+		auto registerFonts = Step(graph, "RegisterUserFonts", [&] {
+			if (loaded) RegisterUserFonts(scan);
+		}, { scanFonts, openLog });
+		// the fingerprint covers the registered user fonts
+		auto enumCacheLoaded = Step(graph, "LoadEnumCache", [&] {
+			if (loaded && opts.cacheEnum) LoadEnumCache();
+		}, { registerFonts });
+		// `replace` lists choose among the installed fonts and those just registered
+		auto chainsResolved = Step(graph, "ResolveChains", [&] {
+			if (loaded) ResolveChains();
+		}, { loadSettings, openLog, registerFonts });
+		// fonts from fonts/ are in place before a hooked call can ask for them
+		Step(graph, "InstallHooks", [&] {
+			if (loaded) InstallHooks(fixGSOFont, userGSOFont, opts);
+		}, { loadSettings, openLog, registerFonts, enumCacheLoaded, chainsResolved });
+		graph.Run(SpawnStartupHelper, 1);
+
+		if (!loaded)
 		{
-			wchar_t msg[512];
-			swprintf_s(msg, L"LoadSettings error.\n%s", errMsg);
+			std::wstring msg;
+			Utf8ToUtf16("LoadSettings error.\n" + errMsg, msg);
 
 			SetThreadDpiAware();
-			MessageBoxW(0, msg, L"Error", MB_ICONERROR);
+			MessageBoxW(0, msg.c_str(), L"Error", MB_ICONERROR);
 			return true;
 		}
 
-		if (debug)
+		std::vector<startup::task_id> critical;
+		int64_t criticalNs = graph.CriticalPath(&critical);
+		startupCriticalUs = static_cast<uint64_t>(criticalNs / 1000);
+		startupTrace.Note("criticalPathUs", criticalNs / 1000.0);
+		if (auto log = logFile.load())
 		{
-			auto logPath = path/LOG_FILE;
-			logFile = _wfsopen(logPath.c_str(), L"a+", _SH_DENYWR);
-			setvbuf(logFile, nullptr, _IOLBF, BUFSIZ);
+			std::string chain;
+			for (auto i : critical)
+				chain += (chain.empty() ? "" : " > ") + std::string(graph.At(i).name);
+			log->Printf("[DllMain] startup steps took %lld us, critical path %lld us: %s\n",
+				static_cast<long long>(graph.Elapsed() / 1000), static_cast<long long>(criticalNs / 1000), chain.c_str());
 		}
 
-		LoadUserFonts(path);
+		procStats->initTimeUs.store(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - initStart).count(), std::memory_order_relaxed);
 
-		switch (fixGSOFont)
-		{
-		case USE_NCM_FONT:
+		if (opts.prewarm != PREWARM_OFF)
 		{
-			NONCLIENTMETRICSW ncm = { sizeof(ncm) };
-			if (SystemParametersInfoW(SPI_GETNONCLIENTMETRICS, sizeof(ncm), &ncm, 0))
-			{
-				newGSOFont = CreateFontIndirectW(&ncm.lfMessageFont);
-				if (logFile)
-				{
-					std::string name;
-					if (Utf16ToUtf8(ncm.lfMessageFont.lfFaceName, name))
-					{
-						fprintf_s(logFile, "[DllMain] SystemParametersInfo NONCLIENTMETRICS.lfMessageFont.lfFaceName=\"%s\"\n", name.c_str());
-					}
-				}
-			}
-			else if (logFile)
-			{
-				fprintf_s(logFile, "[DllMain] SystemParametersInfo failed. (%d)\n", GetLastError());
-			}
+			// the thread starts running once the loader lock is released and is never joined,
+			// so the module is pinned as for the font watcher
+			HMODULE self;
+			HANDLE thread = nullptr;
+			if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+				reinterpret_cast<LPCWSTR>(&PrewarmFonts), &self))
+				thread = CreateThread(nullptr, 0, PrewarmFonts, reinterpret_cast<LPVOID>(static_cast<uintptr_t>(opts.prewarm)), 0, nullptr);
+			if (thread)
+				CloseHandle(thread);
 		}
-		break;
-		case USE_USER_FONT:
+
+		if (enumCaching)
 		{
-			newGSOFont = CreateFontIndirectW(&userGSOFont);
-		}
-		break;
+			// pinned like the prewarm thread, its window lives until the process exits
+			HMODULE self;
+			HANDLE thread = nullptr;
+			if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+				reinterpret_cast<LPCWSTR>(&ListenFontChanges), &self))
+				thread = CreateThread(nullptr, 0, ListenFontChanges, self, 0, nullptr);
+			if (thread)
+				CloseHandle(thread);
 		}
 
-		HMODULE hGdi32 = GetModuleHandleW(L"gdi32.dll");
+		if (opts.watchFonts)
+		{
+			// the thread starts running once the loader lock is released
+			startupTrace.Begin("StartFontWatch");
+			StartFontWatch(scan);
+			startupTrace.End();
+		}
 
-		if (fixGSOFont != DISABLED)
+		if (opts.introspect)
 		{
-			auto pfnGetStockObject = GetProcAddress(hGdi32, "GetStockObject");
-			if (pfnGetStockObject)
-			{
-				InlineHook(pfnGetStockObject, MyGetStockObject, &addrGetStockObject);
-			}
+			startupTrace.Begin("StartIntrospection");
+			StartIntrospection();
+			startupTrace.End();
 		}
 
-		auto pfnCreateFontIndirectW = GetProcAddress(hGdi32, "CreateFontIndirectW");
-		if (pfnCreateFontIndirectW)
+		startupTrace.End(); // DllMain
+		if (opts.traceStartup)
 		{
-			InlineHook(pfnCreateFontIndirectW, MyCreateFontIndirectW, &addrCreateFontIndirectW);
+			WriteStartupTrace();
 		}
 	break;
 	case DLL_PROCESS_DETACH:
-		if (logFile)
-			fclose(logFile);
+		if (procStats != &localStats)
+			stats::SharedSegment::Release(procStats);
+		// at process exit the ExitProcess hook did this already, after FreeLibrary the other threads still run
+		if (!lpReserved)
+			FinishRun();
+		if (auto log = logFile.load(); log && origDeleteObject)
+		{
+			log->Printf("[DllMain] metrics cache hit rate %.1f%% over %llu calls\n", metricsCache.HitRate() * 100,
+				static_cast<unsigned long long>(metricsCache.Stats().hits.load() + metricsCache.Stats().misses.load()));
+		}
+		logFile = nullptr;
+		// never waits, at process exit for threads killed inside Append neither
+		logSink.Close();
 	break;
 	}
+	return TRUE;
 }
@@ -0,0 +1,596 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Font pack: many font files in one, each compressed on its own.
+//
+//   header | entry[count] | names (UTF-8) | data
+//
+// An entry gives a font's file and family name and where its zlib stream lives, so a
+// single open and one read of the index are enough to install every font, and each
+// is inflated into the buffer handed to AddFontMemResourceEx. All fields are little endian.
+// tools/fontpack builds and checks packs.
+namespace pack {
+
+constexpr char MAGIC[4] = { 'F', 'M', 'P', 'K' };
+constexpr uint32_t VERSION = 1;
+
+constexpr uint8_t METHOD_STORED = 0;
+constexpr uint8_t METHOD_ZLIB = 1;
+
+constexpr uint32_t MAX_FONT_SIZE = 256u << 20; // sanity bound for a damaged index
+
+struct header
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t namesSize;
+};
+static_assert(sizeof(header) == 16, "pack layout");
+
+struct entry
+{
+	uint64_t offset; // of the packed bytes from the start of the file
+	uint32_t packedSize;
+	uint32_t size;
+	uint32_t crc;    // CRC-32 of the font file
+	uint32_t nameOffset, familyOffset; // into names
+	uint16_t nameLen, familyLen;
+	uint8_t method;
+	uint8_t reserved[7];
+};
+static_assert(sizeof(entry) == 40, "pack layout");
+
+inline uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+	static const auto table = [] {
+		struct { uint32_t v[256]; } t = {};
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			t.v[i] = c;
+		}
+		return t;
+	}();
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table.v[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+// zlib (RFC 1950/1951) decoder, the DLL does not link zlib.
+// Huffman codes up to FAST_BITS long are decoded with one table lookup.
+namespace inflate {
+
+constexpr unsigned FAST_BITS = 10;
+constexpr unsigned MAX_BITS = 15;
+
+struct huffman
+{
+	uint16_t count[MAX_BITS + 1];
+	uint16_t symbol[288];
+	uint16_t fast[1 << FAST_BITS]; // length << 9 | symbol, 0 takes the slow path
+};
+
+class BitReader
+{
+public:
+	BitReader(const uint8_t* data, size_t size) : p(data), end(data + size), total(static_cast<uint64_t>(size) * 8) {}
+
+	uint32_t Peek(unsigned n)
+	{
+		Refill();
+		return static_cast<uint32_t>(bits & ((1ull << n) - 1));
+	}
+
+	void Drop(unsigned n)
+	{
+		bits >>= n;
+		have -= n;
+		used += n;
+	}
+
+	uint32_t Bits(unsigned n)
+	{
+		uint32_t v = Peek(n);
+		Drop(n);
+		return v;
+	}
+
+	void AlignToByte() { Drop(have % 8); }
+
+	// Whole bytes, only valid after AlignToByte
+	bool Bytes(uint8_t* out, size_t n)
+	{
+		while (n && have)
+		{
+			*out++ = static_cast<uint8_t>(Bits(8));
+			--n;
+		}
+		if (static_cast<size_t>(end - p) < n) return false;
+		memcpy(out, p, n);
+		p += n;
+		used += static_cast<uint64_t>(n) * 8;
+		return Ok();
+	}
+
+	// False once more bits were taken than the input has
+	bool Ok() const { return used <= total; }
+
+private:
+	const uint8_t* p;
+	const uint8_t* end;
+	uint64_t bits = 0;
+	unsigned have = 0;
+	uint64_t used = 0, total;
+
+	void Refill()
+	{
+		while (have <= 56)
+		{
+			if (p < end) bits |= static_cast<uint64_t>(*p++) << have;
+			have += 8; // zeros past the end, caught by Ok()
+		}
+	}
+};
+
+inline bool Build(huffman& h, const uint8_t* lengths, size_t n)
+{
+	memset(h.count, 0, sizeof(h.count));
+	memset(h.fast, 0, sizeof(h.fast));
+	for (size_t i = 0; i < n; ++i)
+		++h.count[lengths[i]];
+	if (h.count[0] == n) return true; // no codes, any use fails
+
+	int left = 1;
+	for (unsigned len = 1; len <= MAX_BITS; ++len)
+	{
+		left = (left << 1) - h.count[len];
+		if (left < 0) return false; // over-subscribed
+	}
+
+	uint16_t offs[MAX_BITS + 2] = {};
+	for (unsigned len = 1; len <= MAX_BITS; ++len)
+		offs[len + 1] = offs[len] + h.count[len];
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (lengths[i]) h.symbol[offs[lengths[i]]++] = static_cast<uint16_t>(i);
+	}
+
+	// canonical codes are read MSB first, the lookup is indexed by the next bits LSB first
+	uint32_t code = 0;
+	size_t index = 0;
+	for (unsigned len = 1; len <= FAST_BITS; ++len)
+	{
+		for (unsigned k = 0; k < h.count[len]; ++k, ++code, ++index)
+		{
+			uint32_t rev = 0;
+			for (unsigned b = 0; b < len; ++b)
+				rev |= ((code >> b) & 1) << (len - 1 - b);
+			for (uint32_t j = rev; j < (1u << FAST_BITS); j += 1u << len)
+				h.fast[j] = static_cast<uint16_t>(len << 9 | h.symbol[index]);
+		}
+		code <<= 1;
+	}
+	return true;
+}
+
+// Symbol or -1 for an invalid code
+inline int Decode(BitReader& in, const huffman& h)
+{
+	uint32_t next = in.Peek(MAX_BITS);
+	if (uint16_t e = h.fast[next & ((1u << FAST_BITS) - 1)])
+	{
+		in.Drop(e >> 9);
+		return e & 0x1FF;
+	}
+	int code = 0, first = 0, index = 0;
+	for (unsigned len = 1; len <= MAX_BITS; ++len)
+	{
+		code |= (next >> (len - 1)) & 1;
+		int count = h.count[len];
+		if (code - count < first)
+		{
+			in.Drop(len);
+			return h.symbol[index + (code - first)];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+inline bool Codes(BitReader& in, uint8_t* out, size_t size, size_t& pos, const huffman& lit, const huffman& dist)
+{
+	static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const uint16_t distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const uint8_t distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	for (;;)
+	{
+		int sym = Decode(in, lit);
+		if (sym < 0 || !in.Ok()) return false;
+		if (sym < 256)
+		{
+			if (pos == size) return false;
+			out[pos++] = static_cast<uint8_t>(sym);
+			continue;
+		}
+		if (sym == 256) return true;
+
+		sym -= 257;
+		if (sym >= 29) return false;
+		size_t len = lengthBase[sym] + in.Bits(lengthExtra[sym]);
+		int d = Decode(in, dist);
+		if (d < 0 || d >= 30) return false;
+		size_t back = distBase[d] + in.Bits(distExtra[d]);
+		if (back > pos || len > size - pos) return false;
+
+		const uint8_t* from = out + pos - back;
+		uint8_t* to = out + pos;
+		pos += len;
+		if (back >= len)
+		{
+			memcpy(to, from, len);
+		}
+		else
+		{
+			while (len--) *to++ = *from++; // overlapping run
+		}
+	}
+}
+
+inline bool Dynamic(BitReader& in, huffman& lit, huffman& dist)
+{
+	static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+	size_t nlen = in.Bits(5) + 257, ndist = in.Bits(5) + 1, ncode = in.Bits(4) + 4;
+	if (nlen > 286 || ndist > 30) return false;
+
+	uint8_t lengths[320] = {};
+	for (size_t i = 0; i < ncode; ++i)
+		lengths[order[i]] = static_cast<uint8_t>(in.Bits(3));
+	huffman lencode;
+	if (!Build(lencode, lengths, 19)) return false;
+
+	memset(lengths, 0, sizeof(lengths));
+	for (size_t i = 0; i < nlen + ndist;)
+	{
+		int sym = Decode(in, lencode);
+		if (sym < 0 || !in.Ok()) return false;
+		if (sym < 16)
+		{
+			lengths[i++] = static_cast<uint8_t>(sym);
+			continue;
+		}
+		uint8_t value = 0;
+		size_t repeat;
+		if (sym == 16)
+		{
+			if (i == 0) return false;
+			value = lengths[i - 1];
+			repeat = 3 + in.Bits(2);
+		}
+		else if (sym == 17)
+		{
+			repeat = 3 + in.Bits(3);
+		}
+		else
+		{
+			repeat = 11 + in.Bits(7);
+		}
+		if (i + repeat > nlen + ndist) return false;
+		while (repeat--) lengths[i++] = value;
+	}
+	if (lengths[256] == 0) return false; // no end of block code
+
+	return Build(lit, lengths, nlen) && Build(dist, lengths + nlen, ndist);
+}
+
+// Inflates a zlib stream of exactly `size` bytes into `out`
+inline bool Zlib(const uint8_t* data, size_t dataSize, uint8_t* out, size_t size)
+{
+	if (dataSize < 6) return false;
+	uint8_t cmf = data[0], flg = data[1];
+	if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || (cmf << 8 | flg) % 31 || (flg & 0x20)) return false;
+
+	BitReader in(data + 2, dataSize - 2);
+	size_t pos = 0;
+	bool last;
+	do
+	{
+		last = in.Bits(1);
+		switch (in.Bits(2))
+		{
+		case 0:
+		{
+			in.AlignToByte();
+			uint32_t len = in.Bits(16), nlen = in.Bits(16);
+			if (len != (~nlen & 0xFFFF) || len > size - pos || !in.Bytes(out + pos, len)) return false;
+			pos += len;
+			break;
+		}
+		case 1:
+		{
+			static const auto fixed = [] {
+				struct { huffman lit, dist; bool ok; } f;
+				uint8_t lengths[288 + 30];
+				memset(lengths, 8, 144);
+				memset(lengths + 144, 9, 112);
+				memset(lengths + 256, 7, 24);
+				memset(lengths + 280, 8, 8);
+				memset(lengths + 288, 5, 30);
+				f.ok = Build(f.lit, lengths, 288) && Build(f.dist, lengths + 288, 30);
+				return f;
+			}();
+			if (!fixed.ok || !Codes(in, out, size, pos, fixed.lit, fixed.dist)) return false;
+			break;
+		}
+		case 2:
+		{
+			huffman lit, dist;
+			if (!Dynamic(in, lit, dist) || !Codes(in, out, size, pos, lit, dist)) return false;
+			break;
+		}
+		default:
+			return false;
+		}
+	} while (!last);
+
+	in.AlignToByte();
+	uint32_t adler = 0;
+	for (int i = 0; i < 4; ++i)
+		adler = adler << 8 | in.Bits(8);
+	if (!in.Ok() || pos != size) return false;
+
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < size;)
+	{
+		for (size_t n = std::min<size_t>(size - i, 5552); n--; ++i) // largest run before the sums overflow
+		{
+			a += out[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return adler == (b << 16 | a);
+}
+
+} // namespace inflate
+
+class Reader
+{
+public:
+	Reader() = default;
+	Reader(const Reader&) = delete;
+	Reader& operator=(const Reader&) = delete;
+	~Reader() { Close(); }
+
+	// Reads and checks the index, the fonts stay on disk until Extract
+	bool Open(const std::filesystem::path& path)
+	{
+		Close();
+#ifdef _WIN32
+		if (_wfopen_s(&file, path.c_str(), L"rb") != 0) file = nullptr;
+#else
+		file = fopen(path.c_str(), "rb");
+#endif
+		if (!file) return false;
+
+		header h;
+		if (!Read(0, &h, sizeof(h)) || memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION
+			|| h.count > (1u << 16) || h.namesSize > (16u << 20))
+		{
+			Close();
+			return false;
+		}
+		entries.resize(h.count);
+		names.resize(h.namesSize);
+		if (!Read(sizeof(h), entries.data(), entries.size() * sizeof(entry))
+			|| !Read(sizeof(h) + entries.size() * sizeof(entry), names.data(), names.size()))
+		{
+			Close();
+			return false;
+		}
+		for (auto& e : entries)
+		{
+			if (static_cast<uint64_t>(e.nameOffset) + e.nameLen > names.size()
+				|| static_cast<uint64_t>(e.familyOffset) + e.familyLen > names.size())
+			{
+				Close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Close()
+	{
+		if (file) fclose(file);
+		file = nullptr;
+		entries.clear();
+		names.clear();
+	}
+
+	size_t Count() const { return entries.size(); }
+	const entry& At(size_t i) const { return entries[i]; }
+	std::string_view Name(size_t i) const { return { names.data() + entries[i].nameOffset, entries[i].nameLen }; }
+	std::string_view Family(size_t i) const { return { names.data() + entries[i].familyOffset, entries[i].familyLen }; }
+
+	// Inflates font `i` into `out`, which is reused between calls; false if it is damaged
+	bool Extract(size_t i, std::vector<uint8_t>& out)
+	{
+		const entry& e = entries[i];
+		if (e.size > MAX_FONT_SIZE || e.packedSize > MAX_FONT_SIZE) return false;
+		out.resize(e.size);
+		if (e.method == METHOD_STORED)
+		{
+			if (e.packedSize != e.size || !Read(e.offset, out.data(), e.size)) return false;
+		}
+		else if (e.method == METHOD_ZLIB)
+		{
+			packed.resize(e.packedSize);
+			if (!Read(e.offset, packed.data(), packed.size())) return false;
+			if (!inflate::Zlib(packed.data(), packed.size(), out.data(), out.size())) return false;
+		}
+		else
+		{
+			return false;
+		}
+		return Crc32(out.data(), out.size()) == e.crc;
+	}
+
+private:
+	FILE* file = nullptr;
+	std::vector<entry> entries;
+	std::vector<char> names;
+	std::vector<uint8_t> packed;
+
+	bool Read(uint64_t offset, void* out, size_t size)
+	{
+		if (size == 0) return true;
+#ifdef _WIN32
+		if (_fseeki64(file, static_cast<int64_t>(offset), SEEK_SET) != 0) return false;
+#else
+		if (fseeko(file, static_cast<off_t>(offset), SEEK_SET) != 0) return false;
+#endif
+		return fread(out, 1, size, file) == size;
+	}
+};
+
+// The entries of a pack by family, installed the first time their family is asked for, so a start
+// only reads the index. Install runs `install(i)` once for every entry of the family, a thread asking
+// for a family while another installs it waits until it is done. Families compare without ASCII case.
+// Every entry is added, then Seal lays the families out sorted: lookups search that array without a
+// lock, which is only taken for a family found and still pending.
+class LazyFamilies
+{
+public:
+	void Add(std::wstring_view family, size_t i)
+	{
+		auto& f = building[Fold(family)];
+		if (f.name.empty()) f.name = family;
+		f.entries.push_back(i);
+	}
+
+	// Before the first lookup, Add may not be called after
+	void Seal()
+	{
+		sealed = std::vector<family>(building.size());
+		size_t n = 0;
+		for (auto& [key, b] : building)
+		{
+			auto& f = sealed[n++];
+			f.key = key;
+			f.name = std::move(b.name);
+			f.entries = std::move(b.entries);
+		}
+		building.clear();
+		pending.store(sealed.size(), std::memory_order_release);
+	}
+
+	// False once every family is installed, the one check on the hot path
+	bool Pending() const { return pending.load(std::memory_order_acquire) != 0; }
+
+	// Entries installed, 0 if the pack has no such family or it was installed before
+	template <typename F>
+	size_t Install(std::wstring_view face, F install)
+	{
+		if (!Pending()) return 0;
+		auto it = std::lower_bound(sealed.begin(), sealed.end(), face, [](const family& f, std::wstring_view v) { return Compare(f.key, v) < 0; });
+		if (it == sealed.end() || Compare(it->key, face) != 0 || it->installed.load(std::memory_order_acquire)) return 0;
+		std::lock_guard<std::mutex> hold(lock);
+		return Take(*it, install);
+	}
+
+	// Names of the families not installed yet, as the pack spells them
+	std::vector<std::wstring> PendingNames() const
+	{
+		std::vector<std::wstring> names;
+		for (auto& f : sealed)
+		{
+			if (!f.installed.load(std::memory_order_acquire)) names.push_back(f.name);
+		}
+		return names;
+	}
+
+	size_t Size() const { return sealed.size(); }
+
+private:
+	struct pendingFamily
+	{
+		std::wstring name;
+		std::vector<size_t> entries;
+	};
+
+	struct family
+	{
+		std::wstring key; // folded
+		std::wstring name;
+		std::vector<size_t> entries; // emptied under the lock once installed
+		std::atomic<bool> installed{ false };
+	};
+
+	std::map<std::wstring, pendingFamily> building; // by folded name, until Seal
+	std::vector<family> sealed;                     // by folded name, never changes after Seal
+	std::mutex lock;
+	std::atomic<size_t> pending{ 0 };               // families with entries left
+
+	static wchar_t FoldChar(wchar_t c) { return c >= L'A' && c <= L'Z' ? static_cast<wchar_t>(c - L'A' + L'a') : c; }
+
+	static std::wstring Fold(std::wstring_view s)
+	{
+		std::wstring r(s);
+		for (auto& c : r)
+			c = FoldChar(c);
+		return r;
+	}
+
+	// `key` folded against `face` folded on the fly, nothing allocated
+	static int Compare(const std::wstring& key, std::wstring_view face)
+	{
+		size_t n = std::min(key.size(), face.size());
+		for (size_t i = 0; i < n; ++i)
+		{
+			wchar_t c = FoldChar(face[i]);
+			if (key[i] != c) return key[i] < c ? -1 : 1;
+		}
+		return key.size() == face.size() ? 0 : key.size() < face.size() ? -1 : 1;
+	}
+
+	template <typename F>
+	size_t Take(family& f, F& install)
+	{
+		if (f.entries.empty()) return 0;
+		auto entries = std::move(f.entries);
+		f.entries.clear();
+		for (size_t i : entries)
+			install(i);
+		// readers of Pending() and of the flag see the fonts in place
+		f.installed.store(true, std::memory_order_release);
+		pending.fetch_sub(1, std::memory_order_release);
+		return entries.size();
+	}
+};
+
+} // namespace pack
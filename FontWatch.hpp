@@ -0,0 +1,318 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+
+// Keeps the fonts registered from a directory in step with its files while the program runs.
+// A change notification only says something happened: the directory is listed again and
+// compared with the last known (path, size, time) of every file, so only added or changed
+// files are registered and only removed ones unregistered.
+namespace fontwatch {
+
+namespace fs = std::filesystem;
+
+struct fileState
+{
+	uint64_t size;
+	int64_t mtime; // file clock ticks
+
+	bool operator==(const fileState& other) const { return size == other.size && mtime == other.mtime; }
+	bool operator!=(const fileState& other) const { return !(*this == other); }
+};
+
+using snapshot = std::map<fs::path, fileState>;
+
+inline bool Stat(const fs::path& path, fileState& state)
+{
+	std::error_code ec;
+	state.size = fs::file_size(path, ec);
+	if (ec) return false;
+	state.mtime = static_cast<int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+	return !ec;
+}
+
+// Every file in `dir`, not descending, as the startup scan lists them
+inline snapshot Scan(const fs::path& dir)
+{
+	snapshot files;
+	std::error_code ec;
+	for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+	{
+		fileState state;
+		if (!it->is_directory(ec) && Stat(it->path(), state))
+			files.emplace(it->path(), state);
+	}
+	return files;
+}
+
+struct changes
+{
+	std::vector<fs::path> added, changed, removed;
+
+	bool Empty() const { return added.empty() && changed.empty() && removed.empty(); }
+};
+
+inline changes Diff(const snapshot& before, const snapshot& after)
+{
+	changes d;
+	auto b = before.begin();
+	auto a = after.begin();
+	while (b != before.end() || a != after.end())
+	{
+		if (a == after.end() || (b != before.end() && b->first < a->first))
+		{
+			d.removed.push_back((b++)->first);
+		}
+		else if (b == before.end() || a->first < b->first)
+		{
+			d.added.push_back((a++)->first);
+		}
+		else
+		{
+			if (a->second != b->second) d.changed.push_back(a->first);
+			++a;
+			++b;
+		}
+	}
+	return d;
+}
+
+// The fonts of a directory as registered. `add` and `remove` stand for AddFontResourceExW
+// and RemoveFontResourceExW. A file that failed to register is not tried again until it changes.
+class Registry
+{
+public:
+	using registerFn = std::function<bool(const fs::path&)>;
+
+	Registry(registerFn add, registerFn remove) : add(std::move(add)), remove(std::move(remove)) {}
+
+	// Files registered before watching started, `ok` false for those that failed
+	void Seed(const fs::path& path, const fileState& state, bool ok)
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		known[path] = { state, ok };
+	}
+
+	// Brings the registered fonts to the directory listing `now`
+	changes Sync(const snapshot& now)
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		snapshot before;
+		for (auto& k : known)
+			before.emplace(k.first, k.second.state);
+		changes d = Diff(before, now);
+		for (auto& path : d.removed)
+		{
+			if (known[path].registered) remove(path);
+			known.erase(path);
+		}
+		for (auto& path : d.changed)
+		{
+			// GDI would keep the old font under the same path
+			auto& k = known[path];
+			if (k.registered) remove(path);
+			k = { now.at(path), add(path) };
+		}
+		for (auto& path : d.added)
+			known[path] = { now.at(path), add(path) };
+		return d;
+	}
+
+	size_t Registered() const
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		size_t n = 0;
+		for (auto& k : known)
+			n += k.second.registered;
+		return n;
+	}
+
+private:
+	struct entry
+	{
+		fileState state;
+		bool registered;
+	};
+
+	mutable std::mutex lock;
+	std::map<fs::path, entry> known;
+	registerFn add, remove;
+};
+
+// Calls `changed` on its own thread once the files of a directory were added, removed or
+// written and nothing else happened for `settle`, so a font still being copied is not read half.
+// Other systems than Windows and Linux look every few seconds. On Windows the thread is
+// created with CreateThread, which Start may call from DllMain.
+class Watcher
+{
+public:
+	Watcher() = default;
+	Watcher(const Watcher&) = delete;
+	Watcher& operator=(const Watcher&) = delete;
+	~Watcher() { Stop(); }
+
+	bool Start(const fs::path& dir, std::chrono::milliseconds settle, std::function<void()> changed)
+	{
+		if (Running()) return false;
+		this->settle = settle;
+		this->changed = std::move(changed);
+#ifdef _WIN32
+		notification = FindFirstChangeNotificationW(dir.c_str(), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+		if (notification == INVALID_HANDLE_VALUE) return false;
+		stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (!stop)
+		{
+			FindCloseChangeNotification(notification);
+			return false;
+		}
+#else
+		if (pipe(stopPipe) != 0) return false;
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_MODIFY) < 0)
+		{
+			Close();
+			return false;
+		}
+#else
+		std::error_code ec;
+		if (!fs::is_directory(dir, ec))
+		{
+			Close();
+			return false;
+		}
+#endif
+#endif
+#ifdef _WIN32
+		thread = CreateThread(nullptr, 0, [](LPVOID self) -> DWORD { static_cast<Watcher*>(self)->Run(); return 0; }, this, 0, nullptr);
+		if (!thread)
+		{
+			Close();
+			return false;
+		}
+#else
+		thread = std::thread([this] { Run(); });
+#endif
+		return true;
+	}
+
+	// Waits for a running `changed` to return
+	void Stop()
+	{
+		if (!Running()) return;
+#ifdef _WIN32
+		SetEvent(stop);
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+		thread = nullptr;
+#else
+		char b = 0;
+		(void)!write(stopPipe[1], &b, 1);
+		thread.join();
+#endif
+		Close();
+	}
+
+private:
+	std::chrono::milliseconds settle{ 0 };
+	std::function<void()> changed;
+#ifdef _WIN32
+	HANDLE thread = nullptr;
+	HANDLE notification = INVALID_HANDLE_VALUE;
+	HANDLE stop = nullptr;
+#else
+	std::thread thread;
+	int stopPipe[2] = { -1, -1 };
+	int fd = -1; // inotify
+#endif
+
+	bool Running() const
+	{
+#ifdef _WIN32
+		return thread != nullptr;
+#else
+		return thread.joinable();
+#endif
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (notification != INVALID_HANDLE_VALUE) FindCloseChangeNotification(notification);
+		if (stop) CloseHandle(stop);
+		notification = INVALID_HANDLE_VALUE;
+		stop = nullptr;
+#else
+		for (int* f : { &stopPipe[0], &stopPipe[1], &fd })
+		{
+			if (*f >= 0) close(*f);
+			*f = -1;
+		}
+#endif
+	}
+
+	enum wake { STOPPED, CHANGED, QUIET };
+
+	// Waits up to `timeout`, or forever if negative
+	wake Wait(std::chrono::milliseconds timeout)
+	{
+#ifdef _WIN32
+		HANDLE handles[2] = { stop, notification };
+		DWORD r = WaitForMultipleObjects(2, handles, FALSE, timeout.count() < 0 ? INFINITE : static_cast<DWORD>(timeout.count()));
+		if (r == WAIT_OBJECT_0 + 1)
+		{
+			FindNextChangeNotification(notification);
+			return CHANGED;
+		}
+		return r == WAIT_TIMEOUT ? QUIET : STOPPED;
+#else
+		pollfd fds[2] = { { stopPipe[0], POLLIN, 0 }, { fd, POLLIN, 0 } };
+		int r = poll(fds, fd >= 0 ? 2 : 1, static_cast<int>(timeout.count()));
+		if (r < 0) return STOPPED;
+		if (r == 0) return fd >= 0 ? QUIET : CHANGED; // without inotify every timeout is a look
+		if (fds[0].revents) return STOPPED;
+#ifdef __linux__
+		char events[4096];
+		while (read(fd, events, sizeof(events)) > 0) {}
+#endif
+		return CHANGED;
+#endif
+	}
+
+	void Run()
+	{
+		auto idle = std::chrono::milliseconds(-1);
+#if !defined(_WIN32) && !defined(__linux__)
+		idle = std::chrono::milliseconds(3000);
+#endif
+		for (;;)
+		{
+			wake w = Wait(idle);
+			if (w == STOPPED) return;
+			if (w == QUIET) continue;
+			while ((w = Wait(settle)) == CHANGED) {}
+			if (w == STOPPED) return;
+			changed();
+		}
+	}
+};
+
+} // namespace fontwatch
@@ -0,0 +1,721 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Inline hook engine.
+// The decoder and relocator below only work on byte buffers and plain addresses,
+// the Windows part (trampoline arena and patch transaction) is at the end of file.
+namespace hook {
+
+enum class Arch { x86, x64 };
+
+#if defined(_M_X64) || defined(__x86_64__)
+constexpr Arch NATIVE_ARCH = Arch::x64;
+#else
+constexpr Arch NATIVE_ARCH = Arch::x86;
+#endif
+
+// Size of the patch written over the target prologue: jmp rel32
+constexpr size_t PATCH_SIZE = 5;
+// Worst case of relocating one instruction is a jcc rewritten to an absolute jump
+constexpr size_t MAX_RELOCATED_INSN = 16;
+constexpr size_t MAX_INSN = 15;
+
+enum insnKind : uint8_t
+{
+	INSN_PLAIN,
+	INSN_JMP,     // EB/E9, unconditional relative jump
+	INSN_CALL,    // E8, relative call
+	INSN_JCC,     // 7x/0F 8x, conditional relative jump
+	INSN_LOOP,    // E0-E3, rel8 only forms which can not be widened
+	INSN_RET,     // C2/C3/CA/CB
+	INSN_INVALID
+};
+
+struct insn
+{
+	uint8_t length;
+	insnKind kind;
+	uint8_t relOffset;  // offset of rel8/rel32 field for branches
+	uint8_t relSize;
+	uint8_t dispOffset; // offset of disp32 for RIP-relative operands, 0 if none
+	uint8_t cond;       // low nibble of jcc opcode
+	bool ripRelative;
+};
+
+namespace detail {
+
+// One-byte opcode map: bit0 = has ModRM, bits1-3 = immediate kind
+enum : uint8_t { M = 1, I8 = 2, IZ = 4, I16 = 6, I16_8 = 8, IMOFFS = 10, IFAR = 12, BAD = 14 };
+
+constexpr uint8_t ONE_BYTE[256] = {
+	//0     1      2      3      4      5      6      7      8      9      A      B      C      D      E      F
+	M,     M,     M,     M,     I8,    IZ,    0,     0,     M,     M,     M,     M,     I8,    IZ,    0,     0,     // 0x
+	M,     M,     M,     M,     I8,    IZ,    0,     0,     M,     M,     M,     M,     I8,    IZ,    0,     0,     // 1x
+	M,     M,     M,     M,     I8,    IZ,    0,     0,     M,     M,     M,     M,     I8,    IZ,    0,     0,     // 2x
+	M,     M,     M,     M,     I8,    IZ,    0,     0,     M,     M,     M,     M,     I8,    IZ,    0,     0,     // 3x
+	0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     // 4x
+	0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     // 5x
+	0,     0,     M,     M,     0,     0,     0,     0,     IZ,    M|IZ,  I8,    M|I8,  0,     0,     0,     0,     // 6x
+	I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    // 7x
+	M|I8,  M|IZ,  M|I8,  M|I8,  M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     M,     // 8x
+	0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     IFAR,  0,     0,     0,     0,     0,     // 9x
+	IMOFFS,IMOFFS,IMOFFS,IMOFFS,0,     0,     0,     0,     I8,    IZ,    0,     0,     0,     0,     0,     0,     // Ax
+	I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    IZ,    IZ,    IZ,    IZ,    IZ,    IZ,    IZ,    IZ,    // Bx
+	M|I8,  M|I8,  I16,   0,     M,     M,     M|I8,  M|IZ,  I16_8, 0,     I16,   0,     0,     I8,    0,     0,     // Cx
+	M,     M,     M,     M,     I8,    I8,    BAD,   0,     M,     M,     M,     M,     M,     M,     M,     M,     // Dx
+	I8,    I8,    I8,    I8,    I8,    I8,    I8,    I8,    IZ,    IZ,    IFAR,  I8,    0,     0,     0,     0,     // Ex
+	0,     BAD,   0,     0,     0,     0,     M,     M,     0,     0,     0,     0,     0,     0,     M,     M,     // Fx
+};
+
+constexpr bool IsPrefix(uint8_t b)
+{
+	switch (b)
+	{
+	case 0xF0: case 0xF2: case 0xF3:
+	case 0x2E: case 0x36: case 0x3E: case 0x26: case 0x64: case 0x65:
+	case 0x66: case 0x67:
+		return true;
+	}
+	return false;
+}
+
+// 0F xx map, true if the opcode has no ModRM byte
+constexpr bool TwoByteNoModRM(uint8_t op)
+{
+	return (op >= 0x05 && op <= 0x09) || op == 0x0B || op == 0x0E ||
+		(op >= 0x30 && op <= 0x37) || op == 0x77 ||
+		(op >= 0x80 && op <= 0x8F) || (op >= 0xA0 && op <= 0xA2) ||
+		(op >= 0xA8 && op <= 0xAA) || (op >= 0xC8 && op <= 0xCF);
+}
+
+// 0F xx map, true if the opcode takes an imm8 after ModRM
+constexpr bool TwoByteImm8(uint8_t op)
+{
+	return (op >= 0x70 && op <= 0x73) || op == 0xA4 || op == 0xAC ||
+		op == 0xBA || op == 0xC2 || (op >= 0xC4 && op <= 0xC6) || op == 0x0F;
+}
+
+// Returns length of ModRM + SIB + displacement, 0 on truncated input
+inline size_t ModRMLength(const uint8_t* p, size_t avail, bool addr16, bool x64, insn& out, size_t modrmOffset)
+{
+	if (avail < 1) return 0;
+	uint8_t modrm = p[0];
+	uint8_t mod = modrm >> 6, rm = modrm & 7;
+	size_t len = 1;
+	if (mod == 3) return len;
+
+	if (addr16)
+	{
+		if (mod == 0 && rm == 6) len += 2;
+		else if (mod == 1) len += 1;
+		else if (mod == 2) len += 2;
+		return len <= avail ? len : 0;
+	}
+
+	if (rm == 4)
+	{
+		if (avail < 2) return 0;
+		uint8_t base = p[1] & 7;
+		len += 1;
+		if (mod == 0 && base == 5) len += 4;
+	}
+	else if (mod == 0 && rm == 5)
+	{
+		if (x64)
+		{
+			out.ripRelative = true;
+			out.dispOffset = static_cast<uint8_t>(modrmOffset + len);
+		}
+		len += 4;
+	}
+	if (mod == 1) len += 1;
+	else if (mod == 2) len += 4;
+	return len <= avail ? len : 0;
+}
+
+} // namespace detail
+
+// Decode length and branch information of one instruction.
+// Returns false on invalid or truncated input.
+inline bool Decode(const uint8_t* code, size_t avail, Arch arch, insn& out)
+{
+	using namespace detail;
+	out = {};
+	out.kind = INSN_INVALID;
+	const bool x64 = arch == Arch::x64;
+	if (avail > MAX_INSN) avail = MAX_INSN;
+
+	size_t i = 0;
+	bool opsize16 = false, addr16 = false, rexW = false;
+	while (i < avail && IsPrefix(code[i]))
+	{
+		if (code[i] == 0x66) opsize16 = true;
+		if (code[i] == 0x67) addr16 = true;
+		++i;
+	}
+	if (x64 && i < avail && (code[i] & 0xF0) == 0x40)
+	{
+		rexW = (code[i] & 8) != 0;
+		++i;
+	}
+	if (i >= avail) return false;
+
+	const size_t immZ = opsize16 ? 2 : 4;
+	// In long mode 0x67 selects 32-bit addressing, never 16-bit
+	const bool modrm16 = addr16 && !x64;
+	uint8_t op = code[i++];
+	size_t imm = 0;
+	bool hasModRM = false;
+	size_t modrmAt = 0;
+
+	if (op == 0x0F)
+	{
+		if (i >= avail) return false;
+		uint8_t op2 = code[i++];
+		if (op2 == 0x38 || op2 == 0x3A)
+		{
+			if (i >= avail) return false;
+			++i;
+			hasModRM = true;
+			if (op2 == 0x3A) imm = 1;
+		}
+		else if (op2 >= 0x80 && op2 <= 0x8F)
+		{
+			out.kind = INSN_JCC;
+			out.cond = op2 & 0x0F;
+			out.relOffset = static_cast<uint8_t>(i);
+			out.relSize = static_cast<uint8_t>(x64 ? 4 : immZ);
+			imm = out.relSize;
+		}
+		else
+		{
+			hasModRM = !TwoByteNoModRM(op2);
+			if (TwoByteImm8(op2)) imm = 1;
+		}
+	}
+	else if ((op == 0xC4 || op == 0xC5) && (x64 || (i < avail && (code[i] & 0xC0) == 0xC0)))
+	{
+		// VEX
+		uint8_t map = 1;
+		if (op == 0xC4)
+		{
+			if (i + 2 > avail) return false;
+			map = code[i] & 0x1F;
+			i += 2;
+		}
+		else
+		{
+			++i;
+		}
+		if (i >= avail) return false;
+		uint8_t vop = code[i++];
+		hasModRM = !(map == 1 && vop == 0x77); // vzeroupper/vzeroall
+		if (map == 3 || (map == 1 && TwoByteImm8(vop))) imm = 1;
+	}
+	else if (op == 0x62 && x64)
+	{
+		// EVEX
+		if (i + 4 > avail) return false;
+		uint8_t map = code[i] & 3;
+		uint8_t eop = code[i + 3];
+		i += 4; // P0 P1 P2 opcode
+		hasModRM = true;
+		if (map == 3 || (map == 1 && TwoByteImm8(eop))) imm = 1;
+	}
+	else
+	{
+		uint8_t info = ONE_BYTE[op];
+		hasModRM = (info & M) != 0;
+		switch (info & ~M)
+		{
+		case I8: imm = 1; break;
+		case IZ: imm = immZ; break;
+		case I16: imm = 2; break;
+		case I16_8: imm = 3; break;
+		case IMOFFS: imm = x64 ? (addr16 ? 4 : 8) : (addr16 ? 2 : 4); break;
+		case IFAR:
+			if (x64) return false;
+			imm = 2 + immZ;
+			break;
+		case BAD: return false;
+		}
+
+		if (op >= 0xB8 && op <= 0xBF && rexW) imm = 8;
+		if (x64 && (op == 0x06 || op == 0x07 || op == 0x0E || op == 0x16 || op == 0x17 || op == 0x1E || op == 0x1F ||
+			op == 0x27 || op == 0x2F || op == 0x37 || op == 0x3F || op == 0x60 || op == 0x61 || op == 0x82 ||
+			op == 0xCE || op == 0xD4 || op == 0xD5))
+		{
+			return false;
+		}
+
+		if (op >= 0x70 && op <= 0x7F)
+		{
+			out.kind = INSN_JCC;
+			out.cond = op & 0x0F;
+		}
+		else if (op == 0xEB || op == 0xE9)
+		{
+			out.kind = INSN_JMP;
+		}
+		else if (op == 0xE8)
+		{
+			out.kind = INSN_CALL;
+		}
+		else if (op >= 0xE0 && op <= 0xE3)
+		{
+			out.kind = INSN_LOOP;
+		}
+		else if (op == 0xC2 || op == 0xC3 || op == 0xCA || op == 0xCB)
+		{
+			out.kind = INSN_RET;
+		}
+
+		if (out.kind == INSN_JCC || out.kind == INSN_JMP || out.kind == INSN_CALL || out.kind == INSN_LOOP)
+		{
+			if ((op == 0xE8 || op == 0xE9) && x64) imm = 4; // 0x66 is ignored for near branches in long mode
+			out.relOffset = static_cast<uint8_t>(i);
+			out.relSize = static_cast<uint8_t>(imm);
+		}
+
+		// test r/m, imm is the only group 3 member with an immediate
+		if ((op == 0xF6 || op == 0xF7) && i < avail && ((code[i] >> 3) & 7) < 2)
+			imm = op == 0xF6 ? 1 : immZ;
+	}
+
+	if (hasModRM)
+	{
+		modrmAt = i;
+		size_t n = ModRMLength(code + i, avail - i, modrm16, x64, out, modrmAt);
+		if (n == 0) return false;
+		i += n;
+	}
+
+	i += imm;
+	if (i > avail) return false;
+	out.length = static_cast<uint8_t>(i);
+	if (out.kind == INSN_INVALID) out.kind = INSN_PLAIN;
+	return true;
+}
+
+namespace detail {
+
+inline void Put32(std::vector<uint8_t>& out, int32_t v)
+{
+	uint8_t b[4];
+	memcpy(b, &v, 4);
+	out.insert(out.end(), b, b + 4);
+}
+
+inline void Put64(std::vector<uint8_t>& out, uint64_t v)
+{
+	uint8_t b[8];
+	memcpy(b, &v, 8);
+	out.insert(out.end(), b, b + 8);
+}
+
+inline bool FitsRel32(int64_t v)
+{
+	return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+inline int64_t ReadRel(const uint8_t* p, size_t size)
+{
+	if (size == 1) return static_cast<int8_t>(p[0]);
+	if (size == 2) { int16_t v; memcpy(&v, p, 2); return v; }
+	int32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+} // namespace detail
+
+// Emit jmp [rip+0] with the absolute address inline, x64 only: always 14 bytes
+inline void EmitAbsoluteJump(std::vector<uint8_t>& out, uint64_t to)
+{
+	const uint8_t jmpAbs[] = { 0xFF, 0x25, 0, 0, 0, 0 };
+	out.insert(out.end(), jmpAbs, jmpAbs + sizeof(jmpAbs));
+	detail::Put64(out, to);
+}
+
+// Emit a jump at `from` to `to`: jmp rel32 if reachable, otherwise the absolute form.
+inline void EmitJump(std::vector<uint8_t>& out, uint64_t from, uint64_t to, Arch arch)
+{
+	using namespace detail;
+	int64_t rel = static_cast<int64_t>(to - (from + 5));
+	if (arch == Arch::x86 || FitsRel32(rel))
+	{
+		out.push_back(0xE9);
+		Put32(out, static_cast<int32_t>(rel));
+		return;
+	}
+	EmitAbsoluteJump(out, to);
+}
+
+inline size_t JumpSize(uint64_t from, uint64_t to, Arch arch)
+{
+	return arch == Arch::x86 || detail::FitsRel32(static_cast<int64_t>(to - (from + 5))) ? 5 : 14;
+}
+
+// Copy whole instructions from `src` (located at `srcAddr`) until at least `minLen` bytes
+// are covered, rewriting every position dependent instruction for execution at `dstAddr`.
+// `out` receives the relocated code, `covered` the number of source bytes consumed.
+inline bool Relocate(const uint8_t* src, size_t avail, uint64_t srcAddr, size_t minLen,
+	uint64_t dstAddr, Arch arch, std::vector<uint8_t>& out, size_t& covered)
+{
+	using namespace detail;
+	out.clear();
+	covered = 0;
+	std::vector<uint64_t> targets;
+	while (covered < minLen)
+	{
+		insn ins;
+		if (!Decode(src + covered, avail - covered, arch, ins)) return false;
+
+		const uint8_t* p = src + covered;
+		uint64_t insnAddr = srcAddr + covered;
+		uint64_t newAddr = dstAddr + out.size();
+		uint64_t next = insnAddr + ins.length;
+
+		switch (ins.kind)
+		{
+		case INSN_PLAIN:
+			if (ins.ripRelative)
+			{
+				int32_t disp;
+				memcpy(&disp, p + ins.dispOffset, 4);
+				int64_t newDisp = static_cast<int64_t>(next + disp) - static_cast<int64_t>(newAddr + ins.length);
+				if (!FitsRel32(newDisp)) return false;
+				size_t at = out.size();
+				out.insert(out.end(), p, p + ins.length);
+				int32_t d = static_cast<int32_t>(newDisp);
+				memcpy(out.data() + at + ins.dispOffset, &d, 4);
+			}
+			else
+			{
+				out.insert(out.end(), p, p + ins.length);
+			}
+			break;
+
+		case INSN_JMP:
+		case INSN_CALL:
+		case INSN_JCC:
+		{
+			uint64_t target = next + ReadRel(p + ins.relOffset, ins.relSize);
+			targets.push_back(target);
+
+			if (ins.kind == INSN_JMP)
+			{
+				EmitJump(out, newAddr, target, arch);
+			}
+			else if (ins.kind == INSN_CALL)
+			{
+				int64_t rel = static_cast<int64_t>(target - (newAddr + 5));
+				if (arch == Arch::x86 || FitsRel32(rel))
+				{
+					out.push_back(0xE8);
+					Put32(out, static_cast<int32_t>(rel));
+				}
+				else
+				{
+					// call [rip+2]; jmp +8; dq target
+					const uint8_t callAbs[] = { 0xFF, 0x15, 2, 0, 0, 0, 0xEB, 8 };
+					out.insert(out.end(), callAbs, callAbs + sizeof(callAbs));
+					Put64(out, target);
+				}
+			}
+			else
+			{
+				int64_t rel = static_cast<int64_t>(target - (newAddr + 6));
+				if (arch == Arch::x86 || FitsRel32(rel))
+				{
+					out.push_back(0x0F);
+					out.push_back(static_cast<uint8_t>(0x80 | ins.cond));
+					Put32(out, static_cast<int32_t>(rel));
+				}
+				else
+				{
+					// Inverted jcc skips over an absolute jump, which must be the 14 byte form
+					out.push_back(static_cast<uint8_t>(0x70 | (ins.cond ^ 1)));
+					out.push_back(14);
+					EmitAbsoluteJump(out, target);
+				}
+			}
+			covered += ins.length;
+			if (ins.kind == INSN_JMP && covered < minLen) return false;
+			continue;
+		}
+
+		case INSN_RET:
+			// Function is shorter than the patch
+			if (covered + ins.length < minLen) return false;
+			out.insert(out.end(), p, p + ins.length);
+			break;
+
+		default:
+			return false;
+		}
+		covered += ins.length;
+	}
+
+	// A branch into the bytes being moved can not be relocated
+	for (auto t : targets)
+	{
+		if (t >= srcAddr && t < srcAddr + covered) return false;
+	}
+	return true;
+}
+
+// Build the trampoline: relocated prologue followed by a jump back behind the patched bytes.
+inline bool BuildTrampoline(const uint8_t* target, size_t avail, uint64_t targetAddr,
+	uint64_t trampolineAddr, Arch arch, std::vector<uint8_t>& out, size_t& covered)
+{
+	if (!Relocate(target, avail, targetAddr, PATCH_SIZE, trampolineAddr, arch, out, covered)) return false;
+	EmitJump(out, trampolineAddr + out.size(), targetAddr + covered, arch);
+	return true;
+}
+
+// Build the bytes written over the target: jmp rel32 to `relayAddr`, padded with int3.
+inline bool BuildPatch(uint64_t targetAddr, uint64_t relayAddr, size_t covered, std::vector<uint8_t>& out)
+{
+	int64_t rel = static_cast<int64_t>(relayAddr - (targetAddr + 5));
+	if (!detail::FitsRel32(rel)) return false;
+	out.clear();
+	out.push_back(0xE9);
+	detail::Put32(out, static_cast<int32_t>(rel));
+	out.resize(covered, 0xCC);
+	return true;
+}
+
+} // namespace hook
+
+#ifdef _WIN32
+
+namespace hook {
+
+// Executable memory for trampolines and relays, reserved within rel32 reach of the hooked module.
+class TrampolineArena
+{
+public:
+	static constexpr size_t ARENA_SIZE = 0x10000;
+
+	// Trampolines must outlive every hooked call, blocks are never freed.
+	uint8_t* Allocate(uint64_t nearAddr, size_t size)
+	{
+		size = (size + 15) & ~size_t(15);
+		for (auto& b : blocks)
+		{
+			if (!b.sealed && b.used + size <= ARENA_SIZE && InReach(b.base, nearAddr))
+			{
+				uint8_t* p = b.base + b.used;
+				b.used += size;
+				return p;
+			}
+		}
+		uint8_t* base = ReserveNear(nearAddr);
+		if (!base) return nullptr;
+		blocks.push_back({ base, size, false });
+		return base;
+	}
+
+	// Blocks are writable while hooks are being prepared and execute-only once sealed.
+	// Sealed blocks may be running code, so they are never made writable again.
+	void Seal()
+	{
+		for (auto& b : blocks)
+		{
+			if (b.sealed) continue;
+			DWORD oldProtect;
+			VirtualProtect(b.base, ARENA_SIZE, PAGE_EXECUTE_READ, &oldProtect);
+			b.sealed = true;
+		}
+	}
+
+private:
+	struct block
+	{
+		uint8_t* base;
+		size_t used;
+		bool sealed;
+	};
+	std::vector<block> blocks;
+
+	static bool InReach(const uint8_t* base, uint64_t addr)
+	{
+		if (NATIVE_ARCH == Arch::x86) return true;
+		const uint64_t reach = 0x7FFF0000;
+		uint64_t b = reinterpret_cast<uint64_t>(base);
+		return b < addr ? addr - b < reach : b - addr < reach;
+	}
+
+	static uint8_t* ReserveNear(uint64_t addr)
+	{
+		if (NATIVE_ARCH == Arch::x86)
+			return static_cast<uint8_t*>(VirtualAlloc(nullptr, ARENA_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		const uint64_t gran = si.dwAllocationGranularity;
+		const uint64_t reach = 0x7FFF0000;
+		uint64_t lo = addr > reach ? addr - reach : 0;
+		uint64_t hi = addr + reach;
+		lo = std::max<uint64_t>(lo, reinterpret_cast<uint64_t>(si.lpMinimumApplicationAddress));
+		hi = std::min<uint64_t>(hi, reinterpret_cast<uint64_t>(si.lpMaximumApplicationAddress));
+
+		// Walk free regions downwards from the target, then upwards
+		for (int dir = -1; dir <= 1; dir += 2)
+		{
+			uint64_t p = (addr / gran) * gran;
+			while (p > lo && p < hi)
+			{
+				p = dir < 0 ? p - gran : p + gran;
+				MEMORY_BASIC_INFORMATION mbi;
+				if (VirtualQuery(reinterpret_cast<void*>(p), &mbi, sizeof(mbi)) == 0) break;
+				if (mbi.State == MEM_FREE)
+				{
+					void* r = VirtualAlloc(reinterpret_cast<void*>(p), ARENA_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+					if (r) return static_cast<uint8_t*>(r);
+				}
+				else if (dir < 0)
+				{
+					p = reinterpret_cast<uint64_t>(mbi.AllocationBase);
+					p = (p / gran) * gran;
+				}
+				else
+				{
+					p = reinterpret_cast<uint64_t>(mbi.BaseAddress) + mbi.RegionSize;
+					p = ((p + gran - 1) / gran) * gran - gran;
+				}
+			}
+		}
+		return nullptr;
+	}
+};
+
+// Collects hooks and applies all patches at once:
+// one protect per touched page range, one write pass, one instruction cache flush.
+class HookTransaction
+{
+public:
+	explicit HookTransaction(TrampolineArena& arena) : arena(arena) {}
+
+	// Prepare trampoline and relay for `target`, `*original` is set on Commit.
+	template <typename F>
+	bool Add(F target, void* detour, F* original)
+	{
+		return AddRaw(reinterpret_cast<uint8_t*>(target), detour, reinterpret_cast<void**>(original));
+	}
+
+	bool AddRaw(uint8_t* target, void* detour, void** original)
+	{
+		const uint64_t targetAddr = reinterpret_cast<uint64_t>(target);
+		const uint64_t detourAddr = reinterpret_cast<uint64_t>(detour);
+
+		// Relay is needed when the detour is out of rel32 reach from the target
+		const size_t relaySize = JumpSize(targetAddr, detourAddr, NATIVE_ARCH) == 5 ? 0 : 14;
+		// At most PATCH_SIZE instructions are relocated, plus the jump back
+		uint8_t* mem = arena.Allocate(targetAddr, relaySize + PATCH_SIZE * MAX_RELOCATED_INSN + 14);
+		if (!mem) return false;
+
+		uint64_t relayAddr = detourAddr;
+		if (relaySize)
+		{
+			std::vector<uint8_t> relay;
+			EmitAbsoluteJump(relay, detourAddr);
+			memcpy(mem, relay.data(), relay.size());
+			relayAddr = reinterpret_cast<uint64_t>(mem);
+		}
+
+		uint8_t* trampoline = mem + relaySize;
+		std::vector<uint8_t> code;
+		size_t covered;
+		if (!BuildTrampoline(target, MAX_INSN * 2, targetAddr, reinterpret_cast<uint64_t>(trampoline), NATIVE_ARCH, code, covered))
+			return false;
+		memcpy(trampoline, code.data(), code.size());
+
+		pending p;
+		p.target = target;
+		p.original = original;
+		p.trampoline = trampoline;
+		if (!BuildPatch(targetAddr, relayAddr, covered, p.patch)) return false;
+		hooks.push_back(std::move(p));
+		return true;
+	}
+
+	bool Commit()
+	{
+		if (hooks.empty()) return true;
+		arena.Seal();
+
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		const uintptr_t page = si.dwPageSize;
+
+		// Merge patched ranges to whole pages so each page is unprotected once
+		std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+		for (auto& h : hooks)
+		{
+			uintptr_t b = reinterpret_cast<uintptr_t>(h.target) & ~(page - 1);
+			uintptr_t e = (reinterpret_cast<uintptr_t>(h.target) + h.patch.size() + page - 1) & ~(page - 1);
+			ranges.emplace_back(b, e);
+		}
+		std::sort(ranges.begin(), ranges.end());
+		std::vector<std::pair<uintptr_t, uintptr_t>> merged;
+		for (auto& r : ranges)
+		{
+			if (!merged.empty() && r.first <= merged.back().second)
+				merged.back().second = std::max(merged.back().second, r.second);
+			else
+				merged.push_back(r);
+		}
+
+		std::vector<DWORD> oldProtect(merged.size());
+		size_t unprotected = 0;
+		for (; unprotected < merged.size(); ++unprotected)
+		{
+			auto& r = merged[unprotected];
+			if (!VirtualProtect(reinterpret_cast<void*>(r.first), r.second - r.first, PAGE_EXECUTE_READWRITE, &oldProtect[unprotected]))
+				break;
+		}
+
+		bool ok = unprotected == merged.size();
+		if (ok)
+		{
+			for (auto& h : hooks)
+			{
+				// Original must be callable before the detour can be entered
+				*h.original = h.trampoline;
+				memcpy(h.target, h.patch.data(), h.patch.size());
+			}
+		}
+
+		for (size_t i = 0; i < unprotected; ++i)
+		{
+			DWORD tmp;
+			VirtualProtect(reinterpret_cast<void*>(merged[i].first), merged[i].second - merged[i].first, oldProtect[i], &tmp);
+		}
+		FlushInstructionCache(GetCurrentProcess(), nullptr, 0);
+		hooks.clear();
+		return ok;
+	}
+
+private:
+	struct pending
+	{
+		uint8_t* target;
+		void** original;
+		uint8_t* trampoline;
+		std::vector<uint8_t> patch;
+	};
+	TrampolineArena& arena;
+	std::vector<pending> hooks;
+};
+
+} // namespace hook
+
+#endif // _WIN32
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "CallerProfile.hpp"
+#include "Introspect.hpp"
+#include "LogFont.hpp"
+#include "MappedLog.hpp"
+#include "Stats.hpp"
+#include "Transcode.hpp"
+
+// The body of the CreateFontIndirectExW hook with GDI left to the caller, so the path every
+// font creation takes, and what it shares between threads, also runs in tools/stress-hook.
+namespace hookpath {
+
+// What a call writes to, shared by every thread creating fonts
+struct shared
+{
+	stats::instance* stats;
+	const std::atomic<logsink::MappedLog*>* log; // null while tracing is off, toggled at runtime
+	introspect::LatencyHistogram* rewriteLatency;
+	introspect::LatencyHistogram* createLatency;
+	callers::Table* callers; // only used when Profiling
+};
+
+// Marks this thread as inside a CreateFontIndirectExW hook while alive. gdi32's export may end in
+// gdi32full's, hooked as well, and FontMod creates its own fonts through the hooked API: a hook
+// entered while another one is on the stack passes the font on, so a font is rewritten once.
+class Reentry
+{
+public:
+	Reentry() : nested(depth++ != 0) {}
+	~Reentry() { --depth; }
+	Reentry(const Reentry&) = delete;
+	Reentry& operator=(const Reentry&) = delete;
+
+	bool Nested() const { return nested; }
+
+private:
+	static inline thread_local unsigned depth = 0;
+	const bool nested;
+};
+
+inline const char* BoolString(unsigned char b)
+{
+	return b ? "true" : "false";
+}
+
+inline void LogFont(logsink::MappedLog* log, const LOGFONTW& lf)
+{
+	std::string name;
+	if (Utf16ToUtf8(lf.lfFaceName, name))
+	{
+		log->Printf(
+			"[CreateFont] name = \"%s\", height = %d, "
+			"width = %d, escapement = %d, "
+			"orientation = %d, weight = %d, "
+			"italic = %s, underline = %s, "
+			"strikeout = %s, charset = %d, "
+			"outprecision = %d, clipprecision = %d, "
+			"quality = %d, pitchandfamily = %d\n",
+			name.c_str(), static_cast<int>(lf.lfHeight),
+			static_cast<int>(lf.lfWidth), static_cast<int>(lf.lfEscapement),
+			static_cast<int>(lf.lfOrientation), static_cast<int>(lf.lfWeight),
+			BoolString(lf.lfItalic), BoolString(lf.lfUnderline),
+			BoolString(lf.lfStrikeOut), lf.lfCharSet,
+			lf.lfOutPrecision, lf.lfClipPrecision,
+			lf.lfQuality, lf.lfPitchAndFamily);
+	}
+}
+
+// One font creation. `rewrite(lf)` applies the rules to the copy and returns whether one did,
+// `create(lf, hit)` calls GDI and returns the font. `frames` are the return addresses above
+// the hook, read only when Profiling. The flags are those of the hook variants.
+template <bool Logging, bool Counting, bool Timing, bool Profiling, typename Rewrite, typename Create>
+auto Call(const shared& s, const LOGFONTW& requested, const uintptr_t* frames, size_t depth, Rewrite&& rewrite, Create&& create)
+{
+	const bool timed = Timing && introspect::Attached();
+	const uint64_t start = timed ? introspect::Now() : 0;
+	if constexpr (Logging)
+	{
+		if (auto log = s.log->load(std::memory_order_relaxed)) // tracing may be toggled concurrently
+			LogFont(log, requested);
+	}
+
+	LOGFONTW lf = requested;
+	const bool hit = rewrite(lf);
+	if constexpr (Counting) stats::Add(hit ? s.stats->ruleHits : s.stats->ruleMisses);
+
+	// the first rewritten font is timed to see what pre-warming saves
+	const bool firstHit = Counting && hit && s.stats->firstHitNs.load(std::memory_order_relaxed) == 0;
+	const uint64_t call = timed || firstHit || Profiling ? introspect::Now() : 0;
+	auto font = create(lf, hit);
+	if constexpr (Profiling) s.callers->Record(frames, depth, requested.lfFaceName, introspect::Now() - call);
+	if constexpr (Counting)
+	{
+		if (font) stats::Add(s.stats->fontsCreated);
+		if (firstHit)
+		{
+			uint64_t expected = 0;
+			s.stats->firstHitNs.compare_exchange_strong(expected, std::max<uint64_t>(introspect::Now() - call, 1), std::memory_order_relaxed);
+		}
+	}
+	if (timed)
+	{
+		s.rewriteLatency->Record(call - start);
+		s.createLatency->Record(introspect::Now() - call);
+	}
+	return font;
+}
+
+} // namespace hookpath
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+// Opt-in local endpoint answering line based queries about the running instance.
+// Windows serves \\.\pipe\FontMod.<pid>, elsewhere a Unix domain socket stands in.
+// Either is open to the user running the process only.
+namespace introspect {
+
+// Number of connected clients. The hook only reads this, so without a client
+// the whole feature costs one relaxed load.
+inline std::atomic<uint32_t> clients{ 0 };
+
+inline bool Attached()
+{
+	return clients.load(std::memory_order_relaxed) != 0;
+}
+
+inline uint64_t Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Power of two buckets of nanoseconds: bucket i counts samples below 2^(i+1) ns
+class LatencyHistogram
+{
+public:
+	static constexpr size_t BUCKETS = 32;
+
+	void Record(uint64_t ns)
+	{
+		size_t i = 0;
+		while (i + 1 < BUCKETS && (ns >> (i + 1)) != 0) ++i;
+		buckets[i].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Reset()
+	{
+		for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+	}
+
+	std::string Format(const char* title) const
+	{
+		std::string out = title;
+		out += ":\n";
+		char line[64];
+		for (size_t i = 0; i < BUCKETS; ++i)
+		{
+			uint64_t n = buckets[i].load(std::memory_order_relaxed);
+			if (n == 0) continue;
+			snprintf(line, sizeof(line), "  < %llu ns: %llu\n",
+				static_cast<unsigned long long>(1ull << (i + 1)), static_cast<unsigned long long>(n));
+			out += line;
+		}
+		return out;
+	}
+
+private:
+	std::atomic<uint64_t> buckets[BUCKETS] = {};
+};
+
+// Maps the first word of a request line to a handler producing the reply
+class Endpoint
+{
+public:
+	using handler = std::function<std::string(const std::string& args)>;
+
+	void On(const std::string& command, handler fn)
+	{
+		handlers[command] = std::move(fn);
+	}
+
+	std::string Dispatch(const std::string& line) const
+	{
+		size_t sp = line.find(' ');
+		std::string cmd = line.substr(0, sp);
+		std::string args = sp == std::string::npos ? std::string() : line.substr(sp + 1);
+		if (auto it = handlers.find(cmd); it != handlers.end())
+			return it->second(args);
+
+		std::string out = "unknown command, one of:";
+		for (auto& h : handlers)
+			out += " " + h.first;
+		return out + "\n";
+	}
+
+	// Reads request lines from `read` until it fails, each reply ends with an empty line
+	template <typename Read, typename Write>
+	void Serve(Read read, Write write) const
+	{
+		std::string pending;
+		char buf[256];
+		for (;;)
+		{
+			int n = read(buf, sizeof(buf));
+			if (n <= 0) return;
+			pending.append(buf, n);
+			size_t eol;
+			while ((eol = pending.find('\n')) != std::string::npos)
+			{
+				std::string line = pending.substr(0, eol);
+				pending.erase(0, eol + 1);
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				if (line.empty()) continue;
+				std::string reply = Dispatch(line) + "\n";
+				if (!write(reply.data(), static_cast<int>(reply.size()))) return;
+			}
+		}
+	}
+
+	// Start the listener thread, returns false if the endpoint could not be created.
+	// On Windows the thread is never stopped, the caller pins the module it runs in.
+	bool Start()
+	{
+#ifdef _WIN32
+		swprintf_s(pipeName, L"\\\\.\\pipe\\FontMod.%lu", GetCurrentProcessId());
+		// CreateThread rather than std::thread, which may wait for the thread under the loader lock
+		HANDLE h = CreateThread(nullptr, 0, [](LPVOID p) -> DWORD {
+			static_cast<Endpoint*>(p)->Listen();
+			return 0;
+		}, this, 0, nullptr);
+		if (!h) return false;
+		CloseHandle(h);
+		return true;
+#else
+		const char* dir = getenv("TMPDIR");
+		snprintf(socketPath, sizeof(socketPath), "%s/fontmod.%d.sock", dir ? dir : "/tmp", static_cast<int>(getpid()));
+		listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listenFd < 0) return false;
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socketPath);
+		unlink(socketPath);
+		// created owner only, no other user can connect between bind and chmod
+		mode_t mask = umask(S_IRWXG | S_IRWXO);
+		int bound = bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		umask(mask);
+		if (bound != 0 || chmod(socketPath, S_IRUSR | S_IWUSR) != 0 || listen(listenFd, 4) != 0)
+		{
+			close(listenFd);
+			unlink(socketPath);
+			listenFd = -1;
+			return false;
+		}
+		listener = std::thread([this] { Listen(); });
+		return true;
+#endif
+	}
+
+#ifndef _WIN32
+	// Drops a connected client, waits for the listener thread and removes the socket
+	void Stop()
+	{
+		if (!listener.joinable()) return;
+		stopping = true;
+		shutdown(listenFd, SHUT_RDWR);
+		int fd = clientFd.load();
+		if (fd >= 0) shutdown(fd, SHUT_RDWR);
+		listener.join();
+		close(listenFd);
+		unlink(socketPath);
+		listenFd = -1;
+		stopping = false;
+	}
+
+	~Endpoint() { Stop(); }
+#endif
+
+#ifdef _WIN32
+	const wchar_t* Name() const { return pipeName; }
+#else
+	const char* Name() const { return socketPath; }
+#endif
+
+private:
+	std::map<std::string, handler> handlers;
+#ifdef _WIN32
+	wchar_t pipeName[64] = {};
+
+	// A DACL granting the token user alone access, in place of the default one which lets
+	// everyone read. `buffer` holds the token user and the ACL `sd` points to.
+	static bool CurrentUserOnly(SECURITY_DESCRIPTOR& sd, std::vector<uint8_t>& buffer)
+	{
+		HANDLE token;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) return false;
+		DWORD size = 0;
+		GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+		std::vector<uint8_t> user(size);
+		bool ok = size && GetTokenInformation(token, TokenUser, user.data(), size, &size);
+		CloseHandle(token);
+		if (!ok) return false;
+
+		PSID sid = reinterpret_cast<TOKEN_USER*>(user.data())->User.Sid;
+		DWORD aclSize = sizeof(ACL) + sizeof(ACCESS_ALLOWED_ACE) + GetLengthSid(sid);
+		buffer.resize(aclSize);
+		auto acl = reinterpret_cast<PACL>(buffer.data());
+		return InitializeAcl(acl, aclSize, ACL_REVISION) &&
+			AddAccessAllowedAce(acl, ACL_REVISION, GENERIC_READ | GENERIC_WRITE, sid) &&
+			InitializeSecurityDescriptor(&sd, SECURITY_DESCRIPTOR_REVISION) &&
+			SetSecurityDescriptorDacl(&sd, TRUE, acl, FALSE);
+	}
+
+	void Listen()
+	{
+		SECURITY_DESCRIPTOR sd;
+		std::vector<uint8_t> acl;
+		if (!CurrentUserOnly(sd, acl)) return;
+		SECURITY_ATTRIBUTES sa = { sizeof(sa), &sd, FALSE };
+		for (;;)
+		{
+			// FIRST_PIPE_INSTANCE: the previous instance is closed, so an existing pipe of that name is someone else's
+			HANDLE pipe = CreateNamedPipeW(pipeName, PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE,
+				PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+				1, 4096, 4096, 0, &sa);
+			if (pipe == INVALID_HANDLE_VALUE) return;
+			if (ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED)
+			{
+				clients.fetch_add(1, std::memory_order_relaxed);
+				Serve([pipe](char* buf, int size) {
+					DWORD n = 0;
+					return ReadFile(pipe, buf, size, &n, nullptr) ? static_cast<int>(n) : -1;
+				}, [pipe](const char* buf, int size) {
+					DWORD n = 0;
+					return WriteFile(pipe, buf, size, &n, nullptr) && static_cast<int>(n) == size;
+				});
+				clients.fetch_sub(1, std::memory_order_relaxed);
+				DisconnectNamedPipe(pipe);
+			}
+			CloseHandle(pipe);
+		}
+	}
+#else
+	char socketPath[108] = {};
+	int listenFd = -1;
+	std::thread listener;
+	std::atomic<bool> stopping{ false };
+	std::atomic<int> clientFd{ -1 };
+
+	void Listen()
+	{
+		for (;;)
+		{
+			int fd = accept(listenFd, nullptr, nullptr);
+			if (fd < 0) return;
+			// Stop shuts down the client it finds here, one accepted after that sees `stopping`
+			clientFd = fd;
+			if (stopping)
+			{
+				clientFd = -1;
+				close(fd);
+				return;
+			}
+			clients.fetch_add(1, std::memory_order_relaxed);
+			Serve([fd](char* buf, int size) {
+				return static_cast<int>(read(fd, buf, size));
+			}, [fd](const char* buf, int size) {
+				return write(fd, buf, size) == size;
+			});
+			clients.fetch_sub(1, std::memory_order_relaxed);
+			clientFd = -1;
+			close(fd);
+		}
+	}
+#endif
+};
+
+} // namespace introspect
@@ -0,0 +1,36 @@
+#pragma once
+
+// LOGFONTW for the platform neutral core. Windows builds use wingdi.h's, elsewhere an
+// equivalent struct lets the config loader and rule engine build and be measured.
+// Face names are wchar_t either way, UTF-16 on Windows and UTF-32 elsewhere.
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cstdint>
+
+#define LF_FACESIZE 32
+
+struct LOGFONTW
+{
+	int32_t lfHeight;
+	int32_t lfWidth;
+	int32_t lfEscapement;
+	int32_t lfOrientation;
+	int32_t lfWeight;
+	uint8_t lfItalic;
+	uint8_t lfUnderline;
+	uint8_t lfStrikeOut;
+	uint8_t lfCharSet;
+	uint8_t lfOutPrecision;
+	uint8_t lfClipPrecision;
+	uint8_t lfQuality;
+	uint8_t lfPitchAndFamily;
+	wchar_t lfFaceName[LF_FACESIZE];
+};
+#endif
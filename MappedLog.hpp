@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Log sink writing into preallocated, memory-mapped segments.
+// The active segment is created at its full size and zero filled, records are copied
+// into the mapping, so a line never extends the file. The unwritten tail stays zero,
+// whatever reached the mapping survives a crash of the process. Writers reserve their
+// range with an atomic add, so a thread killed while logging can not block the others.
+// Segments are trimmed to their written length on close and extended again when reopened.
+// When a segment is full it is trimmed and renamed to <path>.1, older ones shift up
+// to <path>.<generations - 1> and the oldest is removed.
+namespace logsink {
+
+namespace fs = std::filesystem;
+
+constexpr size_t DEFAULT_SEGMENT_SIZE = 1024 * 1024;
+constexpr unsigned DEFAULT_GENERATIONS = 3;
+constexpr size_t MAX_RECORD = 2048; // longer Printf records are truncated
+
+class MappedLog
+{
+public:
+	MappedLog() = default;
+	MappedLog(const MappedLog&) = delete;
+	MappedLog& operator=(const MappedLog&) = delete;
+	~MappedLog() { Close(); }
+
+	// `generations` counts the active segment, 1 keeps no history
+	bool Open(const fs::path& logPath, size_t segmentSize = DEFAULT_SEGMENT_SIZE, unsigned generations = DEFAULT_GENERATIONS)
+	{
+		std::lock_guard<std::mutex> lock(rotating);
+		if (active.load()) return true;
+		path = logPath;
+		size = segmentSize < 4096 ? 4096 : segmentSize;
+		keep = generations ? generations : 1;
+
+		// Continue the last segment, one from a larger configured size is rotated away
+		std::error_code ec;
+		auto existing = fs::file_size(path, ec);
+		if (!ec && existing > size)
+			Shift();
+		segment* seg = Map();
+		if (!seg) return false;
+		seg->used = FindEnd(*seg, size);
+		active.store(seg);
+		return true;
+	}
+
+	bool IsOpen() const { return active.load() != nullptr; }
+
+	// Copies one record, rotating first if it does not fit into the active segment.
+	// Writers only reserve their range with an atomic add and copy into it, the lock is
+	// taken by the one thread that rotates a full segment and never waited for.
+	void Append(const char* data, size_t len)
+	{
+		if (len > size) len = size;
+		auto giveUp = std::chrono::steady_clock::time_point::max();
+		for (;;)
+		{
+			segment* seg = active.load();
+			if (!seg) return;
+			seg->writers.fetch_add(1);
+			size_t off = seg->used.fetch_add(len);
+			if (off + len <= size)
+			{
+				memcpy(seg->view + off, data, len);
+				seg->writers.fetch_sub(1);
+				return;
+			}
+			seg->writers.fetch_sub(1);
+
+			std::unique_lock<std::mutex> lock(rotating, std::try_to_lock);
+			if (lock)
+			{
+				// someone else may have rotated in between
+				if (active.load() == seg && !Rotate()) return;
+				continue;
+			}
+			// A thread killed while rotating at process exit would hold the lock forever
+			auto now = std::chrono::steady_clock::now();
+			if (giveUp == std::chrono::steady_clock::time_point::max())
+				giveUp = now + ROTATE_WAIT;
+			else if (now > giveUp)
+				return;
+			std::this_thread::yield();
+		}
+	}
+
+	void Printf(const char* format, ...)
+	{
+		char buf[MAX_RECORD];
+		va_list args;
+		va_start(args, format);
+		int n = vsnprintf(buf, sizeof(buf), format, args);
+		va_end(args);
+		if (n <= 0) return;
+		Append(buf, static_cast<size_t>(n) < sizeof(buf) ? n : sizeof(buf) - 1);
+	}
+
+	// Schedule dirty pages for writing, the mapping is written back without it too.
+	// Skipped while a segment is rotated.
+	void Flush()
+	{
+		std::unique_lock<std::mutex> lock(rotating, std::try_to_lock);
+		segment* seg = active.load();
+		if (!lock || !seg) return;
+#ifdef _WIN32
+		FlushViewOfFile(seg->view, std::min(seg->used.load(), size));
+#else
+		msync(seg->view, size, MS_ASYNC);
+#endif
+	}
+
+	// Unmaps and trims the segments to their written length. Never waits long: at process exit
+	// the threads in Append may have been killed, a segment they were writing stays mapped.
+	void Close()
+	{
+		std::unique_lock<std::mutex> lock(rotating, std::try_to_lock);
+		if (!lock) return;
+		segment* last = active.exchange(nullptr);
+		// a writer that loaded the segment before fails its reservation from here on
+		if (last) last->used.fetch_add(size + 1);
+		for (auto& seg : segments)
+		{
+			for (int i = 0; i < CLOSE_SPINS && seg->view && seg->writers.load(); ++i)
+				std::this_thread::yield();
+			if (seg->view && !seg->writers.load()) Unmap(*seg, true);
+		}
+	}
+
+	size_t Used() const
+	{
+		segment* seg = active.load();
+		return seg ? std::min(seg->used.load(), size) : 0;
+	}
+
+	size_t SegmentSize() const { return size; }
+
+private:
+	static constexpr auto ROTATE_WAIT = std::chrono::seconds(1);
+	static constexpr int CLOSE_SPINS = 1000;
+
+	// One mapped file. Retired segments are unmapped once no writer is left in them, but kept:
+	// a writer that loaded one before may still reserve, and fail, there.
+	struct segment
+	{
+		char* view = nullptr;
+		std::atomic<size_t> used{ 0 };     // reserved bytes, beyond `size` once full
+		std::atomic<uint32_t> writers{ 0 }; // threads between reserving and copying
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#else
+		int fd = -1;
+#endif
+	};
+
+	std::mutex rotating; // Open, Rotate, Close and the segment list
+	std::atomic<segment*> active{ nullptr };
+	std::vector<std::unique_ptr<segment>> segments;
+	fs::path path;
+	size_t size = DEFAULT_SEGMENT_SIZE;
+	unsigned keep = DEFAULT_GENERATIONS;
+
+	fs::path Generation(unsigned i) const
+	{
+		auto p = path;
+		p += "." + std::to_string(i);
+		return p;
+	}
+
+	// <path>.1 .. .<keep - 2> move up one generation, <path> becomes <path>.1
+	void Shift()
+	{
+		std::error_code ec;
+		if (keep <= 1)
+		{
+			fs::remove(path, ec);
+			return;
+		}
+		fs::remove(Generation(keep - 1), ec);
+		for (unsigned i = keep - 1; i > 1; --i)
+			fs::rename(Generation(i - 1), Generation(i), ec);
+		fs::rename(path, Generation(1), ec);
+	}
+
+	// With `rotating` held once a reservation went beyond the active segment: every later one
+	// there fails as well, so its writers count only drops from here on. A segment still being
+	// copied into is unmapped by a later rotation or Close.
+	bool Rotate()
+	{
+		for (auto& seg : segments)
+		{
+			if (seg->view && !seg->writers.load()) Unmap(*seg, true);
+		}
+		Shift();
+		segment* seg = Map();
+		active.store(seg);
+		return seg != nullptr;
+	}
+
+	// Records are text, the first zero byte from the end marks the write position
+	static size_t FindEnd(const segment& seg, size_t from)
+	{
+		size_t end = from;
+		while (end > 0 && seg.view[end - 1] == '\0') --end;
+		return end;
+	}
+
+	segment* Map()
+	{
+		auto seg = std::make_unique<segment>();
+#ifdef _WIN32
+		// Readers may open the log while it is written, delete sharing lets rotation rename closed segments
+		seg->file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+			nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (seg->file == INVALID_HANDLE_VALUE) return nullptr;
+		ULARGE_INTEGER li;
+		li.QuadPart = size;
+		seg->mapping = CreateFileMappingW(seg->file, nullptr, PAGE_READWRITE, li.HighPart, li.LowPart, nullptr);
+		if (seg->mapping)
+			seg->view = static_cast<char*>(MapViewOfFile(seg->mapping, FILE_MAP_WRITE, 0, 0, size));
+#else
+		seg->fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if (seg->fd < 0) return nullptr;
+		if (ftruncate(seg->fd, static_cast<off_t>(size)) == 0)
+		{
+			void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+			if (p != MAP_FAILED) seg->view = static_cast<char*>(p);
+		}
+#endif
+		if (!seg->view)
+		{
+			Unmap(*seg, false);
+			return nullptr;
+		}
+		segments.push_back(std::move(seg));
+		return segments.back().get();
+	}
+
+	void Unmap(segment& seg, bool trim)
+	{
+		size_t used = seg.view ? FindEnd(seg, std::min(seg.used.load(), size)) : 0;
+#ifdef _WIN32
+		if (seg.view) UnmapViewOfFile(seg.view);
+		if (seg.mapping) CloseHandle(seg.mapping);
+		if (seg.file != INVALID_HANDLE_VALUE)
+		{
+			if (trim && seg.view)
+			{
+				LARGE_INTEGER li;
+				li.QuadPart = used;
+				SetFilePointerEx(seg.file, li, nullptr, FILE_BEGIN);
+				SetEndOfFile(seg.file);
+			}
+			CloseHandle(seg.file);
+		}
+		seg.mapping = nullptr;
+		seg.file = INVALID_HANDLE_VALUE;
+#else
+		if (seg.view) munmap(seg.view, size);
+		if (seg.fd >= 0)
+		{
+			if (trim && seg.view)
+			{
+				int r = ftruncate(seg.fd, static_cast<off_t>(used)); // on failure the zero tail just stays
+				(void)r;
+			}
+			close(seg.fd);
+		}
+		seg.fd = -1;
+#endif
+		seg.view = nullptr;
+	}
+};
+
+} // namespace logsink
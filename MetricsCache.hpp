@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Memoized text metrics and glyph widths per font.
+// Widths are kept in dense 256 character pages with a valid bit per character, a range
+// query is answered from the pages when every character in it is known and filled
+// from one real call otherwise. Entries live until the font is invalidated.
+namespace metrics {
+
+constexpr size_t PAGE = 256;
+constexpr uint32_t MAX_CHAR = 0x10FFFF;
+
+struct counters
+{
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> misses{ 0 };
+	std::atomic<uint64_t> invalidations{ 0 };
+};
+
+// Key is whatever identifies a font in a given device context, TextMetrics and ABC are
+// TEXTMETRICW and ABC on Windows
+template <typename Key, typename TextMetrics, typename ABC, typename Hash = std::hash<Key>>
+class MetricsCache
+{
+public:
+	// `fetch(TextMetrics&)` asks GDI, false if it failed
+	template <typename Fetch>
+	bool TextMetricsFor(const Key& key, TextMetrics& out, Fetch fetch)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto it = fonts.find(key);
+			if (it != fonts.end() && it->second->hasTextMetrics)
+			{
+				out = it->second->textMetrics;
+				Count(stats.hits);
+				return true;
+			}
+		}
+		Count(stats.misses);
+		uint64_t seen = generation.load(std::memory_order_acquire);
+		if (!fetch(out)) return false;
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		if (generation.load(std::memory_order_relaxed) != seen) return true;
+		entry& e = Entry(key);
+		e.textMetrics = out;
+		e.hasTextMetrics = true;
+		return true;
+	}
+
+	// `fetch(first, last, int*)` fills last - first + 1 widths
+	template <typename Fetch>
+	bool WidthsFor(const Key& key, uint32_t first, uint32_t last, int* out, Fetch fetch)
+	{
+		return Range<&page::widths, &page::hasWidth>(key, first, last, out, fetch);
+	}
+
+	// `fetch(first, last, ABC*)` fills last - first + 1 ABC widths
+	template <typename Fetch>
+	bool AbcWidthsFor(const Key& key, uint32_t first, uint32_t last, ABC* out, Fetch fetch)
+	{
+		return Range<&page::abc, &page::hasAbc>(key, first, last, out, fetch);
+	}
+
+	// The font was deleted, its handle may come back for another font.
+	// Results fetched while this runs are not stored, they may belong to the old font.
+	void Invalidate(const Key& key)
+	{
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		generation.fetch_add(1, std::memory_order_relaxed);
+		if (fonts.erase(key)) Count(stats.invalidations);
+	}
+
+	size_t Size() const
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return fonts.size();
+	}
+
+	const counters& Stats() const { return stats; }
+
+	double HitRate() const
+	{
+		double hits = static_cast<double>(stats.hits.load(std::memory_order_relaxed));
+		double total = hits + stats.misses.load(std::memory_order_relaxed);
+		return total > 0 ? hits / total : 0;
+	}
+
+private:
+	struct page
+	{
+		uint64_t hasWidth[PAGE / 64] = {};
+		uint64_t hasAbc[PAGE / 64] = {};
+		int widths[PAGE];
+		ABC abc[PAGE];
+	};
+
+	struct entry
+	{
+		bool hasTextMetrics = false;
+		TextMetrics textMetrics;
+		std::unordered_map<uint32_t, std::unique_ptr<page>> pages; // by char / PAGE, mostly one or two
+	};
+
+	mutable std::shared_mutex mutex;
+	std::unordered_map<Key, std::unique_ptr<entry>, Hash> fonts;
+	std::atomic<uint64_t> generation{ 0 }; // bumped by every Invalidate
+	counters stats;
+
+	static void Count(std::atomic<uint64_t>& counter)
+	{
+		counter.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	entry& Entry(const Key& key)
+	{
+		auto& e = fonts[key];
+		if (!e) e = std::make_unique<entry>();
+		return *e;
+	}
+
+	template <auto Values, auto Valid, typename T, typename Fetch>
+	bool Range(const Key& key, uint32_t first, uint32_t last, T* out, Fetch fetch)
+	{
+		if (first > last || last > MAX_CHAR) return fetch(first, last, out);
+
+		if (Lookup<Values, Valid>(key, first, last, out))
+		{
+			Count(stats.hits);
+			return true;
+		}
+		Count(stats.misses);
+		uint64_t seen = generation.load(std::memory_order_acquire);
+		if (!fetch(first, last, out)) return false;
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		if (generation.load(std::memory_order_relaxed) != seen) return true;
+		entry& e = Entry(key);
+		for (uint32_t c = first; c <= last; ++c)
+		{
+			auto& p = e.pages[c / PAGE];
+			if (!p) p = std::make_unique<page>();
+			size_t i = c % PAGE;
+			((*p).*Values)[i] = out[c - first];
+			((*p).*Valid)[i / 64] |= 1ull << (i % 64);
+		}
+		return true;
+	}
+
+	template <auto Values, auto Valid, typename T>
+	bool Lookup(const Key& key, uint32_t first, uint32_t last, T* out) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		auto it = fonts.find(key);
+		if (it == fonts.end()) return false;
+		const entry& e = *it->second;
+
+		const page* p = nullptr;
+		uint32_t pageIndex = UINT32_MAX;
+		for (uint32_t c = first; c <= last; ++c)
+		{
+			if (c / PAGE != pageIndex)
+			{
+				pageIndex = c / PAGE;
+				auto pit = e.pages.find(pageIndex);
+				if (pit == e.pages.end()) return false;
+				p = pit->second.get();
+			}
+			size_t i = c % PAGE;
+			if (!((p->*Valid)[i / 64] & (1ull << (i % 64)))) return false;
+			out[c - first] = (p->*Values)[i];
+		}
+		return true;
+	}
+};
+
+} // namespace metrics
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "RuleImage.hpp"
+
+// Per-rule hit counters split into one shard per thread.
+// A thread only writes its own shard, a plain relaxed load and store without a locked
+// instruction, and shards are padded to cache lines so UI threads never share one.
+// They are summed only when read. A shard left by an exited thread goes to the next new one,
+// as far as its thread_local lease is destroyed: with DisableThreadLibraryCalls and the static
+// CRT that is not certain on Windows. So there are at most MAX_SHARDS, threads past that share
+// one more shard counted with atomic adds, and a host churning through threads stays bounded.
+namespace rules {
+
+// One rule's hits as the FontModRuleHits export hands them out
+struct ruleHits
+{
+	wchar_t face[FACE_SIZE]; // the rule key
+	uint64_t hits;
+};
+
+class HitCounters
+{
+public:
+	HitCounters() { Reset(0); }
+	HitCounters(const HitCounters&) = delete;
+	HitCounters& operator=(const HitCounters&) = delete;
+
+	// Drops all counts, `rules` hit counters from now on.
+	// Not safe against threads counting at the same time.
+	void Reset(size_t rules)
+	{
+		auto p = std::make_shared<pool>();
+		p->width = rules + 1;
+		p->overflow.lines.reset(new line[(p->width + 7) / 8]());
+		shards = std::move(p);
+		generation = nextGeneration.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	static constexpr size_t MAX_SHARDS = 64;
+
+	void Hit(size_t rule) { Count(rule + 1); }
+	void Miss() { Count(0); }
+
+	// Sums the shards, `hits` gets one entry per rule
+	void Read(std::vector<uint64_t>& hits, uint64_t& misses) const
+	{
+		std::lock_guard<std::mutex> hold(shards->lock);
+		hits.assign(shards->width - 1, 0);
+		misses = 0;
+		auto add = [&](shard& s) {
+			misses += s[0].load(std::memory_order_relaxed);
+			for (size_t i = 1; i < shards->width; ++i)
+				hits[i - 1] += s[i].load(std::memory_order_relaxed);
+		};
+		for (auto& s : shards->all)
+			add(*s);
+		add(shards->overflow);
+	}
+
+	// Shards of their own handed out, the shared one not counted
+	size_t Shards() const
+	{
+		std::lock_guard<std::mutex> hold(shards->lock);
+		return shards->all.size();
+	}
+
+private:
+	struct alignas(64) line
+	{
+		std::atomic<uint64_t> counts[8];
+	};
+
+	struct shard
+	{
+		std::unique_ptr<line[]> lines; // misses, then one counter per rule
+		bool leased = false;
+
+		std::atomic<uint64_t>& operator[](size_t i) { return lines[i / 8].counts[i % 8]; }
+	};
+
+	struct pool
+	{
+		std::mutex lock; // taken to lease a shard and to read, never to count
+		std::vector<std::unique_ptr<shard>> all; // at most MAX_SHARDS
+		shard overflow; // for the threads past them
+		size_t width = 1;
+	};
+
+	// The shard the current thread counts into, trivially destructible so reading it needs no TLS guard
+	struct cached
+	{
+		const HitCounters* owner;
+		uint64_t generation;
+		shard* s;
+		bool shared; // the overflow shard
+	};
+
+	// Returns the shard when the thread exits
+	struct lease
+	{
+		shard* s = nullptr;
+		std::weak_ptr<pool> from;
+
+		~lease() { Release(); }
+
+		void Release()
+		{
+			if (auto p = from.lock())
+			{
+				std::lock_guard<std::mutex> hold(p->lock);
+				s->leased = false;
+			}
+			from.reset();
+			s = nullptr;
+		}
+	};
+
+	std::shared_ptr<pool> shards;
+	uint64_t generation = 0; // tells a reset counter apart from the one a lease is for
+
+	static inline std::atomic<uint64_t> nextGeneration{ 0 };
+	static thread_local cached current;
+	static thread_local lease held;
+
+	static void Bump(std::atomic<uint64_t>& c)
+	{
+		c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	void Count(size_t i)
+	{
+		cached& c = current;
+		if (c.owner != this || c.generation != generation) Acquire();
+		auto& counter = (*c.s)[i];
+		if (c.shared)
+			counter.fetch_add(1, std::memory_order_relaxed);
+		else
+			Bump(counter);
+	}
+
+	void Acquire()
+	{
+		lease& l = held;
+		l.Release();
+		std::lock_guard<std::mutex> hold(shards->lock);
+		shard* found = nullptr;
+		for (auto& s : shards->all)
+		{
+			if (!s->leased)
+			{
+				found = s.get();
+				break;
+			}
+		}
+		if (!found && shards->all.size() == MAX_SHARDS)
+		{
+			// until the next Reset, even if a shard is returned meanwhile
+			current = { this, generation, &shards->overflow, true };
+			return;
+		}
+		if (!found)
+		{
+			auto s = std::make_unique<shard>();
+			s->lines.reset(new line[(shards->width + 7) / 8]());
+			found = s.get();
+			shards->all.push_back(std::move(s));
+		}
+		found->leased = true;
+		l.s = found;
+		l.from = shards;
+		current = { this, generation, found, false };
+	}
+};
+
+inline thread_local HitCounters::cached HitCounters::current = {};
+inline thread_local HitCounters::lease HitCounters::held;
+
+} // namespace rules
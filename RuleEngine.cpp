@@ -0,0 +1,74 @@
+#include "RuleEngine.hpp"
+
+namespace rules {
+
+void ApplyRule(const font& rule, LOGFONTW& lf)
+{
+	memcpy(lf.lfFaceName, rule.replace, sizeof(lf.lfFaceName));
+	ApplyStyle(rule, lf);
+}
+
+void Engine::Build(const std::vector<std::wstring>& order, const std::unordered_map<std::wstring, font>& fonts, const Profile* profile,
+	const chainMap* chains)
+{
+	store.Build(order, fonts, profile ? &profile->Scores() : nullptr, chains);
+	counters.Reset(store.Size());
+	filter.Build(store.Size());
+	for (size_t i = 0; i < store.Size(); ++i)
+	{
+		auto& cold = store.Cold(i);
+		auto key = store.Text(cold.keyOffset, cold.keyLen);
+		filter.Insert(key.data(), key.size());
+	}
+}
+
+std::vector<resolved> Engine::Resolve(const FaceSet& available)
+{
+	std::vector<resolved> out;
+	for (size_t i = 0; i < store.Size(); ++i)
+	{
+		size_t n = store.Candidates(i);
+		if (!n) continue;
+		auto& cold = store.Cold(i);
+		resolved r = { store.Text(cold.keyOffset, cold.keyLen), {}, 0, n, false };
+		for (size_t c = 0; c < n && !r.available; ++c)
+		{
+			if (available.Has(store.Candidate(i, c)))
+			{
+				r.candidate = c;
+				r.available = true;
+			}
+		}
+		// with none installed GDI picks a fallback for the first, as with a single name
+		store.Choose(i, r.candidate);
+		r.face = store.Candidate(i, r.candidate);
+		out.push_back(std::move(r));
+	}
+	return out;
+}
+
+bool Engine::Chained() const
+{
+	for (size_t i = 0; i < store.Size(); ++i)
+	{
+		if (store.Candidates(i)) return true;
+	}
+	return false;
+}
+
+void Engine::Record(Profile& profile) const
+{
+	std::vector<uint64_t> hits;
+	uint64_t misses;
+	counters.Read(hits, misses);
+	for (size_t i = 0; i < hits.size(); ++i)
+	{
+		if (uint64_t n = hits[i])
+		{
+			auto& cold = store.Cold(i);
+			profile.Add(store.Text(cold.keyOffset, cold.keyLen), n);
+		}
+	}
+}
+
+} // namespace rules
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "LogFont.hpp"
+#include "RuleCounters.hpp"
+#include "RuleFilter.hpp"
+#include "RuleImage.hpp"
+#include "RuleProfile.hpp"
+#include "RuleStore.hpp"
+
+// Rewrites a LOGFONTW by the configured rules, the part of the CreateFontIndirectExW hook
+// that does not depend on Windows.
+namespace rules {
+
+// Works on font and hotRule, which share the style field names
+template <typename Rule>
+void ApplyStyle(const Rule& rule, LOGFONTW& lf)
+{
+	auto flags = rule.overrideFlags;
+	if (flags & _HEIGHT)
+		lf.lfHeight = rule.height;
+	if (flags & _WIDTH)
+		lf.lfWidth = rule.width;
+	if (flags & _WEIGHT)
+		lf.lfWeight = rule.weight;
+	if (flags & _ITALIC)
+		lf.lfItalic = rule.italic;
+	if (flags & _UNDERLINE)
+		lf.lfUnderline = rule.underLine;
+	if (flags & _STRIKEOUT)
+		lf.lfStrikeOut = rule.strikeOut;
+	if (flags & _CHARSET)
+		lf.lfCharSet = rule.charSet;
+	if (flags & _OUTPRECISION)
+		lf.lfOutPrecision = rule.outPrecision;
+	if (flags & _CLIPPRECISION)
+		lf.lfClipPrecision = rule.clipPrecision;
+	if (flags & _QUALITY)
+		lf.lfQuality = rule.quality;
+	if (flags & _PITCHANDFAMILY)
+		lf.lfPitchAndFamily = rule.pitchAndFamily;
+}
+
+void ApplyRule(const font& rule, LOGFONTW& lf);
+
+// The face names that can be created, from one enumeration of the installed and registered fonts.
+// Compared without case like GDI does. The enumeration lists a font under one name, the localized
+// one on a localized UI, a name it did not list is asked of the probe once if one is set.
+class FaceSet
+{
+public:
+	using probe = std::function<bool(const std::wstring& face)>;
+
+	void Add(const std::wstring& face) { faces.insert(Fold(face)); }
+	void SetProbe(probe p) { ask = std::move(p); }
+
+	bool Has(const std::wstring& face) const
+	{
+		auto folded = Fold(face);
+		if (faces.count(folded)) return true;
+		if (!ask) return false;
+		auto it = asked.find(folded);
+		if (it == asked.end()) it = asked.emplace(folded, ask(face)).first;
+		return it->second;
+	}
+
+	size_t Size() const { return faces.size(); }
+
+private:
+	std::unordered_set<std::wstring> faces;
+	mutable std::unordered_map<std::wstring, bool> asked;
+	probe ask;
+
+	static std::wstring Fold(std::wstring s)
+	{
+		for (auto& c : s)
+			c = static_cast<wchar_t>(std::towlower(static_cast<wint_t>(c)));
+		return s;
+	}
+};
+
+// How a chained rule was resolved
+struct resolved
+{
+	std::wstring key;
+	std::wstring face;
+	size_t candidate; // of `candidates`, the first when none is available
+	size_t candidates;
+	bool available;
+};
+
+class Engine
+{
+public:
+	// `order` lists the keys in config order, `fonts` the parsed rules, the store is laid out by `profile` if given.
+	// Rules in `chains` choose their replacement by Resolve.
+	void Build(const std::vector<std::wstring>& order, const std::unordered_map<std::wstring, font>& fonts, const Profile* profile = nullptr,
+		const chainMap* chains = nullptr);
+
+	// Points every chained rule at its first candidate in `available`. Lookups may run meanwhile.
+	std::vector<resolved> Resolve(const FaceSet& available);
+	bool Chained() const;
+
+	// Hits per store rule and lookups without a rule since Build, summed over the threads
+	void ReadCounters(std::vector<uint64_t>& hits, uint64_t& misses) const { counters.Read(hits, misses); }
+	size_t CounterShards() const { return counters.Shards(); }
+	// Adds the hits counted so far to `profile`
+	void Record(Profile& profile) const;
+
+	// Rewrites `lf` by the rule for its face, false if there is none.
+	// Defined here so the hook gets it inlined.
+	bool Rewrite(LOGFONTW& lf) const
+	{
+		size_t len = wcsnlen(lf.lfFaceName, LF_FACESIZE);
+		const hotRule* rule = filter.MayContain(lf.lfFaceName, len) ? store.Find(lf.lfFaceName, len) : nullptr;
+		if (!rule)
+		{
+			counters.Miss();
+			return false;
+		}
+		counters.Hit(store.IndexOf(*rule));
+		store.CopyReplace(*rule, lf.lfFaceName);
+		ApplyStyle(*rule, lf);
+		return true;
+	}
+
+	const RuleStore& Store() const { return store; }
+	const filter::BlockedBloom& Filter() const { return filter; }
+
+private:
+	RuleStore store;
+	filter::BlockedBloom filter; // built from the store keys
+	mutable HitCounters counters; // always on, a few ns per lookup
+};
+
+} // namespace rules
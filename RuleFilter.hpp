@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cwchar>
+#include <vector>
+
+// Split block Bloom filter over the rule keys.
+// Most faces an application asks for have no rule, the filter rejects them with one
+// 32 byte block read instead of hashing the whole name and probing fontsMap.
+namespace filter {
+
+// Cheap key hash: the length, at most the first 8 and the last 4 characters.
+// The tail separates families sharing a prefix and length ("Segoe UI Light" / "Segoe UI Black").
+inline uint64_t FaceHash(const wchar_t* name, size_t len)
+{
+	uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+	size_t n = len < 8 ? len : 8;
+	for (size_t i = 0; i < n; ++i)
+		h = (h ^ static_cast<uint16_t>(name[i])) * 0x100000001B3ull;
+	for (size_t i = len > 12 ? len - 4 : n; i < len; ++i)
+		h = (h ^ static_cast<uint16_t>(name[i])) * 0x100000001B3ull;
+	// final mix so the block index (high bits) and bit positions (low bits) both depend on every char
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ull;
+	h ^= h >> 32;
+	return h;
+}
+
+class BlockedBloom
+{
+public:
+	static constexpr size_t BITS_PER_KEY = 16; // about 0.1% false positives
+
+	void Build(size_t keys)
+	{
+		size_t n = (keys * BITS_PER_KEY + 255) / 256;
+		blocks.assign(n ? n : 1, block{});
+	}
+
+	void Insert(uint64_t hash)
+	{
+		block& b = blocks[Index(hash)];
+		uint32_t key = static_cast<uint32_t>(hash);
+		for (int i = 0; i < 8; ++i)
+			b.words[i] |= Mask(key, i);
+	}
+
+	void Insert(const wchar_t* name, size_t len) { Insert(FaceHash(name, len)); }
+
+	// False means no rule for this face, true means look it up
+	bool MayContain(uint64_t hash) const
+	{
+		if (blocks.empty()) return true; // not built yet, let everything through
+		const block& b = blocks[Index(hash)];
+		uint32_t key = static_cast<uint32_t>(hash);
+		for (int i = 0; i < 8; ++i)
+		{
+			if (!(b.words[i] & Mask(key, i))) return false;
+		}
+		return true;
+	}
+
+	bool MayContain(const wchar_t* name, size_t len) const { return MayContain(FaceHash(name, len)); }
+
+	size_t Bytes() const { return blocks.size() * sizeof(block); }
+
+private:
+	struct alignas(32) block
+	{
+		uint32_t words[8];
+	};
+	std::vector<block> blocks;
+
+	size_t Index(uint64_t hash) const
+	{
+		return static_cast<size_t>(((hash >> 32) * blocks.size()) >> 32);
+	}
+
+	static uint32_t Mask(uint32_t key, int i)
+	{
+		static constexpr uint32_t SALT[8] = {
+			0x47B6137Bu, 0x44974D91u, 0x8824AD5Bu, 0xA2B7289Du,
+			0x705495C7u, 0x2DF1424Bu, 0x9EFC4947u, 0x5C6BFB31u };
+		return 1u << ((key * SALT[i]) >> 27);
+	}
+};
+
+} // namespace filter
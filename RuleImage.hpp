@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Plain rule images shared by FontMod and tools/embedrules.
+// A rule is a fixed size aggregate so rule sets can be emitted as constexpr tables.
+
+constexpr size_t FACE_SIZE = 32; // LF_FACESIZE
+
+// overrideflags
+constexpr uint32_t _NONE   = 0;
+constexpr uint32_t _HEIGHT = 1u << 1;
+constexpr uint32_t _WIDTH  = 1u << 2;
+constexpr uint32_t _WEIGHT = 1u << 3;
+constexpr uint32_t _ITALIC = 1u << 4;
+constexpr uint32_t _UNDERLINE = 1u << 5;
+constexpr uint32_t _STRIKEOUT = 1u << 6;
+constexpr uint32_t _CHARSET   = 1u << 7;
+constexpr uint32_t _OUTPRECISION  = 1u << 8;
+constexpr uint32_t _CLIPPRECISION = 1u << 9;
+constexpr uint32_t _QUALITY = 1u << 10;
+constexpr uint32_t _PITCHANDFAMILY = 1u << 11;
+
+// Field order is the initializer order written by tools/embedrules
+struct font
+{
+	wchar_t replace[FACE_SIZE];
+	uint32_t overrideFlags;
+	long height, width;
+	long weight;
+	bool italic, underLine, strikeOut;
+	uint8_t charSet;
+	uint8_t outPrecision, clipPrecision;
+	uint8_t quality;
+	uint8_t pitchAndFamily;
+};
+
+enum GSOFontMode {
+	DISABLED,
+	USE_NCM_FONT, // Use default font from SystemParametersInfo SPI_GETNONCLIENTMETRICS
+	USE_USER_FONT // Use user defined font
+};
+
+enum PrewarmMode {
+	PREWARM_OFF,
+	PREWARM_CREATE, // Create the replacement fonts in the background
+	PREWARM_SELECT  // Also select them into a memory DC so they get realized
+};
+
+// Minimal perfect hash over face names, "hash and displace":
+// a key's bucket holds either the seed of a second hash or, if negative, its slot directly.
+namespace embedded {
+
+struct rule
+{
+	wchar_t find[FACE_SIZE];
+	font image;
+};
+
+constexpr uint32_t FaceKeyHash(const wchar_t* name, size_t len, uint32_t seed)
+{
+	uint32_t h = 0x811C9DC5u ^ (seed * 0x01000193u);
+	for (size_t i = 0; i < len; ++i)
+	{
+		h ^= static_cast<uint16_t>(name[i]);
+		h *= 0x01000193u;
+	}
+	return h ^ (h >> 15);
+}
+
+constexpr size_t Slot(const int32_t* displacements, size_t count, const wchar_t* name, size_t len)
+{
+	int32_t d = displacements[FaceKeyHash(name, len, 0) % count];
+	return d < 0 ? static_cast<size_t>(-d - 1) : FaceKeyHash(name, len, static_cast<uint32_t>(d)) % count;
+}
+
+// `name` need not be terminated within `len`, the slot's key decides the match
+constexpr const rule* Find(const rule* rules, const int32_t* displacements, size_t count, const wchar_t* name, size_t len)
+{
+	if (count == 0 || len >= FACE_SIZE) return nullptr;
+	const rule& r = rules[Slot(displacements, count, name, len)];
+	for (size_t i = 0; i < len; ++i)
+	{
+		if (r.find[i] != name[i]) return nullptr;
+	}
+	return r.find[len] == L'\0' ? &r : nullptr;
+}
+
+} // namespace embedded
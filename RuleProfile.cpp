@@ -0,0 +1,76 @@
+#include "RuleProfile.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <system_error>
+
+#include "Transcode.hpp"
+
+namespace fs = std::filesystem;
+
+namespace rules {
+
+bool Profile::Load(const fs::path& fileName)
+{
+	std::ifstream in(fileName);
+	if (!in) return false;
+
+	heatMap loaded;
+	std::string line;
+	std::wstring key;
+	while (std::getline(in, line))
+	{
+		auto tab = line.find('\t');
+		if (tab == std::string::npos) continue;
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		char* end;
+		double score = strtod(line.c_str(), &end);
+		if (end != line.c_str() + tab || !(score > 0)) continue;
+		if (!Utf8ToUtf16(std::string_view(line).substr(tab + 1), key) || key.empty() || key.size() >= FACE_SIZE) continue;
+		loaded[key] += score;
+	}
+	scores.swap(loaded);
+	return true;
+}
+
+bool Profile::Save(const fs::path& fileName) const
+{
+	// several processes may exit at once, each writes its own file
+	auto tmp = fileName;
+	tmp += "." + std::to_string(std::random_device()()) + ".tmp";
+	{
+		std::ofstream out(tmp, std::ios::trunc);
+		if (!out) return false;
+		std::string key;
+		char score[32];
+		for (auto& [face, heat] : scores)
+		{
+			if (heat < PROFILE_MIN || !Utf16ToUtf8(face, key)) continue;
+			snprintf(score, sizeof(score), "%.1f\t", heat);
+			out << score << key << '\n';
+		}
+		out.close();
+		if (!out)
+		{
+			std::error_code ec;
+			fs::remove(tmp, ec);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(tmp, fileName, ec);
+	if (!ec) return true;
+	fs::remove(tmp, ec);
+	return false;
+}
+
+void Profile::Decay()
+{
+	for (auto& score : scores)
+		score.second *= PROFILE_DECAY;
+}
+
+} // namespace rules
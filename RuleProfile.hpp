@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "RuleStore.hpp"
+
+// Rule hit counts kept across runs in FontMod.profile, next to FontMod.yaml.
+// Every run adds its hits to the decayed scores of the runs before, so a face that
+// stops being asked for cools down over a few starts and is dropped.
+namespace rules {
+
+constexpr double PROFILE_DECAY = 0.5; // weight left to the earlier runs
+constexpr double PROFILE_MIN = 0.5;   // lower scores are dropped on save
+
+class Profile
+{
+public:
+	// One "score<TAB>UTF-8 face" per line, false if there is no readable profile
+	bool Load(const std::filesystem::path& fileName);
+	// Written to a temporary file first, a concurrent reader sees the old or the new profile
+	bool Save(const std::filesystem::path& fileName) const;
+
+	// Ages the loaded scores, called once before a run's hits are added
+	void Decay();
+	void Add(const std::wstring& key, uint64_t hits) { scores[key] += static_cast<double>(hits); }
+
+	const heatMap& Scores() const { return scores; }
+	bool Empty() const { return scores.empty(); }
+
+private:
+	heatMap scores;
+};
+
+} // namespace rules
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "RuleImage.hpp"
+
+// Rule storage laid out for the lookup.
+// Everything a lookup reads sits in one 64 byte hot record per rule, the rest in a
+// parallel cold array. Face names are interned once into a single UTF-16 arena, so a
+// hit on a short key touches the index, its hot record and the replacement text.
+// Given a profile the hottest rules come first: their records and names share cache
+// lines and they own their home slot in the index.
+namespace rules {
+
+constexpr size_t PREFIX = 10; // key characters kept in the hot record
+
+struct alignas(64) hotRule
+{
+	uint64_t hash;           // of the whole key
+	uint16_t keyLen;
+	uint16_t replaceLen;
+	uint32_t keyOffset;      // arena offset of the whole key, read when keyLen > PREFIX
+	uint32_t replaceOffset;
+	uint32_t overrideFlags;
+	uint16_t prefix[PREFIX];
+	int32_t height, width;
+	int32_t weight;
+	uint8_t italic, underLine, strikeOut;
+	uint8_t charSet;
+	uint8_t outPrecision, clipPrecision;
+	uint8_t quality;
+	uint8_t pitchAndFamily;
+};
+static_assert(sizeof(hotRule) == 64, "one cache line per rule");
+
+// Only read for diagnostics
+struct coldRule
+{
+	uint32_t keyOffset;
+	uint16_t keyLen;
+	uint16_t order; // position in the config
+};
+
+// Per-rule weight from earlier runs, rules without one keep config order behind the rest
+using heatMap = std::unordered_map<std::wstring, double>;
+
+// Replacement candidates of the rules whose `replace` is a list, in config order
+using chainMap = std::unordered_map<std::wstring, std::vector<std::wstring>>;
+
+// In hotRule::overrideFlags: the replacement is the chain candidate chosen last, not replaceOffset
+constexpr uint32_t CHAINED = 1u << 31;
+
+struct footprint
+{
+	size_t hot, cold, index, arena;
+
+	size_t Total() const { return hot + cold + index + arena; }
+};
+
+inline uint64_t KeyHash(const wchar_t* name, size_t len)
+{
+	uint64_t h = 0xCBF29CE484222325ull;
+	for (size_t i = 0; i < len; ++i)
+		h = (h ^ static_cast<uint16_t>(name[i])) * 0x100000001B3ull;
+	return h ^ (h >> 31);
+}
+
+class RuleStore
+{
+public:
+	// `order` lists the keys in config order, `images` the parsed rules, `heat` and `chains` are optional.
+	// A chained rule starts out with the replacement of its image, normally the first candidate.
+	void Build(const std::vector<std::wstring>& order, const std::unordered_map<std::wstring, font>& images, const heatMap* heat = nullptr,
+		const chainMap* chains = nullptr)
+	{
+		hot.clear();
+		cold.clear();
+		arena.clear();
+		candidates.clear();
+		std::unordered_map<std::wstring, uint32_t> interned;
+		hot.reserve(order.size());
+		cold.reserve(order.size());
+
+		struct pending
+		{
+			const std::wstring* key;
+			const font* image;
+			double heat;
+			uint16_t order;
+		};
+		std::vector<pending> rules;
+		for (const auto& key : order)
+		{
+			auto it = images.find(key);
+			if (it == images.end() || key.size() >= FACE_SIZE) continue;
+			double h = 0;
+			if (heat)
+			{
+				if (auto found = heat->find(key); found != heat->end()) h = found->second;
+			}
+			rules.push_back({ &key, &it->second, h, static_cast<uint16_t>(rules.size()) });
+		}
+		std::stable_sort(rules.begin(), rules.end(), [](const pending& a, const pending& b) { return a.heat > b.heat; });
+
+		for (const auto& r : rules)
+		{
+			const std::wstring& key = *r.key;
+			const font& f = *r.image;
+			std::wstring replace(f.replace, Length(f.replace));
+
+			hotRule h = {};
+			h.hash = KeyHash(key.data(), key.size());
+			h.keyLen = static_cast<uint16_t>(key.size());
+			// the replacement follows its key when both are new, a hit usually reads one arena line
+			h.keyOffset = Intern(interned, key);
+			h.replaceOffset = Intern(interned, replace);
+			h.replaceLen = static_cast<uint16_t>(replace.size());
+			for (size_t i = 0; i < PREFIX && i < key.size(); ++i)
+				h.prefix[i] = static_cast<uint16_t>(key[i]);
+			h.overrideFlags = f.overrideFlags;
+			h.height = static_cast<int32_t>(f.height);
+			h.width = static_cast<int32_t>(f.width);
+			h.weight = static_cast<int32_t>(f.weight);
+			h.italic = f.italic;
+			h.underLine = f.underLine;
+			h.strikeOut = f.strikeOut;
+			h.charSet = f.charSet;
+			h.outPrecision = f.outPrecision;
+			h.clipPrecision = f.clipPrecision;
+			h.quality = f.quality;
+			h.pitchAndFamily = f.pitchAndFamily;
+			std::vector<uint32_t> chain;
+			if (chains)
+			{
+				if (auto it = chains->find(key); it != chains->end() && it->second.size() > 1)
+				{
+					for (auto& face : it->second)
+						chain.push_back(Pack(Intern(interned, face), face.size()));
+					h.overrideFlags |= CHAINED;
+				}
+			}
+			hot.push_back(h);
+			cold.push_back({ h.keyOffset, h.keyLen, r.order });
+			candidates.push_back(std::move(chain));
+		}
+		chosen.reset(new std::atomic<uint32_t>[hot.size()]);
+		for (size_t i = 0; i < hot.size(); ++i)
+			chosen[i].store(Pack(hot[i].replaceOffset, hot[i].replaceLen), std::memory_order_relaxed);
+
+		size_t capacity = 4;
+		while (capacity < hot.size() * 2) capacity *= 2;
+		index.assign(capacity, 0);
+		// hottest first, so they never probe past a colder key
+		for (size_t i = 0; i < hot.size(); ++i)
+		{
+			size_t slot = hot[i].hash & (capacity - 1);
+			while (index[slot]) slot = (slot + 1) & (capacity - 1);
+			index[slot] = static_cast<uint32_t>(i + 1);
+		}
+		hot.shrink_to_fit();
+		cold.shrink_to_fit();
+		arena.shrink_to_fit();
+		candidates.shrink_to_fit();
+	}
+
+	const hotRule* Find(const wchar_t* name, size_t len) const
+	{
+		if (hot.empty()) return nullptr;
+		uint64_t hash = KeyHash(name, len);
+		size_t mask = index.size() - 1;
+		for (size_t slot = hash & mask; index[slot]; slot = (slot + 1) & mask)
+		{
+			const hotRule& h = hot[index[slot] - 1];
+			if (h.hash == hash && h.keyLen == len && Matches(h, name, len))
+				return &h;
+		}
+		return nullptr;
+	}
+
+	// Index slots read to find `name`, hit or miss; diagnostics only
+	size_t Probes(const wchar_t* name, size_t len) const
+	{
+		if (hot.empty()) return 0;
+		uint64_t hash = KeyHash(name, len);
+		size_t mask = index.size() - 1, probes = 1;
+		for (size_t slot = hash & mask; index[slot]; slot = (slot + 1) & mask, ++probes)
+		{
+			const hotRule& h = hot[index[slot] - 1];
+			if (h.hash == hash && h.keyLen == len && Matches(h, name, len))
+				break;
+		}
+		return probes;
+	}
+
+	// Copies the replacement face, `out` holds FACE_SIZE characters
+	void CopyReplace(const hotRule& h, wchar_t* out) const
+	{
+		uint32_t offset = h.replaceOffset, len = h.replaceLen;
+		if (h.overrideFlags & CHAINED)
+		{
+			// one word, so a concurrent Choose is seen whole
+			uint32_t c = chosen[IndexOf(h)].load(std::memory_order_relaxed);
+			offset = c >> LEN_BITS;
+			len = c & LEN_MASK;
+		}
+		const uint16_t* s = &arena[offset];
+		for (size_t i = 0; i < len; ++i)
+			out[i] = static_cast<wchar_t>(s[i]);
+		out[len] = L'\0';
+	}
+
+	// The replacement face as CopyReplace writes it
+	std::wstring Replace(const hotRule& h) const
+	{
+		wchar_t face[FACE_SIZE];
+		CopyReplace(h, face);
+		return face;
+	}
+
+	// Replacement candidates of rule `i`, 0 unless it is chained
+	size_t Candidates(size_t i) const { return candidates[i].size(); }
+
+	std::wstring Candidate(size_t i, size_t c) const
+	{
+		return Text(candidates[i][c] >> LEN_BITS, candidates[i][c] & LEN_MASK);
+	}
+
+	// Makes candidate `c` the replacement of chained rule `i`, safe while lookups run
+	void Choose(size_t i, size_t c)
+	{
+		chosen[i].store(candidates[i][c], std::memory_order_relaxed);
+	}
+
+	size_t Size() const { return hot.size(); }
+	size_t IndexOf(const hotRule& h) const { return static_cast<size_t>(&h - hot.data()); }
+	const hotRule& Hot(size_t i) const { return hot[i]; }
+	const coldRule& Cold(size_t i) const { return cold[i]; }
+
+	std::wstring Text(uint32_t offset, size_t len) const
+	{
+		return std::wstring(arena.begin() + offset, arena.begin() + offset + len);
+	}
+
+	footprint Footprint() const
+	{
+		size_t chains = 0;
+		for (auto& c : candidates)
+			chains += c.capacity() * sizeof(uint32_t);
+		return { hot.capacity() * sizeof(hotRule), cold.capacity() * sizeof(coldRule) + chains,
+			index.capacity() * sizeof(uint32_t), arena.capacity() * sizeof(uint16_t) };
+	}
+
+private:
+	std::vector<hotRule> hot;
+	std::vector<coldRule> cold;
+	std::vector<uint32_t> index; // open addressing, rule index + 1, 0 is empty
+	std::vector<uint16_t> arena; // interned UTF-16 names, each NUL terminated
+	std::vector<std::vector<uint32_t>> candidates; // per rule, packed like `chosen`, empty if not chained
+	std::unique_ptr<std::atomic<uint32_t>[]> chosen; // per rule, arena offset << LEN_BITS | length
+
+	static constexpr uint32_t LEN_BITS = 5; // face names are shorter than FACE_SIZE
+	static constexpr uint32_t LEN_MASK = (1u << LEN_BITS) - 1;
+
+	static uint32_t Pack(uint32_t offset, size_t len) { return offset << LEN_BITS | static_cast<uint32_t>(len); }
+
+	static size_t Length(const wchar_t* s)
+	{
+		size_t n = 0;
+		while (n < FACE_SIZE && s[n]) ++n;
+		return n;
+	}
+
+	uint32_t Intern(std::unordered_map<std::wstring, uint32_t>& interned, const std::wstring& s)
+	{
+		auto [it, added] = interned.emplace(s, static_cast<uint32_t>(arena.size()));
+		if (added)
+		{
+			for (wchar_t c : s)
+				arena.push_back(static_cast<uint16_t>(c));
+			arena.push_back(0);
+		}
+		return it->second;
+	}
+
+	bool Matches(const hotRule& h, const wchar_t* name, size_t len) const
+	{
+		size_t n = len < PREFIX ? len : PREFIX;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (h.prefix[i] != static_cast<uint16_t>(name[i])) return false;
+		}
+		const uint16_t* key = &arena[h.keyOffset];
+		for (size_t i = n; i < len; ++i)
+		{
+			if (key[i] != static_cast<uint16_t>(name[i])) return false;
+		}
+		return true;
+	}
+};
+
+} // namespace rules
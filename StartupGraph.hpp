@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Startup steps and what each of them needs, every step runs as soon as its
+// dependencies are done. The thread calling Run works through the graph itself, helper
+// threads only join in: it never waits for a step no one has started, so a helper that
+// can not start yet (created under the loader lock) makes the run serial, not stuck.
+// Helpers only take steps added as concurrent. The caller may have to wait for one of those,
+// so they must not need anything the caller holds: under the loader lock no DLL loads and
+// no USER or GDI, only file reads and memory.
+namespace startup {
+
+using task_id = size_t;
+
+struct task
+{
+	const char* name; // static string
+	std::function<void()> work; // must not throw
+	std::vector<task_id> deps;
+	bool concurrent;  // may run on a helper, else on the thread calling Run
+	int64_t begin;    // ns since Run started, -1 until run
+	int64_t duration;
+	uint32_t worker;  // 0 is the thread calling Run
+};
+
+class Graph
+{
+public:
+	Graph() : s(std::make_shared<state>()) {}
+
+	// Dependencies are added first, which keeps the graph acyclic
+	task_id Add(const char* name, std::function<void()> work, std::initializer_list<task_id> deps = {}, bool concurrent = false)
+	{
+		task t = { name, std::move(work), {}, concurrent, -1, 0, 0 };
+		for (task_id d : deps)
+		{
+			if (d < s->tasks.size()) t.deps.push_back(d);
+		}
+		s->tasks.push_back(std::move(t));
+		return s->tasks.size() - 1;
+	}
+
+	// `spawn` is handed `helpers` functions to run on other threads. They may start any time,
+	// also after Run returned, and leave at once if there is nothing left for them.
+	void Run(const std::function<void(std::function<void()>)>& spawn = nullptr, size_t helpers = 0)
+	{
+		{
+			std::lock_guard<std::mutex> hold(s->lock);
+			s->dependents.assign(s->tasks.size(), {});
+			s->waiting.assign(s->tasks.size(), 0);
+			for (task_id i = 0; i < s->tasks.size(); ++i)
+			{
+				s->waiting[i] = s->tasks[i].deps.size();
+				for (task_id d : s->tasks[i].deps)
+					s->dependents[d].push_back(i);
+				if (s->waiting[i] == 0) s->ready.push_back(i);
+			}
+			s->origin = std::chrono::steady_clock::now();
+		}
+		if (spawn)
+		{
+			for (size_t i = 0; i < helpers; ++i)
+			{
+				std::shared_ptr<state> shared = s;
+				spawn([shared] { Work(*shared, false); });
+			}
+		}
+		Work(*s, true);
+
+		std::lock_guard<std::mutex> hold(s->lock);
+		s->elapsed = Now(*s);
+		for (auto& t : s->tasks)
+			t.work = nullptr; // the steps may refer to the caller's locals, a late helper outlives them
+	}
+
+	// Longest chain of step durations along the dependencies, the startup time with threads to spare.
+	// `path` gets the chain's steps in order.
+	int64_t CriticalPath(std::vector<task_id>* path = nullptr) const
+	{
+		std::lock_guard<std::mutex> hold(s->lock);
+		size_t n = s->tasks.size();
+		std::vector<int64_t> finish(n, 0);
+		std::vector<task_id> via(n, SIZE_MAX);
+		task_id last = SIZE_MAX;
+		for (task_id i = 0; i < n; ++i)
+		{
+			int64_t start = 0;
+			for (task_id d : s->tasks[i].deps)
+			{
+				if (finish[d] > start)
+				{
+					start = finish[d];
+					via[i] = d;
+				}
+			}
+			finish[i] = start + s->tasks[i].duration;
+			if (last == SIZE_MAX || finish[i] > finish[last]) last = i;
+		}
+		if (path)
+		{
+			path->clear();
+			for (task_id i = last; i != SIZE_MAX; i = via[i])
+				path->push_back(i);
+			std::reverse(path->begin(), path->end());
+		}
+		return last == SIZE_MAX ? 0 : finish[last];
+	}
+
+	// Wall time of Run in ns
+	int64_t Elapsed() const
+	{
+		std::lock_guard<std::mutex> hold(s->lock);
+		return s->elapsed;
+	}
+
+	size_t Size() const { return s->tasks.size(); }
+
+	task At(task_id i) const
+	{
+		std::lock_guard<std::mutex> hold(s->lock);
+		task t = s->tasks[i];
+		t.work = nullptr;
+		return t;
+	}
+
+private:
+	struct state
+	{
+		std::mutex lock;
+		std::condition_variable changed;
+		std::vector<task> tasks;
+		std::vector<std::vector<task_id>> dependents;
+		std::vector<size_t> waiting; // unfinished dependencies
+		std::vector<task_id> ready;
+		size_t done = 0;
+		uint32_t workers = 0;
+		std::chrono::steady_clock::time_point origin;
+		int64_t elapsed = 0;
+	};
+	std::shared_ptr<state> s;
+
+	static int64_t Now(const state& s)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s.origin).count();
+	}
+
+	static void Work(state& s, bool caller)
+	{
+		std::unique_lock<std::mutex> hold(s.lock);
+		uint32_t worker = caller ? 0 : ++s.workers;
+		for (;;)
+		{
+			auto next = std::find_if(s.ready.begin(), s.ready.end(), [&](task_id i) { return caller || s.tasks[i].concurrent; });
+			if (next == s.ready.end())
+			{
+				if (s.done == s.tasks.size()) return;
+				// the caller only gets here while a helper runs a step, which will finish
+				s.changed.wait(hold);
+				continue;
+			}
+
+			task_id i = *next;
+			s.ready.erase(next);
+			task& t = s.tasks[i];
+			t.worker = worker;
+			t.begin = Now(s);
+			hold.unlock();
+			t.work();
+			hold.lock();
+			t.duration = Now(s) - t.begin;
+
+			++s.done;
+			for (task_id d : s.dependents[i])
+			{
+				if (--s.waiting[d] == 0) s.ready.push_back(d);
+			}
+			s.changed.notify_all();
+		}
+	}
+};
+
+} // namespace startup
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// Nested startup spans written as trace event JSON ("X" complete events),
+// loadable in chrome://tracing, Perfetto or Speedscope.
+// Spans are kept in fixed arrays, recording is cheap enough to always run and only
+// writing the file is opt-in. Each recording thread nests its spans in its own lane.
+namespace trace {
+
+constexpr size_t MAX_EVENTS = 256;
+constexpr size_t MAX_DEPTH = 16;
+constexpr size_t MAX_LANES = 8; // threads recording spans, later ones are dropped
+
+struct event
+{
+	const char* name; // static string
+	char arg[64];     // optional detail, UTF-8
+	int64_t begin;    // ns since the recorder was created
+	int64_t duration;
+	uint32_t lane;    // 0 is the first recording thread
+};
+
+class Recorder
+{
+public:
+	Recorder() : origin(std::chrono::steady_clock::now()) {}
+
+	// Opens a span inside the innermost open one, `arg` is truncated to fit
+	void Begin(const char* name, const char* arg = nullptr)
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		lane* l = Lane(true);
+		if (!l)
+		{
+			++dropped; // End finds no lane either
+			return;
+		}
+		// Dropped spans still take their Begin/End pair
+		if (l->depth == MAX_DEPTH)
+		{
+			++l->overflow;
+			++dropped;
+			return;
+		}
+		if (count == MAX_EVENTS)
+		{
+			l->open[l->depth++] = SIZE_MAX;
+			++dropped;
+			return;
+		}
+		event& e = events[count];
+		e.name = name;
+		e.arg[0] = '\0';
+		if (arg)
+		{
+			size_t len = strlen(arg);
+			if (len >= sizeof(e.arg))
+			{
+				len = sizeof(e.arg) - 1;
+				while (len > 0 && (static_cast<unsigned char>(arg[len]) & 0xC0) == 0x80) --len; // whole UTF-8 sequences
+			}
+			memcpy(e.arg, arg, len);
+			e.arg[len] = '\0';
+		}
+		e.begin = Now();
+		e.duration = -1;
+		e.lane = static_cast<uint32_t>(l - lanes);
+		l->open[l->depth++] = count++;
+	}
+
+	void End()
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		lane* l = Lane(false);
+		if (!l) return;
+		if (l->overflow)
+		{
+			--l->overflow;
+			return;
+		}
+		if (l->depth == 0) return;
+		size_t i = l->open[--l->depth];
+		if (i != SIZE_MAX)
+			events[i].duration = Now() - events[i].begin;
+	}
+
+	// Recorded into the file's otherData, `value` is a JSON number
+	void Note(const char* key, double value)
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		if (notes < MAX_NOTES)
+			noted[notes++] = { key, value };
+	}
+
+	size_t Count() const { return count; }
+	const event& operator[](size_t i) const { return events[i]; }
+
+	// Writes {"traceEvents": [...]}, spans still open are closed at the current time.
+	// Lane 0 is shown as thread `tid`, the helper lanes by their number.
+	bool Write(FILE* out, uint32_t pid, uint32_t tid) const
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		int64_t now = Now();
+		fputs("{\"traceEvents\":[\n", out);
+		fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"FontMod startup\"}}", pid, tid);
+		for (size_t i = 1; i < used; ++i)
+			fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%zu,\"args\":{\"name\":\"startup helper %zu\"}}", pid, i, i);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const event& e = events[i];
+			int64_t duration = e.duration < 0 ? now - e.begin : e.duration;
+			fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u",
+				e.name, e.begin / 1000.0, duration / 1000.0, pid, e.lane ? e.lane : tid);
+			if (e.arg[0])
+			{
+				fputs(",\"args\":{\"detail\":\"", out);
+				WriteEscaped(out, e.arg);
+				fputs("\"}", out);
+			}
+			fputc('}', out);
+		}
+		fprintf(out, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%zu", dropped);
+		for (size_t i = 0; i < notes; ++i)
+			fprintf(out, ",\"%s\":%.3f", noted[i].key, noted[i].value);
+		fputs("}}\n", out);
+		return !ferror(out);
+	}
+
+private:
+	static constexpr size_t MAX_NOTES = 8;
+
+	struct lane
+	{
+		std::thread::id thread;
+		size_t open[MAX_DEPTH];
+		size_t depth = 0;
+		size_t overflow = 0; // Begin calls past MAX_DEPTH
+	};
+
+	struct note
+	{
+		const char* key; // static string
+		double value;
+	};
+
+	std::chrono::steady_clock::time_point origin;
+	mutable std::mutex lock; // uncontended on a single thread
+	event events[MAX_EVENTS];
+	lane lanes[MAX_LANES];
+	note noted[MAX_NOTES];
+	size_t count = 0;
+	size_t used = 0; // lanes
+	size_t notes = 0;
+	size_t dropped = 0;
+
+	lane* Lane(bool add)
+	{
+		auto self = std::this_thread::get_id();
+		for (size_t i = 0; i < used; ++i)
+		{
+			if (lanes[i].thread == self) return &lanes[i];
+		}
+		if (!add || used == MAX_LANES) return nullptr;
+		lanes[used].thread = self;
+		return &lanes[used++];
+	}
+
+	int64_t Now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+	}
+
+	static void WriteEscaped(FILE* out, const char* s)
+	{
+		for (; *s; ++s)
+		{
+			unsigned char c = static_cast<unsigned char>(*s);
+			if (c == '"' || c == '\\')
+				fprintf(out, "\\%c", c);
+			else if (c < 0x20)
+				fprintf(out, "\\u%04x", c);
+			else
+				fputc(c, out);
+		}
+	}
+};
+
+} // namespace trace
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Per-process counters published in one named shared-memory segment,
+// so every FontMod instance on the desktop can be watched with fontmod-top.
+namespace stats {
+
+constexpr uint32_t SEGMENT_MAGIC = 0x54534D46; // "FMST"
+constexpr uint32_t SEGMENT_VERSION = 1;
+constexpr size_t MAX_INSTANCES = 128;
+
+#ifdef _WIN32
+using segmentName = const wchar_t*;
+constexpr wchar_t SEGMENT_NAME[] = L"Local\\FontMod.Stats"; // per session
+#else
+using segmentName = const char*;
+constexpr char SEGMENT_NAME[] = "/fontmod.stats";
+#endif
+
+// One slot per process. Only the owning process writes it, relaxed atomics are enough.
+struct alignas(64) instance
+{
+	std::atomic<uint32_t> pid; // 0 if free
+	uint32_t reserved;
+	std::atomic<int64_t> startTime; // seconds since epoch
+	char exe[48];                   // UTF-8, truncated
+
+	std::atomic<uint64_t> hookCalls;
+	std::atomic<uint64_t> ruleHits;
+	std::atomic<uint64_t> ruleMisses;
+	std::atomic<uint64_t> fontsCreated;
+	std::atomic<uint64_t> userFonts;
+	std::atomic<uint64_t> initTimeUs;
+	std::atomic<uint64_t> firstHitNs; // CreateFontIndirectExW time of the first rewritten font, 0 until then
+	std::atomic<uint64_t> prewarmUs;  // 0 unless pre-warming finished
+};
+static_assert(sizeof(instance) == 128, "instance layout is shared between processes");
+
+struct segment
+{
+	std::atomic<uint32_t> magic; // written last
+	uint32_t version;
+	uint32_t instanceSize;
+	uint32_t maxInstances;
+	alignas(64) instance instances[MAX_INSTANCES];
+};
+
+inline void Add(std::atomic<uint64_t>& counter, uint64_t n = 1)
+{
+	counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline bool ProcessAlive(uint32_t pid)
+{
+#ifdef _WIN32
+	HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if (!h) return false;
+	DWORD code = 0;
+	bool alive = GetExitCodeProcess(h, &code) && code == STILL_ACTIVE;
+	CloseHandle(h);
+	return alive;
+#else
+	return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+inline uint32_t CurrentPid()
+{
+#ifdef _WIN32
+	return GetCurrentProcessId();
+#else
+	return static_cast<uint32_t>(getpid());
+#endif
+}
+
+// Maps the shared segment, creating it on first use.
+class SharedSegment
+{
+public:
+	SharedSegment() = default;
+	SharedSegment(const SharedSegment&) = delete;
+	SharedSegment& operator=(const SharedSegment&) = delete;
+	~SharedSegment() { Close(); }
+
+	// Another `name` than SEGMENT_NAME keeps the segment apart from the running instances, for tests
+	bool Open(bool readOnly = false, segmentName name = SEGMENT_NAME)
+	{
+#ifdef _WIN32
+		if (readOnly)
+			mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, name);
+		else
+			mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(segment), name);
+		if (!mapping) return false;
+		void* p = MapViewOfFile(mapping, readOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, sizeof(segment));
+		if (!p)
+		{
+			Close();
+			return false;
+		}
+		seg = static_cast<segment*>(p);
+#else
+		int fd = shm_open(name, readOnly ? O_RDONLY : O_RDWR | O_CREAT, 0600);
+		if (fd < 0) return false;
+		struct stat st;
+		if (!readOnly && fstat(fd, &st) == 0 && st.st_size < static_cast<off_t>(sizeof(segment)))
+		{
+			if (ftruncate(fd, sizeof(segment)) != 0)
+			{
+				close(fd);
+				return false;
+			}
+		}
+		void* p = mmap(nullptr, sizeof(segment), readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED) return false;
+		seg = static_cast<segment*>(p);
+#endif
+		if (!readOnly && seg->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC)
+		{
+			// New segments are zero filled, racing creators write identical values
+			seg->version = SEGMENT_VERSION;
+			seg->instanceSize = sizeof(instance);
+			seg->maxInstances = MAX_INSTANCES;
+			seg->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+		}
+		return true;
+	}
+
+	// True if the layout is the one this build understands
+	bool Valid() const
+	{
+		return seg && seg->magic.load(std::memory_order_acquire) == SEGMENT_MAGIC &&
+			seg->version == SEGMENT_VERSION && seg->instanceSize == sizeof(instance) &&
+			seg->maxInstances == MAX_INSTANCES;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (seg) UnmapViewOfFile(seg);
+		if (mapping) CloseHandle(mapping);
+		mapping = nullptr;
+#else
+		if (seg) munmap(seg, sizeof(segment));
+#endif
+		seg = nullptr;
+	}
+
+	segment* get() const { return seg; }
+
+	// Claim a free slot, or one left behind by a dead process
+	instance* Claim(uint32_t pid, const char* exe)
+	{
+		if (!Valid()) return nullptr;
+		for (auto& inst : seg->instances)
+		{
+			uint32_t owner = inst.pid.load(std::memory_order_relaxed);
+			if (owner != 0 && (owner == pid || ProcessAlive(owner))) continue;
+			if (!inst.pid.compare_exchange_strong(owner, pid, std::memory_order_acq_rel)) continue;
+
+			Reset(inst);
+			size_t len = strlen(exe);
+			if (len >= sizeof(inst.exe)) len = sizeof(inst.exe) - 1;
+			memcpy(inst.exe, exe, len);
+			inst.exe[len] = '\0';
+			inst.startTime.store(std::chrono::duration_cast<std::chrono::seconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+			return &inst;
+		}
+		return nullptr;
+	}
+
+	static void Release(instance* inst)
+	{
+		if (!inst) return;
+		inst->pid.store(0, std::memory_order_release);
+	}
+
+private:
+	segment* seg = nullptr;
+#ifdef _WIN32
+	HANDLE mapping = nullptr;
+#endif
+
+	static void Reset(instance& inst)
+	{
+		inst.startTime.store(0, std::memory_order_relaxed);
+		memset(inst.exe, 0, sizeof(inst.exe));
+		inst.hookCalls.store(0, std::memory_order_relaxed);
+		inst.ruleHits.store(0, std::memory_order_relaxed);
+		inst.ruleMisses.store(0, std::memory_order_relaxed);
+		inst.fontsCreated.store(0, std::memory_order_relaxed);
+		inst.userFonts.store(0, std::memory_order_relaxed);
+		inst.initTimeUs.store(0, std::memory_order_relaxed);
+		inst.firstHitNs.store(0, std::memory_order_relaxed);
+		inst.prewarmUs.store(0, std::memory_order_relaxed);
+	}
+};
+
+} // namespace stats
@@ -0,0 +1,201 @@
+#include "Transcode.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+// https://msdn.microsoft.com/en-us/magazine/mt763237
+bool Utf8ToUtf16(const std::string_view& utf8, std::wstring& utf16)
+{
+	if (utf8.empty())
+	{
+		utf16.clear();
+		return true;
+	}
+
+	constexpr DWORD kFlags = MB_ERR_INVALID_CHARS;
+
+	const int utf8Length = static_cast<int>(utf8.length());
+
+	const int utf16Length = MultiByteToWideChar(
+		CP_UTF8,
+		kFlags,
+		utf8.data(),
+		utf8Length,
+		nullptr,
+		0
+	);
+
+	if (utf16Length == 0)
+	{
+		return false;
+	}
+
+	utf16.resize(utf16Length);
+
+	int result = MultiByteToWideChar(
+		CP_UTF8,
+		kFlags,
+		utf8.data(),
+		utf8Length,
+		utf16.data(),
+		utf16Length
+	);
+
+	if (result == 0)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool Utf16ToUtf8(const std::wstring_view& utf16, std::string& utf8)
+{
+	if (utf16.empty())
+	{
+		utf8.clear();
+		return true;
+	}
+
+	constexpr DWORD kFlags = WC_ERR_INVALID_CHARS;
+
+	const int utf16Length = static_cast<int>(utf16.length());
+
+	const int utf8Length = WideCharToMultiByte(
+		CP_UTF8,
+		kFlags,
+		utf16.data(),
+		utf16Length,
+		nullptr,
+		0,
+		nullptr, nullptr
+	);
+
+	if (utf8Length == 0)
+	{
+		return false;
+	}
+
+	utf8.resize(utf8Length);
+
+	int result = WideCharToMultiByte(
+		CP_UTF8,
+		kFlags,
+		utf16.data(),
+		utf16Length,
+		utf8.data(),
+		utf8Length,
+		nullptr, nullptr
+	);
+
+	if (result == 0)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+#else
+#include <cstdint>
+
+namespace {
+
+constexpr bool WIDE_UTF16 = sizeof(wchar_t) == 2;
+
+bool IsSurrogate(uint32_t cp)
+{
+	return cp >= 0xD800 && cp <= 0xDFFF;
+}
+
+} // namespace
+
+bool Utf8ToUtf16(const std::string_view& utf8, std::wstring& utf16)
+{
+	std::wstring out;
+	out.reserve(utf8.size());
+	for (size_t i = 0; i < utf8.size();)
+	{
+		unsigned char c = utf8[i];
+		uint32_t cp;
+		size_t n;
+		if (c < 0x80) { cp = c; n = 1; }
+		else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; n = 2; }
+		else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; n = 3; }
+		else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; n = 4; }
+		else return false;
+		if (i + n > utf8.size()) return false;
+		for (size_t k = 1; k < n; ++k)
+		{
+			unsigned char cc = utf8[i + k];
+			if ((cc & 0xC0) != 0x80) return false;
+			cp = (cp << 6) | (cc & 0x3F);
+		}
+		// overlong forms, surrogates and values past U+10FFFF are rejected like MB_ERR_INVALID_CHARS does
+		static const uint32_t minimum[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+		if (cp < minimum[n] || cp > 0x10FFFF || IsSurrogate(cp)) return false;
+		i += n;
+
+		if (WIDE_UTF16 && cp >= 0x10000)
+		{
+			cp -= 0x10000;
+			out += static_cast<wchar_t>(0xD800 + (cp >> 10));
+			out += static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+		}
+		else
+		{
+			out += static_cast<wchar_t>(cp);
+		}
+	}
+	utf16.swap(out);
+	return true;
+}
+
+bool Utf16ToUtf8(const std::wstring_view& utf16, std::string& utf8)
+{
+	std::string out;
+	out.reserve(utf16.size());
+	for (size_t i = 0; i < utf16.size(); ++i)
+	{
+		uint32_t cp = static_cast<uint32_t>(utf16[i]);
+		if (WIDE_UTF16 && cp >= 0xD800 && cp <= 0xDBFF && i + 1 < utf16.size())
+		{
+			uint32_t low = static_cast<uint32_t>(utf16[i + 1]);
+			if (low >= 0xDC00 && low <= 0xDFFF)
+			{
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				++i;
+			}
+		}
+		if (IsSurrogate(cp) || cp > 0x10FFFF) return false;
+
+		if (cp < 0x80)
+		{
+			out += static_cast<char>(cp);
+		}
+		else if (cp < 0x800)
+		{
+			out += static_cast<char>(0xC0 | cp >> 6);
+			out += static_cast<char>(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | cp >> 12);
+			out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+			out += static_cast<char>(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | cp >> 18);
+			out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+			out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+			out += static_cast<char>(0x80 | (cp & 0x3F));
+		}
+	}
+	utf8.swap(out);
+	return true;
+}
+
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// UTF-8 to and from wchar_t strings, which hold UTF-16 on Windows and UTF-32 elsewhere.
+// Malformed input fails instead of being replaced.
+bool Utf8ToUtf16(const std::string_view& utf8, std::wstring& utf16);
+bool Utf16ToUtf8(const std::wstring_view& utf16, std::string& utf8);
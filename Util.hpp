@@ -10,142 +10,6 @@ namespace bitflag {
 	constexpr uint32_t bitflagAt(unsigned idx) { return 0b1 << idx; }
 };
 
-// https://msdn.microsoft.com/en-us/magazine/mt763237
-bool Utf8ToUtf16(const std::string_view& utf8, std::wstring& utf16)
-{
-	if (utf8.empty())
-	{
-		utf16.clear();
-		return true;
-	}
-
-	constexpr DWORD kFlags = MB_ERR_INVALID_CHARS;
-
-	const int utf8Length = static_cast<int>(utf8.length());
-
-	const int utf16Length = MultiByteToWideChar(
-		CP_UTF8,
-		kFlags,
-		utf8.data(),
-		utf8Length,
-		nullptr,
-		0
-	);
-
-	if (utf16Length == 0)
-	{
-		return false;
-	}
-
-	utf16.resize(utf16Length);
-
-	int result = MultiByteToWideChar(
-		CP_UTF8,
-		kFlags,
-		utf8.data(),
-		utf8Length,
-		utf16.data(),
-		utf16Length
-	);
-
-	if (result == 0)
-	{
-		return false;
-	}
-
-	return true;
-}
-
-bool Utf16ToUtf8(const std::wstring_view& utf16, std::string& utf8)
-{
-	if (utf16.empty())
-	{
-		utf8.clear();
-		return true;
-	}
-
-	constexpr DWORD kFlags = WC_ERR_INVALID_CHARS;
-
-	const int utf16Length = static_cast<int>(utf16.length());
-
-	const int utf8Length = WideCharToMultiByte(
-		CP_UTF8,
-		kFlags,
-		utf16.data(),
-		utf16Length,
-		nullptr,
-		0,
-		nullptr, nullptr
-	);
-
-	if (utf8Length == 0)
-	{
-		return false;
-	}
-
-	utf8.resize(utf8Length);
-
-	int result = WideCharToMultiByte(
-		CP_UTF8,
-		kFlags,
-		utf16.data(),
-		utf16Length,
-		utf8.data(),
-		utf8Length,
-		nullptr, nullptr
-	);
-
-	if (result == 0)
-	{
-		return false;
-	}
-
-	return true;
-}
-
-inline bool stol(const std::string& str, long& out)
-{
-	int& errno_ref = errno;
-	const char *ptr = str.c_str();
-	char *eptr;
-	errno_ref = 0;
-	out = strtol(ptr, &eptr, 10);
-
-	if (ptr == eptr)
-		return false;
-	if (errno_ref == ERANGE)
-		return false;
-	return true;
-}
-
-inline bool stoul(const std::string& str, unsigned long& out)
-{
-	int& errno_ref = errno;
-	const char *ptr = str.c_str();
-	char *eptr;
-	errno_ref = 0;
-	out = strtoul(ptr, &eptr, 10);
-
-	if (ptr == eptr)
-		return false;
-	if (errno_ref == ERANGE)
-		return false;
-	return true;
-}
-
-template <typename Key>
-YAML::Node FindNode(const YAML::Node& node, const Key& key)
-{
-	if (auto merge = node["<<"]; merge.IsDefined())
-	{
-		if (auto child = FindNode(merge, key); child.IsDefined())
-		{
-			return child;
-		}
-	}
-	return node[key];
-}
-
 // https://docs.microsoft.com/en-us/windows/uwp/cpp-and-winrt-apis/author-coclasses#add-helper-types-and-functions
 auto GetModuleFsPath(HMODULE hModule)
 {
@@ -171,11 +35,12 @@ auto GetModuleFsPath(HMODULE hModule)
 fs::path GetModuleFsPath_(HMODULE mod)
 {
 	std::wstring pathstr(MAX_PATH, L'\0');
-	DWORD actualsize = GetModuleFileNameW(mod, pathstr.data(), pathsize);
-	for (size_t pathsize = pathstr.size();
-			static_cast<DWORD>(pathsize) <= actualsize;
-			pathsize = pathstr.size()) {
-		pathstr.resize(pathsize * 2);
+	DWORD actualsize = GetModuleFileNameW(mod, pathstr.data(), static_cast<DWORD>(pathstr.size()));
+	// a truncated path fills the whole buffer
+	while (actualsize >= pathstr.size())
+	{
+		pathstr.resize(pathstr.size() * 2);
+		actualsize = GetModuleFileNameW(mod, pathstr.data(), static_cast<DWORD>(pathstr.size()));
 	}
 	pathstr.resize(actualsize);
 	return fs::path(pathstr).remove_filename();
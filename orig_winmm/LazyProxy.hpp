@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+// Lazily resolved proxy exports.
+// Every export slot starts out pointing at a resolver, the first call through it loads
+// the real DLL if needed, looks up that one symbol and swaps it into the slot.
+namespace proxy {
+
+struct symbol
+{
+	const char* name; // nullptr for ordinal-only exports
+	uint16_t ordinal;
+};
+
+#ifdef _WIN32
+struct SystemLoader
+{
+	// Always load from the system directory, the application directory holds ourselves
+	static void* Open(const char* dllName)
+	{
+		wchar_t path[MAX_PATH];
+		UINT len = GetSystemDirectoryW(path, MAX_PATH);
+		if (len == 0 || len + 1 + strlen(dllName) >= MAX_PATH) return nullptr;
+		path[len++] = L'\\';
+		for (const char* p = dllName; *p; ++p)
+			path[len++] = static_cast<wchar_t>(*p);
+		path[len] = L'\0';
+		return LoadLibraryW(path);
+	}
+
+	static void* Find(void* module, const symbol& sym)
+	{
+		auto name = sym.name ? sym.name : MAKEINTRESOURCEA(sym.ordinal);
+		return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(module), name));
+	}
+};
+#else
+struct SystemLoader
+{
+	static void* Open(const char* dllName)
+	{
+		return dlopen(dllName, RTLD_NOW | RTLD_LOCAL);
+	}
+
+	// ELF has no ordinals
+	static void* Find(void* module, const symbol& sym)
+	{
+		return sym.name ? dlsym(module, sym.name) : nullptr;
+	}
+};
+#endif
+
+template <size_t N, typename Loader = SystemLoader>
+class LazyTable
+{
+public:
+	// `slots` is the contiguous table read by the export thunks, `resolver` its initial value.
+	// `missing` stands in for exports the real DLL lacks, or all of them if it did not load.
+	LazyTable(std::atomic<void*> (&slots)[N], const char* dllName, const symbol (&symbols)[N], void* resolver, void* missing)
+		: slots(slots), dllName(dllName), symbols(symbols), resolver(resolver), missing(missing)
+	{
+		for (auto& s : slots)
+			s.store(resolver, std::memory_order_relaxed);
+	}
+
+	// Called by the resolver thunk with the slot it was entered through
+	void* Resolve(const std::atomic<void*>* slot)
+	{
+		return Resolve(static_cast<size_t>(slot - slots));
+	}
+
+	// Never returns nullptr, the thunk jumps to whatever comes back
+	void* Resolve(size_t index)
+	{
+		if (index >= N) return missing;
+		void* fn = slots[index].load(std::memory_order_acquire);
+		if (fn != resolver) return fn;
+
+		std::call_once(loaded, [this] { module = Loader::Open(dllName); });
+		fn = module ? Loader::Find(module, symbols[index]) : nullptr;
+		// Neither the load nor the lookup is retried, later calls go straight to `missing`
+		if (!fn) fn = missing;
+
+		// Racing callers resolve the same address, first store wins
+		void* expected = resolver;
+		slots[index].compare_exchange_strong(expected, fn, std::memory_order_acq_rel);
+		return fn;
+	}
+
+	bool IsResolved(size_t index) const
+	{
+		return slots[index].load(std::memory_order_relaxed) != resolver;
+	}
+
+	bool IsMissing(size_t index) const
+	{
+		return slots[index].load(std::memory_order_relaxed) == missing;
+	}
+
+	size_t ResolvedCount() const
+	{
+		size_t n = 0;
+		for (size_t i = 0; i < N; ++i)
+			n += IsResolved(i);
+		return n;
+	}
+
+	void* Module() const { return module; }
+
+private:
+	std::atomic<void*> (&slots)[N];
+	const char* dllName;
+	const symbol (&symbols)[N];
+	void* resolver;
+	void* missing;
+	std::once_flag loaded;
+	void* module = nullptr;
+};
+
+} // namespace proxy
+
+#ifdef _WIN32
+
+// Thunks are emitted as code bytes into a .text subsection, so they need neither
+// inline asm (unavailable on x64) nor one naked function per export.
+#pragma section(".text$px", read, execute)
+#define PROXY_CODE __declspec(allocate(".text$px"))
+
+namespace proxy {
+
+#pragma pack(push, 1)
+#ifdef _M_X64
+// mov rax, slot; jmp qword ptr [rax]
+struct thunk
+{
+	uint8_t mov[2];
+	const void* slot;
+	uint8_t jmp[2];
+};
+#define PROXY_THUNK_INIT(slot) { { 0x48, 0xB8 }, slot, { 0xFF, 0x20 } }
+
+// Entered from a thunk with the slot address in rax. Saves the argument registers,
+// calls resolve(slot) and tail jumps to the resolved function.
+struct resolverThunk
+{
+	uint8_t save[0x27];
+	void* (*resolve)(std::atomic<void*>*);
+	uint8_t restore[0x26];
+};
+#define PROXY_RESOLVER_INIT(fn) { \
+	{ 0x51, 0x52, 0x41, 0x50, 0x41, 0x51, /* push rcx, rdx, r8, r9 */ \
+	  0x48, 0x83, 0xEC, 0x68,             /* sub rsp, 0x68 */ \
+	  0xF3, 0x0F, 0x7F, 0x44, 0x24, 0x20, /* movdqu [rsp+0x20], xmm0 */ \
+	  0xF3, 0x0F, 0x7F, 0x4C, 0x24, 0x30, /* movdqu [rsp+0x30], xmm1 */ \
+	  0xF3, 0x0F, 0x7F, 0x54, 0x24, 0x40, /* movdqu [rsp+0x40], xmm2 */ \
+	  0xF3, 0x0F, 0x7F, 0x5C, 0x24, 0x50, /* movdqu [rsp+0x50], xmm3 */ \
+	  0x48, 0x89, 0xC1,                   /* mov rcx, rax */ \
+	  0x48, 0xB8 },                       /* mov rax, fn */ \
+	fn, \
+	{ 0xFF, 0xD0,                         /* call rax */ \
+	  0xF3, 0x0F, 0x6F, 0x44, 0x24, 0x20, /* movdqu xmm0, [rsp+0x20] */ \
+	  0xF3, 0x0F, 0x6F, 0x4C, 0x24, 0x30, /* movdqu xmm1, [rsp+0x30] */ \
+	  0xF3, 0x0F, 0x6F, 0x54, 0x24, 0x40, /* movdqu xmm2, [rsp+0x40] */ \
+	  0xF3, 0x0F, 0x6F, 0x5C, 0x24, 0x50, /* movdqu xmm3, [rsp+0x50] */ \
+	  0x48, 0x83, 0xC4, 0x68,             /* add rsp, 0x68 */ \
+	  0x41, 0x59, 0x41, 0x58, 0x5A, 0x59, /* pop r9, r8, rdx, rcx */ \
+	  0xFF, 0xE0 } }                      /* jmp rax */
+#define PROXY_RESOLVER(name, fn) PROXY_CODE const proxy::resolverThunk name = PROXY_RESOLVER_INIT(fn);
+#define PROXY_SYMBOL_PREFIX "__"
+#else
+// mov eax, slot; jmp dword ptr [eax]
+struct thunk
+{
+	uint8_t mov[1];
+	const void* slot;
+	uint8_t jmp[2];
+};
+#define PROXY_THUNK_INIT(slot) { { 0xB8 }, slot, { 0xFF, 0x20 } }
+
+// Entered from a thunk with the slot address in eax, stdcall and cdecl arguments stay on the stack
+#define PROXY_RESOLVER(name, fn) \
+	__declspec(naked) void name() \
+	{ \
+		__asm push ecx \
+		__asm push edx \
+		__asm push eax \
+		__asm call fn \
+		__asm add esp, 4 \
+		__asm pop edx \
+		__asm pop ecx \
+		__asm jmp eax \
+	}
+#define PROXY_SYMBOL_PREFIX "___"
+#endif
+#pragma pack(pop)
+
+} // namespace proxy
+
+// Export `name` at `ordinal`, implemented by the thunk symbol __name
+#define PROXY_EXPORT_PRAGMA(name, ordinal) \
+	__pragma(comment(linker, "/EXPORT:" #name "=" PROXY_SYMBOL_PREFIX #name ",@" #ordinal))
+#define PROXY_EXPORT_NONAME_PRAGMA(name, ordinal) \
+	__pragma(comment(linker, "/EXPORT:" #name "=" PROXY_SYMBOL_PREFIX #name ",@" #ordinal ",NONAME"))
+
+// Export `name` at `ordinal` as loader forwarder to "dll.func" or "dll.#ordinal"
+#define PROXY_FORWARD_PRAGMA(name, ordinal, target) \
+	__pragma(comment(linker, "/EXPORT:" #name "=" target ",@" #ordinal))
+#define PROXY_FORWARD_NONAME_PRAGMA(name, ordinal, target) \
+	__pragma(comment(linker, "/EXPORT:" #name "=" target ",@" #ordinal ",NONAME"))
+
+#endif // _WIN32
@@ -0,0 +1,134 @@
+// Checks and times the caller profiler on synthetic stacks: a made up module layout
+// (an exe, a UI toolkit, GDI and FontMod itself) and a set of call sites with known
+// weights are recorded from several threads at once. The ranked sites must match what was
+// recorded, each attributed to the first frame outside GDI and FontMod. Prints ns per
+// Record and the report.
+//
+// Usage: bench-callers [threads] [calls per thread]
+// Build: cmake -S . -B build && cmake --build build --target bench-callers
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CallerProfile.hpp"
+
+namespace {
+
+struct path
+{
+	std::vector<uintptr_t> frames; // innermost first
+	const wchar_t* face;
+	unsigned weight;
+	std::string caller; // expected call site
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+	size_t calls = argc > 2 ? strtoul(argv[2], nullptr, 10) : 500000;
+
+	const uintptr_t app = 0x140000000, qt = 0x7ff810000000, gdi = 0x7ff820000000, gdiFull = 0x7ff830000000, fontmod = 0x7ff840000000;
+	callers::ModuleMap modules;
+	modules.Add("Qt5Gui.dll", qt, 0x600000);
+	modules.Add("app.exe", app, 0x200000);
+	modules.Add("gdi32full.dll", gdiFull, 0x180000);
+	modules.Add("GDI32.dll", gdi, 0x30000);
+	modules.Add("winmm.dll", fontmod, 0x40000);
+	const std::vector<std::string> skip = { "gdi32.dll", "gdi32full.dll", "winmm.dll" };
+
+	if (modules.Symbolize(qt + 0x1234) != "Qt5Gui.dll+0x1234" || modules.Symbolize(app - 1) != "0x13fffffff" ||
+		modules.Symbolize(gdi + 0x30000) != "0x7ff820030000")
+	{
+		fputs("bench-callers: wrong module+offset\n", stderr);
+		return 1;
+	}
+
+	// CreateFontIndirectW from the toolkit, CreateFontW straight from the exe, and a few
+	// stacks that only differ above the call site
+	std::vector<path> paths = {
+		{ { gdi + 0x1a0, qt + 0x51200, qt + 0x4f000, app + 0x9000 }, L"MS Shell Dlg 2", 60, "Qt5Gui.dll+0x51200" },
+		{ { gdi + 0x1a0, qt + 0x51200, qt + 0x4f000, app + 0xa000 }, L"MS Shell Dlg 2", 20, "Qt5Gui.dll+0x51200" },
+		{ { gdi + 0x1a0, qt + 0x51200, qt + 0x4f000, app + 0x9000 }, L"SimSun", 10, "Qt5Gui.dll+0x51200" },
+		{ { gdiFull + 0x8800, gdi + 0x2200, app + 0x1770, app + 0x100 }, L"Tahoma", 7, "app.exe+0x1770" },
+		{ { fontmod + 0x4000, gdi + 0x1a0, app + 0x2000 }, L"Segoe UI", 2, "app.exe+0x2000" },
+		{ { gdi + 0x1a0 }, L"Arial", 1, "?" },
+	};
+	std::vector<unsigned> weights;
+	for (auto& p : paths)
+		weights.push_back(p.weight);
+
+	callers::Table table;
+	std::vector<std::vector<uint64_t>> made(threads, std::vector<uint64_t>(paths.size()));
+	std::atomic<bool> go{ false };
+	std::vector<std::thread> pool;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		pool.emplace_back([&, t] {
+			std::mt19937 rng(static_cast<unsigned>(t + 1));
+			std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+			std::vector<size_t> order(calls);
+			for (auto& o : order)
+				o = pick(rng);
+			while (!go.load(std::memory_order_acquire)) {}
+			for (auto i : order)
+			{
+				auto& p = paths[i];
+				table.Record(p.frames.data(), p.frames.size(), p.face, 1000 + i);
+				++made[t][i];
+			}
+		});
+	}
+	auto start = std::chrono::steady_clock::now();
+	go.store(true, std::memory_order_release);
+	for (auto& p : pool)
+		p.join();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	// what each (site, face) must add up to
+	std::map<std::pair<std::string, std::wstring>, uint64_t> expected;
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		for (size_t t = 0; t < threads; ++t)
+			expected[{ paths[i].caller, paths[i].face }] += made[t][i];
+	}
+	auto sites = callers::Rank(table, modules, skip);
+	bool ok = sites.size() == expected.size() && table.Dropped() == 0;
+	for (size_t i = 0; ok && i < sites.size(); ++i)
+	{
+		auto& s = sites[i];
+		auto want = expected.find({ s.caller, s.face });
+		ok = want != expected.end() && want->second == s.count && (i == 0 || sites[i - 1].count >= s.count);
+	}
+	if (!ok)
+	{
+		fputs("bench-callers: ranked sites do not match the recorded calls\n", stderr);
+		fputs(callers::Report(table, modules, skip).c_str(), stderr);
+		return 1;
+	}
+
+	// distinct stacks past the capacity only count as dropped
+	callers::Table small(16);
+	uintptr_t frames[2] = { gdi + 0x1a0, app };
+	size_t kept = 0;
+	for (uintptr_t i = 0; i < 64; ++i, ++frames[1])
+		kept += small.Record(frames, 2, L"Tahoma", 1);
+	if (kept != 16 || small.Dropped() != 48 || small.Snapshot().size() != 16)
+	{
+		fputs("bench-callers: a full table does not drop\n", stderr);
+		return 1;
+	}
+
+	printf("%zu threads x %zu calls, %.1f ns per Record\n\n", threads, calls, elapsed.count() / calls);
+	fputs(callers::Report(table, modules, skip).c_str(), stdout);
+	return 0;
+}
@@ -0,0 +1,162 @@
+// Measures what the always-on per-rule hit counters cost the rewrite when many UI
+// threads create fonts at once. Every thread replays the same skewed trace, where one
+// face takes most of the hits, through the rule store without counting, with one
+// shared atomic counter per rule, and through rules::Engine with its per-thread shards.
+// The sharded totals are checked against the trace.
+//
+// Usage: bench-counters [max threads] [lookups per thread]
+// Build: cmake -S . -B build && cmake --build build --target bench-counters
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RuleEngine.hpp"
+
+namespace {
+
+// Runs `body(thread)` on `threads` threads started together, returns ns per lookup
+template <typename Body>
+double Run(size_t threads, size_t lookups, Body body)
+{
+	std::atomic<size_t> ready{ 0 };
+	std::atomic<bool> go{ false };
+	std::vector<std::thread> pool;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		pool.emplace_back([&, t] {
+			ready.fetch_add(1);
+			while (!go.load(std::memory_order_acquire)) {}
+			body(t);
+		});
+	}
+	while (ready.load() != threads) {}
+	auto start = std::chrono::steady_clock::now();
+	go.store(true, std::memory_order_release);
+	for (auto& p : pool)
+		p.join();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / lookups; // wall time per lookup of one thread
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t maxThreads = argc > 1 ? strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+	size_t lookups = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000000;
+
+	std::vector<std::wstring> order;
+	std::unordered_map<std::wstring, font> fonts;
+	const wchar_t* const faces[] = { L"SimSun", L"PMingLiU", L"MS UI Gothic", L"Gulim", L"Microsoft YaHei UI", L"MS Shell Dlg" };
+	for (auto face : faces)
+	{
+		font f = {};
+		wcsncpy(f.replace, L"Microsoft YaHei", FACE_SIZE - 1);
+		f.overrideFlags = _HEIGHT;
+		f.height = 12;
+		order.push_back(face);
+		fonts[face] = f;
+	}
+
+	rules::Engine engine;
+	engine.Build(order, fonts);
+	auto& store = engine.Store();
+
+	// 90% of the hits on the first face, the rest spread, one lookup in four without a rule
+	std::vector<LOGFONTW> trace;
+	std::mt19937 rng(3);
+	for (int i = 0; i < 4096; ++i)
+	{
+		LOGFONTW lf = {};
+		uint32_t r = rng() % 100;
+		const wchar_t* face = r < 25 ? L"Segoe UI" : r < 93 ? faces[0] : faces[1 + rng() % 5];
+		wcsncpy(lf.lfFaceName, face, LF_FACESIZE - 1);
+		trace.push_back(lf);
+	}
+	uint64_t traceHits = 0;
+	for (auto lf : trace)
+		traceHits += store.Find(lf.lfFaceName, wcsnlen(lf.lfFaceName, LF_FACESIZE)) != nullptr;
+
+	// what Engine::Rewrite does before counting
+	auto Lookup = [&](const LOGFONTW& lf) -> const rules::hotRule* {
+		size_t len = wcsnlen(lf.lfFaceName, LF_FACESIZE);
+		return engine.Filter().MayContain(lf.lfFaceName, len) ? store.Find(lf.lfFaceName, len) : nullptr;
+	};
+
+	std::unique_ptr<std::atomic<uint64_t>[]> shared(new std::atomic<uint64_t>[store.Size() + 1]());
+	std::atomic<uint64_t> sink{ 0 };
+
+	printf("%zu lookups per thread, %.0f%% hits\n", lookups, 100.0 * traceHits / trace.size());
+	printf("%8s %14s %14s %14s\n", "threads", "uncounted ns", "shared ns", "sharded ns");
+	for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		double plain = Run(threads, lookups, [&](size_t t) {
+			size_t n = 0;
+			for (size_t i = 0; i < lookups; ++i)
+			{
+				LOGFONTW lf = trace[(i + t * 977) % trace.size()];
+				if (auto rule = Lookup(lf))
+				{
+					store.CopyReplace(*rule, lf.lfFaceName);
+					rules::ApplyStyle(*rule, lf);
+					++n;
+				}
+			}
+			sink += n;
+		});
+
+		double atomic = Run(threads, lookups, [&](size_t t) {
+			size_t n = 0;
+			for (size_t i = 0; i < lookups; ++i)
+			{
+				LOGFONTW lf = trace[(i + t * 977) % trace.size()];
+				if (auto rule = Lookup(lf))
+				{
+					shared[1 + store.IndexOf(*rule)].fetch_add(1, std::memory_order_relaxed);
+					store.CopyReplace(*rule, lf.lfFaceName);
+					rules::ApplyStyle(*rule, lf);
+					++n;
+				}
+				else
+				{
+					shared[0].fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			sink += n;
+		});
+
+		engine.Build(order, fonts); // fresh counters
+		double sharded = Run(threads, lookups, [&](size_t t) {
+			size_t n = 0;
+			for (size_t i = 0; i < lookups; ++i)
+			{
+				LOGFONTW lf = trace[(i + t * 977) % trace.size()];
+				n += engine.Rewrite(lf);
+			}
+			sink += n;
+		});
+
+		std::vector<uint64_t> hits;
+		uint64_t misses, total = 0;
+		engine.ReadCounters(hits, misses);
+		for (auto h : hits)
+			total += h;
+		if (total + misses != threads * lookups)
+		{
+			fprintf(stderr, "bench-counters: counted %llu lookups, made %zu\n",
+				static_cast<unsigned long long>(total + misses), threads * lookups);
+			return 1;
+		}
+		printf("%8zu %14.2f %14.2f %14.2f   %zu shards\n", threads, plain, atomic, sharded, engine.CounterShards());
+	}
+	return sink.load() ? 0 : 1;
+}
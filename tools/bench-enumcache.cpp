@@ -0,0 +1,243 @@
+// Runs the enumeration cache against a stub enumerator standing in for EnumFontFamiliesExW
+// over a synthetic font set: every query answered from the cache, freshly filled or loaded
+// from disk, must call back with what the enumerator does, stop where the callback stops
+// and return the same. A cache written for another font set must not load, results enumerated
+// before a reset or marked for the run only must not be saved. Prints the
+// time of an uncached enumeration, of a replay and of loading the file.
+//
+// Usage: bench-enumcache [families] [cache file]
+// Build: cmake -S . -B build && cmake --build build --target bench-enumcache
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "FontEnumCache.hpp"
+#include "LogFont.hpp"
+
+namespace {
+
+constexpr uint8_t ANY_CHARSET = 1; // DEFAULT_CHARSET
+
+struct record
+{
+	LOGFONTW lf;
+	wchar_t fullName[64];
+	wchar_t style[32];
+	uint32_t type;
+};
+
+struct family
+{
+	std::wstring name;
+	std::vector<uint8_t> charSets;
+	std::vector<std::wstring> styles;
+};
+
+using callback = std::function<int(const record&)>;
+
+// Every family once per charset for an empty face, all styles of one family for a name.
+// Builds each record on the fly like GDI, which is what makes an enumeration slow.
+int StubEnumerate(const std::vector<family>& fonts, const enumcache::key& q, const callback& cb)
+{
+	int ret = 1; // nothing called back
+	for (auto& f : fonts)
+	{
+		bool all = q.face[0] == L'\0';
+		if (!all && wcsncmp(q.face, f.name.c_str(), FACE_SIZE) != 0) continue;
+		for (uint8_t cs : f.charSets)
+		{
+			if (q.charSet != ANY_CHARSET && q.charSet != cs) continue;
+			for (size_t s = 0; s < (all ? 1 : f.styles.size()); ++s)
+			{
+				record r = {};
+				r.lf.lfHeight = -16;
+				r.lf.lfWeight = f.styles[s] == L"Bold" ? 700 : 400;
+				r.lf.lfCharSet = cs;
+				wcsncpy(r.lf.lfFaceName, f.name.c_str(), LF_FACESIZE - 1);
+				swprintf(r.fullName, 64, L"%ls %ls", f.name.c_str(), f.styles[s].c_str());
+				wcsncpy(r.style, f.styles[s].c_str(), 31);
+				r.type = 4;
+				ret = cb(r);
+				if (!ret) return 0;
+			}
+		}
+	}
+	return ret;
+}
+
+// The hook: a miss enumerates everything into the cache, then the caller's callback gets the records
+int Cached(enumcache::Cache<record>& cache, const std::vector<family>& fonts, const enumcache::key& q, const callback& cb)
+{
+	auto e = cache.Find(q);
+	if (!e)
+	{
+		auto since = cache.Generation();
+		std::vector<record> records;
+		int empty = StubEnumerate(fonts, q, [&](const record& r) { records.push_back(r); return 1; });
+		e = cache.Insert(q, std::move(records), empty, since);
+	}
+	return enumcache::Replay<record>(*e, cb);
+}
+
+struct run
+{
+	std::vector<record> seen;
+	int ret;
+};
+
+run Collect(const std::function<int(const callback&)>& enumerate, size_t stopAfter)
+{
+	run r;
+	r.ret = enumerate([&](const record& x) {
+		r.seen.push_back(x);
+		return r.seen.size() == stopAfter ? 0 : 1;
+	});
+	return r;
+}
+
+bool Same(const run& a, const run& b)
+{
+	return a.ret == b.ret && a.seen.size() == b.seen.size() &&
+		(a.seen.empty() || memcmp(a.seen.data(), b.seen.data(), a.seen.size() * sizeof(record)) == 0);
+}
+
+double Ms(std::chrono::steady_clock::time_point since)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 3000;
+	std::string fileName = argc > 2 ? argv[2] : "bench-enumcache.tmp";
+
+	std::vector<family> fonts;
+	const uint8_t charSets[] = { 0, 128, 134, 136, 161, 162, 204, 238 };
+	for (size_t i = 0; i < count; ++i)
+	{
+		family f;
+		f.name = L"Family " + std::to_wstring(i);
+		for (size_t c = 0; c <= i % 4; ++c)
+			f.charSets.push_back(charSets[(i + c) % 8]);
+		f.styles = { L"Regular", L"Bold" };
+		if (i % 3 == 0) f.styles.push_back(L"Italic");
+		fonts.push_back(f);
+	}
+
+	// what the DLL hashes: the installed font set and the user fonts
+	enumcache::Fingerprint print;
+	print.Add(count);
+	print.Add(std::wstring(L"fonts\\extra.ttf"));
+	uint64_t fingerprint = print.Value();
+
+	std::vector<enumcache::key> queries = {
+		enumcache::MakeKey(ANY_CHARSET, 0, L""),
+		enumcache::MakeKey(134, 0, L""),
+		enumcache::MakeKey(ANY_CHARSET, 0, L"Family 7"),
+		enumcache::MakeKey(ANY_CHARSET, 0, L"Family 9"),
+		enumcache::MakeKey(ANY_CHARSET, 0, L"No Such Font"),
+	};
+
+	enumcache::Cache<record> cache;
+	cache.Reset(fingerprint);
+	for (int pass = 0; pass < 2; ++pass) // filling, then from memory
+	{
+		for (auto& q : queries)
+		{
+			for (size_t stop : { static_cast<size_t>(0), static_cast<size_t>(1), static_cast<size_t>(5) })
+			{
+				auto direct = Collect([&](const callback& cb) { return StubEnumerate(fonts, q, cb); }, stop);
+				auto cached = Collect([&](const callback& cb) { return Cached(cache, fonts, q, cb); }, stop);
+				if (!Same(direct, cached))
+				{
+					fputs("bench-enumcache: cached enumeration differs\n", stderr);
+					return 1;
+				}
+			}
+		}
+	}
+	if (!cache.Dirty() || !cache.Save(fileName))
+	{
+		fprintf(stderr, "bench-enumcache: can not save %s\n", fileName.c_str());
+		return 1;
+	}
+	if (cache.Dirty())
+	{
+		fputs("bench-enumcache: still dirty after saving\n", stderr);
+		return 1;
+	}
+
+	enumcache::Cache<record> other;
+	print.Add(std::wstring(L"fonts\\new.ttf"));
+	if (other.Load(fileName, print.Value()) || other.Size() != 0)
+	{
+		fputs("bench-enumcache: loaded a cache of another font set\n", stderr);
+		return 1;
+	}
+
+	enumcache::Cache<record> loaded;
+	auto start = std::chrono::steady_clock::now();
+	if (!loaded.Load(fileName, fingerprint) || loaded.Size() != queries.size() || loaded.Dirty())
+	{
+		fputs("bench-enumcache: can not load the saved cache\n", stderr);
+		return 1;
+	}
+	double loadMs = Ms(start);
+	for (auto& q : queries)
+	{
+		auto direct = Collect([&](const callback& cb) { return StubEnumerate(fonts, q, cb); }, 0);
+		auto cached = Collect([&](const callback& cb) { return Cached(loaded, fonts, q, cb); }, 0);
+		if (!Same(direct, cached) || loaded.Dirty())
+		{
+			fputs("bench-enumcache: loaded cache differs\n", stderr);
+			return 1;
+		}
+	}
+
+	// a callback doing nothing but counting, the enumeration's own cost
+	const auto& all = queries[0];
+	size_t records = 0, replayed = 0;
+	start = std::chrono::steady_clock::now();
+	StubEnumerate(fonts, all, [&](const record&) { return ++records, 1; });
+	double directMs = Ms(start);
+	start = std::chrono::steady_clock::now();
+	Cached(loaded, fonts, all, [&](const record&) { return ++replayed, 1; });
+	double replayMs = Ms(start);
+	if (replayed != records)
+	{
+		fputs("bench-enumcache: replay lost records\n", stderr);
+		return 1;
+	}
+
+	// what the DLL does once the program registers fonts of its own
+	enumcache::Cache<record> run;
+	run.Reset(fingerprint);
+	auto before = run.Generation();
+	run.Reset(fingerprint);
+	run.Insert(queries[2], {}, 1, before);
+	run.Insert(queries[3], {}, 1, run.Generation(), false);
+	auto runFile = fileName + ".run";
+	enumcache::Cache<record> reloaded;
+	if (run.Size() != 1 || run.Dirty() || !run.Save(runFile) || !reloaded.Load(runFile, fingerprint) || reloaded.Size() != 0)
+	{
+		fputs("bench-enumcache: saved a result enumerated before a reset or for the run only\n", stderr);
+		return 1;
+	}
+
+	std::error_code ec;
+	std::filesystem::remove(runFile, ec);
+	auto bytes = std::filesystem::file_size(fileName, ec);
+	std::filesystem::remove(fileName, ec);
+	printf("%zu families, %zu records in a full enumeration, cache file %llu KiB\n", count, records,
+		static_cast<unsigned long long>(bytes / 1024));
+	printf("stub enumeration %.3f ms, replay %.3f ms, loading the file %.3f ms\n", directMs, replayMs, loadMs);
+	return 0;
+}
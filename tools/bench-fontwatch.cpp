@@ -0,0 +1,169 @@
+// Runs the fonts/ watcher on a temporary directory of fake font files, with stubs standing in
+// for AddFontResourceExW and RemoveFontResourceExW: adding, rewriting, renaming and deleting
+// a file must register and unregister that file and nothing else, and a file that failed to
+// register must not be tried again until it changes. Prints how long a change takes to be
+// picked up and what a rescan costs against registering every file again.
+//
+// Usage: bench-fontwatch [files]
+// Build: cmake -S . -B build && cmake --build build --target bench-fontwatch
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FontWatch.hpp"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr auto SETTLE = std::chrono::milliseconds(100);
+constexpr auto TIMEOUT = std::chrono::seconds(10);
+
+// What the stubs were called with, "+name" for a registration and "-name" for a removal
+struct calls
+{
+	std::mutex lock;
+	std::condition_variable synced;
+	std::vector<std::string> log;
+	size_t syncs = 0; // with changes
+	std::chrono::steady_clock::time_point lastSync;
+
+	bool Stub(char op, const fs::path& path)
+	{
+		std::lock_guard<std::mutex> hold(lock);
+		log.push_back(op + path.filename().string());
+		return path.extension() != ".bad"; // not a font
+	}
+};
+
+void WriteFile(const fs::path& path, size_t size)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out << std::string(size, 'F');
+}
+
+double Ms(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+	auto dir = fs::temp_directory_path() / ("bench-fontwatch." + std::to_string(std::random_device()()));
+	fs::create_directories(dir);
+	auto name = [](size_t i) { return "font" + std::to_string(i) + ".ttf"; };
+	for (size_t i = 0; i < count; ++i)
+		WriteFile(dir / name(i), 100 + i % 50);
+
+	calls c;
+	fontwatch::Registry registry([&](const fs::path& p) { return c.Stub('+', p); }, [&](const fs::path& p) { return c.Stub('-', p); });
+	// what the startup registration did
+	for (auto& [path, state] : fontwatch::Scan(dir))
+		registry.Seed(path, state, true);
+
+	fontwatch::Watcher watcher;
+	bool started = watcher.Start(dir, SETTLE, [&] {
+		auto d = registry.Sync(fontwatch::Scan(dir));
+		if (d.Empty()) return;
+		std::lock_guard<std::mutex> hold(c.lock);
+		++c.syncs;
+		c.lastSync = std::chrono::steady_clock::now();
+		c.synced.notify_all();
+	});
+	if (!started)
+	{
+		fprintf(stderr, "bench-fontwatch: can not watch %s\n", dir.string().c_str());
+		return 1;
+	}
+
+	bool ok = true;
+	double pickup = 0;
+	int steps = 0;
+	// runs `change`, waits for the watcher to sync it and compares the stub calls
+	auto step = [&](const char* what, auto change, std::vector<std::string> expected) {
+		size_t syncs;
+		{
+			std::lock_guard<std::mutex> hold(c.lock);
+			c.log.clear();
+			syncs = c.syncs;
+		}
+		auto start = std::chrono::steady_clock::now();
+		change();
+		std::unique_lock<std::mutex> hold(c.lock);
+		if (!c.synced.wait_for(hold, TIMEOUT, [&] { return c.syncs != syncs; }))
+		{
+			fprintf(stderr, "bench-fontwatch: %s was not picked up\n", what);
+			ok = false;
+			return;
+		}
+		pickup += Ms(c.lastSync - start);
+		++steps;
+		std::sort(c.log.begin(), c.log.end());
+		std::sort(expected.begin(), expected.end());
+		if (c.log != expected)
+		{
+			std::string got;
+			for (auto& s : c.log)
+				got += " " + s;
+			fprintf(stderr, "bench-fontwatch: %s called%s\n", what, got.empty() ? " nothing" : got.c_str());
+			ok = false;
+		}
+	};
+
+	step("adding a file", [&] { WriteFile(dir / "new.ttf", 64); }, { "+new.ttf" });
+	step("rewriting a file", [&] { WriteFile(dir / name(1), 7); }, { "-" + name(1), "+" + name(1) });
+	step("deleting a file", [&] { fs::remove(dir / name(2)); }, { "-" + name(2) });
+	step("renaming a file", [&] { fs::rename(dir / name(3), dir / "renamed.ttf"); }, { "-" + name(3), "+renamed.ttf" });
+	step("adding a broken file", [&] { WriteFile(dir / "broken.bad", 3); }, { "+broken.bad" });
+	step("adding beside it", [&] { WriteFile(dir / "new2.ttf", 64); }, { "+new2.ttf" });
+	step("rewriting the broken file", [&] { WriteFile(dir / "broken.bad", 4); }, { "+broken.bad" });
+	step("deleting the broken file", [&] {
+		fs::remove(dir / "broken.bad");
+		WriteFile(dir / "new3.ttf", 64); // something to sync, the removal calls nothing
+	}, { "+new3.ttf" });
+	step("copying a batch", [&] {
+		for (int i = 0; i < 20; ++i)
+			WriteFile(dir / ("batch" + std::to_string(i) + ".ttf"), 64);
+	}, [] {
+		std::vector<std::string> v;
+		for (int i = 0; i < 20; ++i)
+			v.push_back("+batch" + std::to_string(i) + ".ttf");
+		return v;
+	}());
+	watcher.Stop();
+
+	size_t expectedRegistered = count - 2 + 4 + 20; // two gone, new, renamed, new2, new3 and the batch
+	if (ok && registry.Registered() != expectedRegistered)
+	{
+		fprintf(stderr, "bench-fontwatch: %zu files registered, expected %zu\n", registry.Registered(), expectedRegistered);
+		ok = false;
+	}
+
+	// a rescan finding nothing, against registering every file again as at startup
+	auto start = std::chrono::steady_clock::now();
+	const int rounds = 20;
+	for (int i = 0; i < rounds; ++i)
+	{
+		if (!registry.Sync(fontwatch::Scan(dir)).Empty()) ok = false;
+	}
+	double rescanMs = Ms(std::chrono::steady_clock::now() - start) / rounds;
+
+	std::error_code ec;
+	fs::remove_all(dir, ec);
+	if (!ok) return 1;
+	printf("%zu files, %d changes picked up %.1f ms after the write on average (%lld ms settle)\n", count, steps, pickup / steps,
+		static_cast<long long>(SETTLE.count()));
+	printf("rescan without changes %.3f ms, registering nothing instead of %zu files\n", rescanMs, registry.Registered());
+	return 0;
+}
@@ -0,0 +1,202 @@
+// Compares the rule store in config order with one laid out by a profile.
+// The first half of a trace is replayed to record hits as FontMod.profile would,
+// both layouts then look up the second half: index probes per lookup, and time with
+// warm and with flushed caches. The trace is the faces of a FontMod.log from debug
+// mode, or Zipf distributed over the rules when there is none.
+//
+// Usage: bench-layout [FontMod.yaml | rule count] [FontMod.log]
+// Build: cmake -S . -B build && cmake --build build --target bench-layout
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Config.hpp"
+#include "RuleEngine.hpp"
+#include "Transcode.hpp"
+
+namespace {
+
+std::vector<char> evict(32 << 20);
+
+void Evict()
+{
+	for (size_t i = 0; i < evict.size(); i += 64)
+		evict[i]++;
+}
+
+// Faces of the [CreateFont] lines, in call order
+bool ReadTrace(const char* path, std::vector<std::wstring>& trace)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	const std::string tag = "[CreateFont] name = \"";
+	std::string line;
+	std::wstring face;
+	while (std::getline(in, line))
+	{
+		auto at = line.find(tag);
+		if (at == std::string::npos) continue;
+		at += tag.size();
+		auto end = line.find("\", height", at);
+		if (end == std::string::npos) continue;
+		if (Utf8ToUtf16(std::string_view(line).substr(at, end - at), face) && face.size() < LF_FACESIZE)
+			trace.push_back(face);
+	}
+	return true;
+}
+
+void Synthesize(size_t count, config::settings& settings)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		std::wstring key = L"Face " + std::to_wstring(i * 7919);
+		font f = {};
+		wcsncpy(f.replace, i % 2 ? L"Microsoft YaHei" : L"Noto Sans CJK SC", FACE_SIZE - 1);
+		f.overrideFlags = _HEIGHT;
+		f.height = 12;
+		settings.order.push_back(key);
+		settings.fonts[key] = f;
+	}
+}
+
+// Skewed like real traffic: the rank r rule is asked for about 1/r^1.2 as often, one call in five has no rule
+std::vector<std::wstring> ZipfTrace(const std::vector<std::wstring>& keys, size_t length)
+{
+	std::mt19937 rng(5);
+	std::vector<std::wstring> ranked(keys);
+	std::shuffle(ranked.begin(), ranked.end(), rng); // the hot faces sit anywhere in the config
+	std::vector<double> weights;
+	for (size_t r = 1; r <= ranked.size(); ++r)
+		weights.push_back(1 / std::pow(static_cast<double>(r), 1.2));
+	std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+	const wchar_t* const misses[] = { L"Segoe UI", L"Tahoma", L"Arial", L"Microsoft Sans Serif", L"Consolas" };
+	std::vector<std::wstring> trace;
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (ranked.empty() || rng() % 5 == 0)
+			trace.push_back(misses[rng() % (sizeof(misses) / sizeof(misses[0]))]);
+		else
+			trace.push_back(ranked[pick(rng)]);
+	}
+	return trace;
+}
+
+struct result
+{
+	double probes, warmNs, coldNs;
+};
+
+result Measure(const rules::Engine& engine, const std::vector<std::wstring>& trace, size_t& hits)
+{
+	result r = {};
+	auto& store = engine.Store();
+	std::vector<LOGFONTW> fonts;
+	for (auto& face : trace)
+	{
+		LOGFONTW lf = {};
+		face.copy(lf.lfFaceName, LF_FACESIZE - 1);
+		fonts.push_back(lf);
+		r.probes += store.Probes(face.data(), face.size());
+	}
+	r.probes /= trace.size();
+
+	auto start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < 10; ++pass)
+	{
+		for (auto lf : fonts)
+			hits += engine.Rewrite(lf);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	r.warmNs = elapsed.count() / (fonts.size() * 10);
+
+	// every lookup after a flush, as in a host creating fonts between other work
+	size_t cold = std::min<size_t>(fonts.size(), 2000);
+	double ns = 0;
+	for (size_t i = 0; i < cold; ++i)
+	{
+		LOGFONTW lf = fonts[i];
+		Evict();
+		auto t = std::chrono::steady_clock::now();
+		hits += engine.Rewrite(lf);
+		ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t).count();
+	}
+	r.coldNs = ns / cold;
+	return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const char* source = argc > 1 ? argv[1] : "FontMod.yaml";
+	config::settings settings;
+	char* end;
+	size_t count = strtoul(source, &end, 10);
+	if (*end == '\0')
+	{
+		Synthesize(count, settings);
+	}
+	else
+	{
+		std::string errMsg;
+		if (!config::LoadSettings(source, errMsg, settings))
+		{
+			fprintf(stderr, "bench-layout: %s\n", errMsg.c_str());
+			return 1;
+		}
+	}
+
+	std::vector<std::wstring> trace;
+	if (argc > 2)
+	{
+		if (!ReadTrace(argv[2], trace) || trace.size() < 2)
+		{
+			fprintf(stderr, "bench-layout: no [CreateFont] lines in %s\n", argv[2]);
+			return 1;
+		}
+	}
+	else
+	{
+		trace = ZipfTrace(settings.order, 200000);
+	}
+	std::vector<std::wstring> train(trace.begin(), trace.begin() + trace.size() / 2);
+	std::vector<std::wstring> test(trace.begin() + trace.size() / 2, trace.end());
+
+	rules::Engine configOrder;
+	configOrder.Build(settings.order, settings.fonts);
+	for (auto& face : train)
+	{
+		LOGFONTW lf = {};
+		face.copy(lf.lfFaceName, LF_FACESIZE - 1);
+		configOrder.Rewrite(lf);
+	}
+	rules::Profile profile;
+	configOrder.Record(profile);
+
+	rules::Engine tuned;
+	tuned.Build(settings.order, settings.fonts, &profile);
+	printf("%zu rules, %zu profiled, trace %zu + %zu lookups\n", configOrder.Store().Size(), profile.Scores().size(), train.size(), test.size());
+
+	size_t a = 0, b = 0;
+	result before = Measure(configOrder, test, a);
+	result after = Measure(tuned, test, b);
+	if (a != b)
+	{
+		fputs("bench-layout: layouts disagree\n", stderr);
+		return 1;
+	}
+
+	printf("%-14s %12s %12s %12s\n", "layout", "probes", "warm ns", "cold ns");
+	printf("%-14s %12.3f %12.1f %12.1f\n", "config order", before.probes, before.warmNs, before.coldNs);
+	printf("%-14s %12.3f %12.1f %12.1f\n", "profiled", after.probes, after.warmNs, after.coldNs);
+	return 0;
+}
@@ -0,0 +1,101 @@
+// Runs the CreateFontIndirectExW rewrite of a FontMod.yaml outside Windows: loads the config
+// with the DLL's loader, builds the rule engine and replays a mix of faces with and
+// without a rule, as an application asking for its UI fonts would. `replace` lists are
+// resolved against the faces of a text file, one per line, standing in for the installed fonts.
+//
+// Usage: bench-rewrite [FontMod.yaml] [misses per hit] [installed faces]
+// Build: cmake -S . -B build && cmake --build build --target bench-rewrite
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Config.hpp"
+#include "RuleEngine.hpp"
+#include "Transcode.hpp"
+
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "FontMod.yaml";
+	size_t missesPerHit = argc > 2 ? strtoul(argv[2], nullptr, 10) : 4;
+
+	config::settings settings;
+	std::string errMsg;
+	if (!config::LoadSettings(path, errMsg, settings))
+	{
+		fprintf(stderr, "bench-rewrite: %s\n", errMsg.c_str());
+		return 1;
+	}
+
+	rules::Engine engine;
+	engine.Build(settings.order, settings.fonts, nullptr, &settings.chains);
+	if (argc > 3)
+	{
+		std::ifstream in(argv[3], std::ios::binary);
+		if (!in)
+		{
+			fprintf(stderr, "bench-rewrite: can not read %s\n", argv[3]);
+			return 1;
+		}
+		rules::FaceSet installed;
+		std::string line;
+		std::wstring face;
+		while (std::getline(in, line))
+		{
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (Utf8ToUtf16(line, face) && !face.empty()) installed.Add(face);
+		}
+		for (auto& r : engine.Resolve(installed))
+		{
+			std::string key, face;
+			Utf16ToUtf8(r.key, key);
+			Utf16ToUtf8(r.face, face);
+			printf("\"%s\" -> \"%s\", candidate %zu of %zu%s\n", key.c_str(), face.c_str(), r.candidate + 1, r.candidates,
+				r.available ? "" : ", none installed");
+		}
+	}
+	auto fp = engine.Store().Footprint();
+	printf("%zu rules, %zu bytes, filter %zu bytes\n", engine.Store().Size(), fp.Total(), engine.Filter().Bytes());
+
+	// faces a Windows UI asks for that usually have no rule
+	const wchar_t* const misses[] = { L"Segoe UI", L"Tahoma", L"Arial", L"Microsoft Sans Serif", L"Consolas",
+		L"Segoe UI Symbol", L"Marlett", L"Courier New", L"Times New Roman", L"MS Shell Dlg 2" };
+	std::vector<LOGFONTW> trace;
+	std::mt19937 rng(11);
+	for (int i = 0; i < 100000; ++i)
+	{
+		LOGFONTW lf = {};
+		lf.lfHeight = -12;
+		lf.lfWeight = 400;
+		if (!settings.order.empty() && rng() % (missesPerHit + 1) == 0)
+			settings.order[rng() % settings.order.size()].copy(lf.lfFaceName, LF_FACESIZE - 1);
+		else
+			wcsncpy(lf.lfFaceName, misses[rng() % (sizeof(misses) / sizeof(misses[0]))], LF_FACESIZE - 1);
+		trace.push_back(lf);
+	}
+
+	size_t hits = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto lf : trace)
+		hits += engine.Rewrite(lf);
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	printf("%zu lookups, %zu rewritten, %.1f ns/lookup\n", trace.size(), hits, elapsed.count() / trace.size());
+
+	// show what the first rule does to a face
+	if (!settings.order.empty())
+	{
+		LOGFONTW lf = {};
+		settings.order[0].copy(lf.lfFaceName, LF_FACESIZE - 1);
+		engine.Rewrite(lf);
+		std::string from, to;
+		Utf16ToUtf8(settings.order[0], from);
+		Utf16ToUtf8(lf.lfFaceName, to);
+		printf("\"%s\" -> \"%s\", height %d\n", from.c_str(), to.c_str(), static_cast<int>(lf.lfHeight));
+	}
+	return 0;
+}
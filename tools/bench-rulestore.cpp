@@ -0,0 +1,192 @@
+// Compares rule hits in the hot/cold RuleStore against the previous
+// unordered_map<wstring, font> with its nodes scattered over a busy heap.
+// Caches are flushed between batches, so every lookup starts cold like in a host that
+// creates fonts between long stretches of other work. Cache misses come from
+// perf_event_open where the kernel allows it.
+//
+// Usage: bench-rulestore [rules]
+// Build: c++ -std=c++17 -O2 -I. tools/bench-rulestore.cpp -o bench-rulestore
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "RuleStore.hpp"
+
+namespace {
+
+// Counts data cache misses of this thread, unavailable counters read as -1
+class MissCounter
+{
+public:
+	MissCounter()
+	{
+#ifdef __linux__
+		perf_event_attr attr = {};
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+
+	~MissCounter()
+	{
+#ifdef __linux__
+		if (fd >= 0) close(fd);
+#endif
+	}
+
+	bool Available() const { return fd >= 0; }
+
+	void Start()
+	{
+#ifdef __linux__
+		if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	void Stop()
+	{
+#ifdef __linux__
+		if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+	}
+
+	long long Read() const
+	{
+		long long value = -1;
+#ifdef __linux__
+		if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) return -1;
+#endif
+		return value;
+	}
+
+private:
+	int fd = -1;
+};
+
+std::vector<char> evict(32 << 20);
+
+void Evict()
+{
+	for (size_t i = 0; i < evict.size(); i += 64)
+		evict[i]++;
+}
+
+struct result
+{
+	double ns;
+	double misses; // per lookup, negative if unavailable
+};
+
+template <typename Lookup>
+result Measure(const std::vector<std::wstring>& trace, Lookup lookup, size_t& checksum)
+{
+	MissCounter counter;
+	double ns = 0;
+	for (auto& name : trace)
+	{
+		Evict();
+		counter.Start();
+		auto start = std::chrono::steady_clock::now();
+		checksum += lookup(name.c_str(), name.size());
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		counter.Stop();
+		ns += elapsed.count();
+	}
+	long long misses = counter.Read();
+	return { ns / trace.size(), misses < 0 ? -1.0 : static_cast<double>(misses) / trace.size() };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 32;
+
+	const wchar_t* const faces[] = { L"SimSun", L"PMingLiU", L"MS UI Gothic", L"Gulim", L"Microsoft YaHei UI", L"宋体" };
+	std::vector<std::wstring> order;
+	std::unordered_map<std::wstring, font> images;
+	std::vector<std::unique_ptr<char[]>> noise; // other allocations of the host between rule nodes
+	std::mt19937 rng(7);
+
+	std::unordered_map<std::wstring, font> fontsMap;
+	for (size_t i = 0; i < count; ++i)
+	{
+		std::wstring key = i < 6 ? faces[i] : L"Face " + std::to_wstring(i * 7919);
+		font f = {};
+		std::wstring replace = i % 2 ? L"Microsoft YaHei" : L"Noto Sans CJK SC";
+		wcsncpy(f.replace, replace.c_str(), FACE_SIZE - 1);
+		f.overrideFlags = _HEIGHT;
+		f.height = 12;
+		order.push_back(key);
+		images[key] = f;
+		fontsMap[key] = f;
+		for (int n = 0; n < 16; ++n)
+			noise.emplace_back(new char[32 + rng() % 512]);
+	}
+
+	rules::RuleStore store;
+	store.Build(order, images);
+	auto fp = store.Footprint();
+	printf("%zu rules: hot %zu + cold %zu + index %zu + arena %zu = %zu bytes, %.1f bytes/rule\n",
+		store.Size(), fp.hot, fp.cold, fp.index, fp.arena, fp.Total(), static_cast<double>(fp.Total()) / store.Size());
+	size_t nodeBytes = fontsMap.bucket_count() * sizeof(void*) + fontsMap.size() * (sizeof(std::pair<const std::wstring, font>) + 2 * sizeof(void*));
+	printf("unordered_map: about %zu bytes, %.1f bytes/rule, plus key heap blocks over 7 characters\n",
+		nodeBytes, static_cast<double>(nodeBytes) / fontsMap.size());
+
+	std::vector<std::wstring> trace;
+	for (int i = 0; i < 2000; ++i)
+		trace.push_back(order[rng() % order.size()]);
+
+	size_t a = 0, b = 0;
+	wchar_t face[FACE_SIZE];
+	auto mapLookup = [&](const wchar_t* name, size_t) -> size_t {
+		auto it = fontsMap.find(name);
+		if (it == fontsMap.end()) return 0;
+		memcpy(face, it->second.replace, sizeof(face));
+		return static_cast<size_t>(face[0]) + it->second.height;
+	};
+	auto storeLookup = [&](const wchar_t* name, size_t len) -> size_t {
+		auto h = store.Find(name, len);
+		if (!h) return 0;
+		store.CopyReplace(*h, face);
+		return static_cast<size_t>(face[0]) + h->height;
+	};
+
+	result map = Measure(trace, mapLookup, a);
+	result hot = Measure(trace, storeLookup, b);
+	if (a != b)
+	{
+		fputs("bench-rulestore: lookups disagree\n", stderr);
+		return 1;
+	}
+
+	printf("%-14s %12s %16s\n", "cold hit", "ns/lookup", "L1D misses/lookup");
+	for (auto [name, r] : { std::pair<const char*, result>{ "unordered_map", map }, { "RuleStore", hot } })
+	{
+		if (r.misses < 0)
+			printf("%-14s %12.1f %16s\n", name, r.ns, "n/a");
+		else
+			printf("%-14s %12.1f %16.2f\n", name, r.ns, r.misses);
+	}
+	return 0;
+}
@@ -0,0 +1,24 @@
+# Builds a fixture PE from a genexports list, runs genexports on it and compares the output
+# with the list, so the committed winmm_exports.hpp stays what genexports generates.
+#
+# Usage: cmake -DGENEXPORTS=genexports -DPE_FIXTURE=pe-fixture -DLIST=exports.hpp [-DPREFIX=WINMM] -DWORK=dir -P check-genexports.cmake
+
+get_filename_component(name ${LIST} NAME_WE)
+set(dll ${WORK}/${name}.dll)
+set(out ${WORK}/${name}.hpp)
+if(NOT PREFIX)
+	set(PREFIX WINMM)
+endif()
+
+execute_process(COMMAND ${PE_FIXTURE} ${LIST} ${dll} RESULT_VARIABLE result)
+if(result)
+	message(FATAL_ERROR "pe-fixture failed on ${LIST}")
+endif()
+execute_process(COMMAND ${GENEXPORTS} --prefix ${PREFIX} ${dll} OUTPUT_FILE ${out} RESULT_VARIABLE result)
+if(result)
+	message(FATAL_ERROR "genexports failed on ${dll}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${LIST} ${out} RESULT_VARIABLE result)
+if(result)
+	message(FATAL_ERROR "genexports output ${out} differs from ${LIST}")
+endif()
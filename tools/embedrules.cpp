@@ -0,0 +1,391 @@
+// Compiles a FontMod.yaml into EmbeddedRules.gen.hpp: constexpr rule images
+// addressed through a minimal perfect hash of the face names.
+// FontMod picks the header up with __has_include and then starts without reading a config,
+// a FontMod.yaml next to the DLL still overrides it.
+//
+// Usage: embedrules FontMod.yaml EmbeddedRules.gen.hpp
+// Build: c++ -std=c++17 -O2 -I. tools/embedrules.cpp -lyaml-cpp -o embedrules
+//        (or configure CMake with -DFONTMOD_EMBED_CONFIG=path/to/FontMod.yaml)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "yaml-cpp/yaml.h"
+
+#include "RuleImage.hpp"
+
+namespace {
+
+// Same lookup as FontMod's, including YAML merge keys
+template <typename Key>
+YAML::Node FindNode(const YAML::Node& node, const Key& key)
+{
+	if (auto merge = node["<<"]; merge.IsDefined())
+	{
+		if (auto child = FindNode(merge, key); child.IsDefined())
+		{
+			return child;
+		}
+	}
+	return node[key];
+}
+
+bool ToLong(const YAML::Node& node, long& out)
+{
+	std::string str = node.as<std::string>();
+	char* end;
+	errno = 0;
+	out = strtol(str.c_str(), &end, 10);
+	return end != str.c_str() && errno != ERANGE;
+}
+
+bool ToByte(const YAML::Node& node, uint8_t& out)
+{
+	long value;
+	if (!ToLong(node, value) || value < 0) return false;
+	out = static_cast<uint8_t>(value);
+	return true;
+}
+
+// UTF-8 to UTF-16 code units, false on malformed input
+bool Utf8ToUtf16(const std::string& utf8, std::u16string& utf16)
+{
+	utf16.clear();
+	for (size_t i = 0; i < utf8.size();)
+	{
+		unsigned char c = utf8[i];
+		uint32_t cp;
+		size_t n;
+		if (c < 0x80) { cp = c; n = 1; }
+		else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; n = 2; }
+		else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; n = 3; }
+		else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; n = 4; }
+		else return false;
+		if (i + n > utf8.size()) return false;
+		for (size_t k = 1; k < n; ++k)
+		{
+			unsigned char cc = utf8[i + k];
+			if ((cc & 0xC0) != 0x80) return false;
+			cp = (cp << 6) | (cc & 0x3F);
+		}
+		i += n;
+		if (cp >= 0x10000)
+		{
+			cp -= 0x10000;
+			utf16 += static_cast<char16_t>(0xD800 + (cp >> 10));
+			utf16 += static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+		}
+		else
+		{
+			utf16 += static_cast<char16_t>(cp);
+		}
+	}
+	return true;
+}
+
+struct entry
+{
+	std::u16string find;
+	std::u16string replace;
+	font image;
+};
+
+bool Face(const YAML::Node& node, std::u16string& out)
+{
+	if (!node || !node.IsScalar()) return false;
+	if (!Utf8ToUtf16(node.as<std::string>(), out)) return false;
+	if (out.size() >= FACE_SIZE)
+	{
+		fprintf(stderr, "embedrules: face name \"%s\" is longer than %zu characters\n", node.as<std::string>().c_str(), FACE_SIZE - 1);
+		return false;
+	}
+	return true;
+}
+
+// Collects overrides into `image` exactly like LoadSettings
+void ReadStyle(const YAML::Node& node, font& image)
+{
+	image.overrideFlags = _NONE;
+	if (auto n = FindNode(node, "size"); n && n.IsScalar() && ToLong(n, image.height))
+		image.overrideFlags |= _HEIGHT;
+	if (auto n = FindNode(node, "width"); n && n.IsScalar() && ToLong(n, image.width))
+		image.overrideFlags |= _WIDTH;
+	if (auto n = FindNode(node, "weight"); n && n.IsScalar() && ToLong(n, image.weight))
+		image.overrideFlags |= _WEIGHT;
+	if (auto n = FindNode(node, "italic"); n && n.IsScalar())
+	{
+		image.overrideFlags |= _ITALIC;
+		image.italic = n.as<bool>();
+	}
+	if (auto n = FindNode(node, "underLine"); n && n.IsScalar())
+	{
+		image.overrideFlags |= _UNDERLINE;
+		image.underLine = n.as<bool>();
+	}
+	if (auto n = FindNode(node, "strikeOut"); n && n.IsScalar())
+	{
+		image.overrideFlags |= _STRIKEOUT;
+		image.strikeOut = n.as<bool>();
+	}
+	if (auto n = FindNode(node, "charSet"); n && n.IsScalar() && ToByte(n, image.charSet))
+		image.overrideFlags |= _CHARSET;
+	if (auto n = FindNode(node, "outPrecision"); n && n.IsScalar() && ToByte(n, image.outPrecision))
+		image.overrideFlags |= _OUTPRECISION;
+	if (auto n = FindNode(node, "clipPrecision"); n && n.IsScalar() && ToByte(n, image.clipPrecision))
+		image.overrideFlags |= _CLIPPRECISION;
+	if (auto n = FindNode(node, "quality"); n && n.IsScalar() && ToByte(n, image.quality))
+		image.overrideFlags |= _QUALITY;
+	if (auto n = FindNode(node, "pitchAndFamily"); n && n.IsScalar() && ToByte(n, image.pitchAndFamily))
+		image.overrideFlags |= _PITCHANDFAMILY;
+}
+
+// Built-in rules can not resolve a `replace` list at runtime, they keep its first candidate
+YAML::Node ReplaceNode(const YAML::Node& node)
+{
+	auto r = FindNode(node, "replace");
+	if (r && r.IsScalar())
+		return r;
+	if (r && r.IsSequence() && r.size() && r[0].IsScalar())
+	{
+		fprintf(stderr, "embedrules: using \"%s\", the first of a replace list\n", r[0].as<std::string>().c_str());
+		return r[0];
+	}
+	return FindNode(node, "name");
+}
+
+uint32_t KeyHash(const std::u16string& key, uint32_t seed)
+{
+	std::wstring w(key.begin(), key.end());
+	return embedded::FaceKeyHash(w.data(), w.size(), seed);
+}
+
+// Hash and displace: place the largest buckets first, searching a seed that sends
+// all their keys to free slots, then drop single keys straight into what is left.
+std::vector<int32_t> BuildDisplacements(std::vector<entry>& entries)
+{
+	const size_t n = entries.size();
+	std::vector<std::vector<size_t>> buckets(n);
+	for (size_t i = 0; i < n; ++i)
+		buckets[KeyHash(entries[i].find, 0) % n].push_back(i);
+
+	std::vector<size_t> order(n);
+	for (size_t i = 0; i < n; ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+	std::vector<int32_t> displacements(n, 0);
+	std::vector<long> slotOf(n, -1); // entry index per slot
+	for (size_t b : order)
+	{
+		auto& keys = buckets[b];
+		if (keys.size() <= 1) break;
+		for (int32_t d = 1;; ++d)
+		{
+			std::vector<size_t> slots;
+			bool ok = true;
+			for (size_t k : keys)
+			{
+				size_t s = KeyHash(entries[k].find, static_cast<uint32_t>(d)) % n;
+				if (slotOf[s] >= 0 || std::find(slots.begin(), slots.end(), s) != slots.end())
+				{
+					ok = false;
+					break;
+				}
+				slots.push_back(s);
+			}
+			if (!ok) continue;
+			for (size_t i = 0; i < keys.size(); ++i)
+				slotOf[slots[i]] = static_cast<long>(keys[i]);
+			displacements[b] = d;
+			break;
+		}
+	}
+
+	size_t free = 0;
+	for (size_t b : order)
+	{
+		if (buckets[b].size() != 1) continue;
+		while (slotOf[free] >= 0) ++free;
+		slotOf[free] = static_cast<long>(buckets[b][0]);
+		displacements[b] = -static_cast<int32_t>(free) - 1;
+	}
+
+	std::vector<entry> placed;
+	for (size_t s = 0; s < n; ++s)
+		placed.push_back(entries[slotOf[s]]);
+	entries.swap(placed);
+	return displacements;
+}
+
+void WriteChars(FILE* out, const std::u16string& s)
+{
+	fputs("{ ", out);
+	for (char16_t c : s)
+		fprintf(out, "0x%04X, ", static_cast<unsigned>(c));
+	fputs("0 }", out);
+}
+
+void WriteImage(FILE* out, const std::u16string& replace, const font& f)
+{
+	WriteChars(out, replace);
+	fprintf(out, ", 0x%X, %ld, %ld, %ld, %s, %s, %s, %u, %u, %u, %u, %u",
+		f.overrideFlags, f.height, f.width, f.weight,
+		f.italic ? "true" : "false", f.underLine ? "true" : "false", f.strikeOut ? "true" : "false",
+		f.charSet, f.outPrecision, f.clipPrecision, f.quality, f.pitchAndFamily);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		fputs("Usage: embedrules FontMod.yaml EmbeddedRules.gen.hpp\n", stderr);
+		return 1;
+	}
+
+	YAML::Node config;
+	try
+	{
+		config = YAML::LoadFile(argv[1]);
+	}
+	catch (const std::exception& e)
+	{
+		fprintf(stderr, "embedrules: %s: %s\n", argv[1], e.what());
+		return 1;
+	}
+	if (!config.IsMap())
+	{
+		fprintf(stderr, "embedrules: %s: root node is not a map\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<entry> entries;
+	if (auto node = FindNode(config, "fonts"); node && node.IsMap())
+	{
+		for (const auto& i : node)
+		{
+			if (!i.first.IsScalar() || !i.second.IsMap()) continue;
+			entry e = {};
+			if (!Face(i.first, e.find) || !Face(ReplaceNode(i.second), e.replace)) continue;
+			ReadStyle(i.second, e.image);
+			// later keys win, as with fontsMap[find] = fontInfo
+			auto same = std::find_if(entries.begin(), entries.end(), [&](const entry& x) { return x.find == e.find; });
+			if (same != entries.end())
+				*same = e;
+			else
+				entries.push_back(e);
+		}
+	}
+
+	GSOFontMode fixGSOFont = DISABLED;
+	std::u16string gsoFace;
+	font gsoFont = {};
+	if (auto node = FindNode(config, "fixGSOFont"); node)
+	{
+		if (node.IsScalar())
+		{
+			if (node.as<bool>())
+				fixGSOFont = USE_NCM_FONT;
+		}
+		else if (node.IsMap() && Face(ReplaceNode(node), gsoFace))
+		{
+			fixGSOFont = USE_USER_FONT;
+			ReadStyle(node, gsoFont);
+		}
+	}
+
+	bool debug = false, introspect = false, traceStartup = false;
+	unsigned long logSize = 0, logGenerations = 0;
+	if (auto node = FindNode(config, "debug"); node)
+	{
+		if (node.IsScalar())
+		{
+			debug = node.as<bool>();
+		}
+		else if (node.IsMap())
+		{
+			debug = true;
+			if (auto n = FindNode(node, "size"); n && n.IsScalar())
+				logSize = strtoul(n.as<std::string>().c_str(), nullptr, 10);
+			if (auto n = FindNode(node, "generations"); n && n.IsScalar())
+				logGenerations = strtoul(n.as<std::string>().c_str(), nullptr, 10);
+		}
+	}
+	if (auto node = FindNode(config, "introspect"); node && node.IsScalar())
+		introspect = node.as<bool>();
+	if (auto node = FindNode(config, "traceStartup"); node && node.IsScalar())
+		traceStartup = node.as<bool>();
+	PrewarmMode prewarm = PREWARM_OFF;
+	if (auto node = FindNode(config, "prewarm"); node && node.IsScalar())
+	{
+		if (node.as<std::string>() == "select")
+			prewarm = PREWARM_SELECT;
+		else if (node.as<bool>(false))
+			prewarm = PREWARM_CREATE;
+	}
+	bool cacheMetrics = false;
+	if (auto node = FindNode(config, "cacheMetrics"); node && node.IsScalar())
+		cacheMetrics = node.as<bool>();
+
+	auto displacements = BuildDisplacements(entries);
+
+	FILE* out = fopen(argv[2], "w");
+	if (!out)
+	{
+		fprintf(stderr, "embedrules: can not write %s\n", argv[2]);
+		return 1;
+	}
+
+	const size_t n = entries.size();
+	const size_t size = n ? n : 1; // no zero sized arrays
+	fprintf(out, "// Generated by tools/embedrules from %s, do not edit\n", argv[1]);
+	fputs("#pragma once\n\n#include \"RuleImage.hpp\"\n\nnamespace embedded {\n\n", out);
+	fprintf(out, "constexpr size_t RULE_COUNT = %zu;\n\n", n);
+	fprintf(out, "constexpr int32_t DISPLACEMENTS[%zu] = {", size);
+	for (size_t i = 0; i < size; ++i)
+		fprintf(out, "%s%d", i ? ", " : " ", n ? displacements[i] : 0);
+	fputs(" };\n\n", out);
+	fprintf(out, "constexpr rule RULES[%zu] = {\n", size);
+	for (auto& e : entries)
+	{
+		fputs("\t{ ", out);
+		WriteChars(out, e.find);
+		fputs(", { ", out);
+		WriteImage(out, e.replace, e.image);
+		fputs(" } },\n", out);
+	}
+	if (n == 0)
+		fputs("\t{},\n", out);
+	fputs("};\n\n", out);
+
+	static const char* const modes[] = { "DISABLED", "USE_NCM_FONT", "USE_USER_FONT" };
+	fprintf(out, "constexpr GSOFontMode FIX_GSO_FONT = %s;\n", modes[fixGSOFont]);
+	fputs("constexpr font GSO_FONT = { ", out);
+	WriteImage(out, gsoFace, gsoFont);
+	fputs(" };\n", out);
+	fprintf(out, "constexpr bool DEBUG_LOG = %s;\n", debug ? "true" : "false");
+	fprintf(out, "constexpr size_t LOG_SEGMENT_SIZE = %lu * 1024; // 0 keeps the default\n", logSize);
+	fprintf(out, "constexpr unsigned LOG_GENERATIONS = %lu;\n", logGenerations);
+	fprintf(out, "constexpr bool INTROSPECT = %s;\n", introspect ? "true" : "false");
+	fprintf(out, "constexpr bool TRACE_STARTUP = %s;\n", traceStartup ? "true" : "false");
+	static const char* const prewarmModes[] = { "PREWARM_OFF", "PREWARM_CREATE", "PREWARM_SELECT" };
+	fprintf(out, "constexpr PrewarmMode PREWARM = %s;\n", prewarmModes[prewarm]);
+	fprintf(out, "constexpr bool CACHE_METRICS = %s;\n\n", cacheMetrics ? "true" : "false");
+
+	fputs("constexpr const rule* Find(const wchar_t* name, size_t len)\n{\n"
+		"\treturn Find(RULES, DISPLACEMENTS, RULE_COUNT, name, len);\n}\n\n", out);
+	for (size_t i = 0; i < n; ++i)
+	{
+		fprintf(out, "static_assert(Find(RULES[%zu].find, %zu) == &RULES[%zu], \"perfect hash\");\n", i, entries[i].find.size(), i);
+	}
+	fputs("\n} // namespace embedded\n", out);
+	fclose(out);
+
+	fprintf(stderr, "embedrules: %zu rules\n", n);
+	return 0;
+}
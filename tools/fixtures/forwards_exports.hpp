@@ -0,0 +1,9 @@
+// Generated by tools/genexports from FIXTURE.dll, do not edit.
+// Included once per use with FIXTURE_EXPORT(name, ordinal), FIXTURE_FORWARD(name, ordinal, target)
+// and their _NONAME variants defined. EXPORT entries get a lazily resolved thunk.
+FIXTURE_EXPORT_NONAME(ordinal2, 2)
+FIXTURE_EXPORT(PlaySoundW, 3)
+FIXTURE_FORWARD(timeGetTime, 4, "KERNEL32.GetTickCount")
+FIXTURE_FORWARD_NONAME(ordinal5, 5, "WINMMBASE.#17")
+FIXTURE_EXPORT(waveOutOpen, 8)
+FIXTURE_FORWARD(mmioOpenW, 9, "api-ms-win-mm-misc-l1-1-0.mmioOpenW")
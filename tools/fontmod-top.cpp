@@ -0,0 +1,94 @@
+// Lists every live FontMod instance and the counters it publishes in the shared stats segment.
+//
+// Usage: fontmod-top [-n seconds]
+// Build: c++ -std=c++17 -O2 -I. tools/fontmod-top.cpp -o fontmod-top (add -lrt on older glibc)
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "Stats.hpp"
+
+namespace {
+
+void PrintInstances(const stats::segment& seg)
+{
+	const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	printf("%8s  %-24s %8s %10s %10s %10s %8s %6s %9s %9s %9s\n",
+		"PID", "EXE", "UPTIME", "CALLS", "HITS", "MISSES", "HFONTS", "UFONTS", "INIT(ms)", "1ST(ms)", "WARM(ms)");
+
+	size_t live = 0;
+	for (auto& inst : seg.instances)
+	{
+		uint32_t pid = inst.pid.load(std::memory_order_acquire);
+		if (pid == 0 || !stats::ProcessAlive(pid)) continue;
+		++live;
+
+		char exe[sizeof(inst.exe)];
+		memcpy(exe, inst.exe, sizeof(exe));
+		exe[sizeof(exe) - 1] = '\0';
+
+		int64_t uptime = now - inst.startTime.load(std::memory_order_relaxed);
+		printf("%8u  %-24.24s %7llds %10llu %10llu %10llu %8llu %6llu %9.2f %9.3f %9.2f\n",
+			pid, exe, static_cast<long long>(uptime),
+			static_cast<unsigned long long>(inst.hookCalls.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(inst.ruleHits.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(inst.ruleMisses.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(inst.fontsCreated.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(inst.userFonts.load(std::memory_order_relaxed)),
+			inst.initTimeUs.load(std::memory_order_relaxed) / 1000.0,
+			inst.firstHitNs.load(std::memory_order_relaxed) / 1e6,
+			inst.prewarmUs.load(std::memory_order_relaxed) / 1000.0);
+	}
+	printf("%zu live instance(s)\n", live);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	int interval = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+		{
+			interval = atoi(argv[++i]);
+		}
+		else
+		{
+			fputs("Usage: fontmod-top [-n seconds]\n", stderr);
+			return 1;
+		}
+	}
+
+	stats::SharedSegment seg;
+	if (!seg.Open(true))
+	{
+		fputs("fontmod-top: no FontMod instance has published stats\n", stderr);
+		return 1;
+	}
+	if (!seg.Valid())
+	{
+		fputs("fontmod-top: stats segment has an incompatible layout\n", stderr);
+		return 1;
+	}
+
+	for (;;)
+	{
+		PrintInstances(*seg.get());
+		if (interval <= 0) break;
+		std::this_thread::sleep_for(std::chrono::seconds(interval));
+		putchar('\n');
+	}
+	return 0;
+}
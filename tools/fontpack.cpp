@@ -0,0 +1,304 @@
+// Builds and checks fonts.pack, the single file FontMod loads user fonts from.
+// Every font is zlib compressed on its own and indexed by file and family name,
+// `check` inflates each one with FontMod's decoder and compares it against zlib.
+//
+// Usage: fontpack build fonts.pack <font file or directory>...
+//        fontpack check fonts.pack
+//        fontpack list fonts.pack
+// Build: c++ -std=c++17 -O2 -I. tools/fontpack.cpp -lz -o fontpack
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "FontPack.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+uint16_t Be16(const std::vector<uint8_t>& d, size_t at)
+{
+	return static_cast<uint16_t>(d[at] << 8 | d[at + 1]);
+}
+
+uint32_t Be32(const std::vector<uint8_t>& d, size_t at)
+{
+	return static_cast<uint32_t>(Be16(d, at)) << 16 | Be16(d, at + 2);
+}
+
+void AppendUtf8(std::string& out, uint32_t c)
+{
+	if (c < 0x80)
+	{
+		out += static_cast<char>(c);
+	}
+	else if (c < 0x800)
+	{
+		out += static_cast<char>(0xC0 | c >> 6);
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000)
+	{
+		out += static_cast<char>(0xE0 | c >> 12);
+		out += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		out += static_cast<char>(0xF0 | c >> 18);
+		out += static_cast<char>(0x80 | (c >> 12 & 0x3F));
+		out += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+}
+
+// Family name (name ID 1) of the first face, preferring the Windows English record
+std::string FamilyName(const std::vector<uint8_t>& d)
+{
+	if (d.size() < 12) return {};
+	size_t face = 0;
+	if (memcmp(d.data(), "ttcf", 4) == 0)
+	{
+		if (d.size() < 16) return {};
+		face = Be32(d, 12);
+	}
+	if (face + 12 > d.size()) return {};
+
+	size_t tables = Be16(d, face + 4);
+	size_t name = 0, nameSize = 0;
+	for (size_t i = 0; i < tables && face + 12 + i * 16 + 16 <= d.size(); ++i)
+	{
+		size_t rec = face + 12 + i * 16;
+		if (memcmp(&d[rec], "name", 4) == 0)
+		{
+			name = Be32(d, rec + 8);
+			nameSize = Be32(d, rec + 12);
+		}
+	}
+	if (!name || name + 6 > d.size() || nameSize > d.size() - name) return {};
+
+	size_t count = Be16(d, name + 2), strings = name + Be16(d, name + 4);
+	int best = -1;
+	std::string family;
+	for (size_t i = 0; i < count && name + 6 + i * 12 + 12 <= d.size(); ++i)
+	{
+		size_t rec = name + 6 + i * 12;
+		uint16_t platform = Be16(d, rec), language = Be16(d, rec + 4), id = Be16(d, rec + 6);
+		size_t len = Be16(d, rec + 8), at = strings + Be16(d, rec + 10);
+		if (id != 1 || at + len > d.size()) continue;
+
+		int rank = platform == 3 ? (language == 0x409 ? 3 : 2) : platform == 1 ? 1 : 0;
+		if (rank <= best) continue;
+		std::string s;
+		if (platform == 3 || platform == 0)
+		{
+			for (size_t k = 0; k + 1 < len; k += 2)
+			{
+				uint32_t c = Be16(d, at + k);
+				if (c >= 0xD800 && c < 0xDC00 && k + 3 < len)
+				{
+					c = 0x10000 + ((c - 0xD800) << 10) + (Be16(d, at + k + 2) - 0xDC00);
+					k += 2;
+				}
+				AppendUtf8(s, c);
+			}
+		}
+		else
+		{
+			for (size_t k = 0; k < len; ++k)
+				AppendUtf8(s, d[at + k]); // Mac Roman, close enough for ASCII names
+		}
+		best = rank;
+		family = s;
+	}
+	return family;
+}
+
+bool ReadFile(const fs::path& path, std::vector<uint8_t>& out)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return true;
+}
+
+bool IsFont(const fs::path& path)
+{
+	auto ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+	return ext == ".ttf" || ext == ".otf" || ext == ".ttc" || ext == ".otc" || ext == ".fon" || ext == ".fnt";
+}
+
+int Build(const char* output, char** inputs, int count)
+{
+	std::vector<fs::path> files;
+	for (int i = 0; i < count; ++i)
+	{
+		fs::path in = inputs[i];
+		if (fs::is_directory(in))
+		{
+			std::vector<fs::path> found;
+			for (auto& f : fs::directory_iterator(in))
+			{
+				if (f.is_regular_file() && IsFont(f.path())) found.push_back(f.path());
+			}
+			std::sort(found.begin(), found.end());
+			files.insert(files.end(), found.begin(), found.end());
+		}
+		else
+		{
+			files.push_back(in);
+		}
+	}
+
+	std::vector<pack::entry> entries;
+	std::string names;
+	std::vector<std::vector<uint8_t>> blobs;
+	for (auto& path : files)
+	{
+		std::vector<uint8_t> data;
+		if (!ReadFile(path, data) || data.size() > pack::MAX_FONT_SIZE)
+		{
+			fprintf(stderr, "fontpack: can not read %s\n", path.string().c_str());
+			return 1;
+		}
+
+		pack::entry e = {};
+		e.size = static_cast<uint32_t>(data.size());
+		e.crc = pack::Crc32(data.data(), data.size());
+
+		uLongf packedSize = compressBound(static_cast<uLong>(data.size()));
+		std::vector<uint8_t> packed(packedSize);
+		if (compress2(packed.data(), &packedSize, data.data(), static_cast<uLong>(data.size()), Z_BEST_COMPRESSION) != Z_OK)
+		{
+			fprintf(stderr, "fontpack: can not compress %s\n", path.string().c_str());
+			return 1;
+		}
+		packed.resize(packedSize);
+		if (packed.size() < data.size())
+		{
+			e.method = pack::METHOD_ZLIB;
+		}
+		else
+		{
+			e.method = pack::METHOD_STORED; // already compressed, WOFF2 and the like
+			packed = std::move(data);
+		}
+		e.packedSize = static_cast<uint32_t>(packed.size());
+
+		std::string name = path.filename().u8string(), family = FamilyName(e.method == pack::METHOD_STORED ? packed : data);
+		e.nameOffset = static_cast<uint32_t>(names.size());
+		e.nameLen = static_cast<uint16_t>(name.size());
+		names += name;
+		e.familyOffset = static_cast<uint32_t>(names.size());
+		e.familyLen = static_cast<uint16_t>(family.size());
+		names += family;
+
+		printf("%-40s %-32s %10u -> %10u\n", name.c_str(), family.c_str(), e.size, e.packedSize);
+		entries.push_back(e);
+		blobs.push_back(std::move(packed));
+	}
+
+	pack::header h = {};
+	memcpy(h.magic, pack::MAGIC, sizeof(h.magic));
+	h.version = pack::VERSION;
+	h.count = static_cast<uint32_t>(entries.size());
+	h.namesSize = static_cast<uint32_t>(names.size());
+
+	uint64_t offset = sizeof(h) + entries.size() * sizeof(pack::entry) + names.size();
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		entries[i].offset = offset;
+		offset += blobs[i].size();
+	}
+
+	FILE* out = fopen(output, "wb");
+	if (!out)
+	{
+		fprintf(stderr, "fontpack: can not write %s\n", output);
+		return 1;
+	}
+	fwrite(&h, sizeof(h), 1, out);
+	fwrite(entries.data(), sizeof(pack::entry), entries.size(), out);
+	fwrite(names.data(), 1, names.size(), out);
+	for (auto& b : blobs)
+		fwrite(b.data(), 1, b.size(), out);
+	bool ok = !ferror(out);
+	ok = fclose(out) == 0 && ok;
+	if (!ok)
+	{
+		fprintf(stderr, "fontpack: can not write %s\n", output);
+		return 1;
+	}
+	printf("%zu fonts, %llu bytes\n", entries.size(), static_cast<unsigned long long>(offset));
+	return 0;
+}
+
+int List(const char* input, bool check)
+{
+	pack::Reader reader;
+	if (!reader.Open(input))
+	{
+		fprintf(stderr, "fontpack: %s is not a readable font pack\n", input);
+		return 1;
+	}
+
+	size_t bad = 0;
+	std::vector<uint8_t> font, reference;
+	for (size_t i = 0; i < reader.Count(); ++i)
+	{
+		auto& e = reader.At(i);
+		auto name = reader.Name(i), family = reader.Family(i);
+		const char* state = "";
+		if (check)
+		{
+			state = "ok";
+			if (!reader.Extract(i, font))
+			{
+				state = "DAMAGED";
+			}
+			else if (e.method == pack::METHOD_ZLIB)
+			{
+				// same bytes as zlib itself would give
+				std::vector<uint8_t> packed(e.packedSize);
+				FILE* f = fopen(input, "rb");
+				bool read = f && fseeko(f, static_cast<off_t>(e.offset), SEEK_SET) == 0 && fread(packed.data(), 1, packed.size(), f) == packed.size();
+				if (f) fclose(f);
+				reference.resize(e.size);
+				uLongf size = e.size;
+				if (!read || uncompress(reference.data(), &size, packed.data(), e.packedSize) != Z_OK || reference != font)
+					state = "MISMATCH";
+			}
+			if (strcmp(state, "ok") != 0) ++bad;
+		}
+		printf("%-40.*s %-32.*s %10u %10u %s\n", static_cast<int>(name.size()), name.data(),
+			static_cast<int>(family.size()), family.data(), e.size, e.packedSize, state);
+	}
+	if (check) printf("%zu fonts, %zu bad\n", reader.Count(), bad);
+	return bad ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc >= 4 && strcmp(argv[1], "build") == 0)
+		return Build(argv[2], argv + 3, argc - 3);
+	if (argc == 3 && strcmp(argv[1], "check") == 0)
+		return List(argv[2], true);
+	if (argc == 3 && strcmp(argv[1], "list") == 0)
+		return List(argv[2], false);
+
+	fputs("usage: fontpack build fonts.pack <font file or directory>...\n"
+		"       fontpack check fonts.pack\n"
+		"       fontpack list fonts.pack\n", stderr);
+	return 2;
+}
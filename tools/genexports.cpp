@@ -0,0 +1,282 @@
+// Generates the proxy export list (orig_winmm/winmm_exports.hpp) from a system DLL.
+//
+// Exports the system DLL itself forwards elsewhere are re-emitted as linker forwarders,
+// which the loader binds directly and cost nothing per call. Exports implemented in the
+// system DLL can not be forwarded by name (the name would resolve back to the proxy), so
+// they get a lazily resolved thunk unless --forward-path gives an absolute location.
+//
+// Usage: genexports [--prefix WINMM] [--thunk name]... [--forward-path dir] winmm.dll
+// Build: cmake -S . -B build && cmake --build build --target genexports
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct section
+{
+	uint32_t va, vsize, raw, rawSize, characteristics;
+};
+
+struct exportEntry
+{
+	uint16_t ordinal;
+	std::string name;    // empty for ordinal-only exports
+	std::string forward; // "DLL.func" or "DLL.#ord" for forwarded exports
+	bool data;
+};
+
+constexpr uint32_t IMAGE_SCN_MEM_EXECUTE = 0x20000000;
+
+class PeFile
+{
+public:
+	explicit PeFile(std::vector<uint8_t> bytes) : image(std::move(bytes)) {}
+
+	bool Parse(std::string& err)
+	{
+		if (Read16(0) != 0x5A4D) { err = "missing MZ signature"; return false; }
+		uint32_t pe = Read32(0x3C);
+		if (Read32(pe) != 0x00004550) { err = "missing PE signature"; return false; }
+
+		uint16_t sections = Read16(pe + 6);
+		uint16_t optSize = Read16(pe + 20);
+		uint32_t opt = pe + 24;
+		uint16_t magic = Read16(opt);
+		uint32_t dirs;
+		if (magic == 0x10B) dirs = opt + 96;
+		else if (magic == 0x20B) dirs = opt + 112;
+		else { err = "unknown optional header magic"; return false; }
+
+		exportRva = Read32(dirs);
+		exportSize = Read32(dirs + 4);
+
+		uint32_t sec = opt + optSize;
+		for (uint16_t i = 0; i < sections; ++i, sec += 40)
+		{
+			section s;
+			s.vsize = Read32(sec + 8);
+			s.va = Read32(sec + 12);
+			s.rawSize = Read32(sec + 16);
+			s.raw = Read32(sec + 20);
+			s.characteristics = Read32(sec + 36);
+			sectionTable.push_back(s);
+		}
+		if (outOfRange) { err = "truncated headers"; return false; }
+		if (exportRva == 0) { err = "no export directory"; return false; }
+		return true;
+	}
+
+	bool Exports(std::string& dllName, std::vector<exportEntry>& out, std::string& err)
+	{
+		uint32_t dir = Offset(exportRva);
+		dllName = String(Offset(Read32(dir + 12)));
+		uint32_t base = Read32(dir + 16);
+		uint32_t functions = Read32(dir + 20);
+		uint32_t names = Read32(dir + 24);
+		uint32_t addrFunctions = Offset(Read32(dir + 28));
+		uint32_t addrNames = Offset(Read32(dir + 32));
+		uint32_t addrOrdinals = Offset(Read32(dir + 36));
+		if (functions > 0xFFFF || names > functions) { err = "corrupt export directory"; return false; }
+
+		std::map<uint32_t, std::string> nameOf;
+		for (uint32_t i = 0; i < names; ++i)
+		{
+			uint16_t index = Read16(addrOrdinals + i * 2);
+			nameOf[index] = String(Offset(Read32(addrNames + i * 4)));
+		}
+
+		for (uint32_t i = 0; i < functions; ++i)
+		{
+			uint32_t rva = Read32(addrFunctions + i * 4);
+			if (rva == 0) continue; // unused ordinal
+			exportEntry e;
+			e.ordinal = static_cast<uint16_t>(base + i);
+			if (auto it = nameOf.find(i); it != nameOf.end()) e.name = it->second;
+			if (rva >= exportRva && rva < exportRva + exportSize)
+			{
+				e.forward = String(Offset(rva));
+				e.data = false;
+			}
+			else
+			{
+				const section* s = SectionOf(rva);
+				e.data = s && !(s->characteristics & IMAGE_SCN_MEM_EXECUTE);
+			}
+			out.push_back(std::move(e));
+		}
+		if (outOfRange) { err = "export directory points outside of file"; return false; }
+		return true;
+	}
+
+private:
+	std::vector<uint8_t> image;
+	std::vector<section> sectionTable;
+	uint32_t exportRva = 0, exportSize = 0;
+	bool outOfRange = false;
+
+	uint32_t Read32(uint32_t off)
+	{
+		if (off + 4 > image.size()) { outOfRange = true; return 0; }
+		uint32_t v;
+		memcpy(&v, &image[off], 4);
+		return v;
+	}
+
+	uint16_t Read16(uint32_t off)
+	{
+		if (off + 2 > image.size()) { outOfRange = true; return 0; }
+		uint16_t v;
+		memcpy(&v, &image[off], 2);
+		return v;
+	}
+
+	std::string String(uint32_t off)
+	{
+		std::string s;
+		while (off < image.size() && image[off]) s.push_back(static_cast<char>(image[off++]));
+		if (off >= image.size()) outOfRange = true;
+		return s;
+	}
+
+	const section* SectionOf(uint32_t rva) const
+	{
+		for (auto& s : sectionTable)
+		{
+			uint32_t size = s.vsize ? s.vsize : s.rawSize;
+			if (rva >= s.va && rva < s.va + size) return &s;
+		}
+		return nullptr;
+	}
+
+	uint32_t Offset(uint32_t rva)
+	{
+		if (auto s = SectionOf(rva)) return rva - s->va + s->raw;
+		outOfRange = true;
+		return 0;
+	}
+};
+
+bool IsIdentifier(const std::string& s)
+{
+	if (s.empty() || (s[0] >= '0' && s[0] <= '9')) return false;
+	for (char c : s)
+	{
+		if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+			return false;
+	}
+	return true;
+}
+
+std::string Escape(const std::string& s)
+{
+	std::string r;
+	for (char c : s)
+	{
+		if (c == '\\' || c == '"') r.push_back('\\');
+		r.push_back(c);
+	}
+	return r;
+}
+
+int Usage()
+{
+	fputs("Usage: genexports [--prefix WINMM] [--thunk name]... [--forward-path dir] dll\n", stderr);
+	return 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string prefix = "WINMM";
+	std::string forwardPath;
+	std::set<std::string> thunks;
+	const char* input = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--prefix") && i + 1 < argc) prefix = argv[++i];
+		else if (!strcmp(argv[i], "--thunk") && i + 1 < argc) thunks.insert(argv[++i]);
+		else if (!strcmp(argv[i], "--forward-path") && i + 1 < argc) forwardPath = argv[++i];
+		else if (argv[i][0] == '-' || input) return Usage();
+		else input = argv[i];
+	}
+	if (!input) return Usage();
+
+	std::ifstream f(input, std::ios::binary);
+	if (!f)
+	{
+		fprintf(stderr, "genexports: can not open %s\n", input);
+		return 1;
+	}
+	PeFile pe(std::vector<uint8_t>((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>()));
+
+	std::string err, dllName;
+	std::vector<exportEntry> exports;
+	if (!pe.Parse(err) || !pe.Exports(dllName, exports, err))
+	{
+		fprintf(stderr, "genexports: %s: %s\n", input, err.c_str());
+		return 1;
+	}
+
+	// Forwarders name the module without extension
+	std::string module = dllName.substr(0, dllName.rfind('.'));
+	if (!forwardPath.empty())
+	{
+		if (forwardPath.back() != '\\' && forwardPath.back() != '/') forwardPath.push_back('\\');
+		module = forwardPath + module;
+	}
+
+	printf("// Generated by tools/genexports from %s, do not edit.\n", dllName.c_str());
+	printf("// Included once per use with %s_EXPORT(name, ordinal), %s_FORWARD(name, ordinal, target)\n", prefix.c_str(), prefix.c_str());
+	printf("// and their _NONAME variants defined. EXPORT entries get a lazily resolved thunk.\n");
+
+	size_t nForward = 0, nThunk = 0;
+	for (auto& e : exports)
+	{
+		// Ordinal-only exports still need an identifier for the thunk symbol
+		std::string ident = e.name.empty() ? "ordinal" + std::to_string(e.ordinal) : e.name;
+		const char* noname = e.name.empty() ? "_NONAME" : "";
+		if (!IsIdentifier(ident))
+		{
+			fprintf(stderr, "genexports: skipping export \"%s\", not an identifier\n", e.name.c_str());
+			continue;
+		}
+
+		std::string target;
+		if (!e.forward.empty()) target = e.forward;
+		else if (!forwardPath.empty() || e.data)
+			target = module + "." + (e.name.empty() ? "#" + std::to_string(e.ordinal) : e.name);
+
+		if (thunks.count(ident) && !e.data) target.clear();
+
+		if (e.data && forwardPath.empty() && e.forward.empty())
+		{
+			// A thunk is code, a data export only works as forwarder to an absolute path
+			fprintf(stderr, "genexports: data export %s needs --forward-path\n", ident.c_str());
+			printf("// %s (@%u) is a data export, use --forward-path to proxy it\n", ident.c_str(), e.ordinal);
+			continue;
+		}
+
+		if (target.empty())
+		{
+			printf("%s_EXPORT%s(%s, %u)\n", prefix.c_str(), noname, ident.c_str(), e.ordinal);
+			++nThunk;
+		}
+		else
+		{
+			printf("%s_FORWARD%s(%s, %u, \"%s\")\n", prefix.c_str(), noname, ident.c_str(), e.ordinal, Escape(target).c_str());
+			++nForward;
+		}
+	}
+	fprintf(stderr, "genexports: %zu forwarders, %zu thunks\n", nForward, nThunk);
+	return 0;
+}
@@ -0,0 +1,187 @@
+// Writes a minimal x64 PE image whose export directory holds the entries of a genexports list,
+// the fixture genexports is checked against: running genexports on it must give the list back.
+// EXPORT entries point into an executable section, FORWARD entries get their forwarder string.
+// The DLL name is taken from the list's "Generated by tools/genexports from" line.
+//
+// Usage: pe-fixture exports.hpp out.dll
+// Build: cmake -S . -B build && cmake --build build --target pe-fixture
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct entry
+{
+	std::string name;    // empty for _NONAME
+	std::string forward; // empty for EXPORT
+};
+
+constexpr uint32_t FILE_ALIGN = 0x200;
+constexpr uint32_t TEXT_RVA = 0x1000, EDATA_RVA = 0x2000;
+
+void Put16(std::vector<uint8_t>& image, size_t off, uint16_t v)
+{
+	memcpy(&image[off], &v, 2);
+}
+
+void Put32(std::vector<uint8_t>& image, size_t off, uint32_t v)
+{
+	memcpy(&image[off], &v, 4);
+}
+
+std::string Unescape(const std::string& s)
+{
+	std::string r;
+	for (size_t i = 0; i < s.size(); ++i)
+	{
+		if (s[i] == '\\' && i + 1 < s.size()) ++i;
+		r.push_back(s[i]);
+	}
+	return r;
+}
+
+// The export directory with everything it points to, laid out from EDATA_RVA
+std::vector<uint8_t> ExportSection(const std::string& dllName, const std::map<uint16_t, entry>& exports)
+{
+	uint16_t base = exports.begin()->first;
+	uint32_t functions = exports.rbegin()->first - base + 1;
+	std::vector<std::pair<std::string, uint16_t>> names;
+	for (auto& [ordinal, e] : exports)
+	{
+		if (!e.name.empty()) names.emplace_back(e.name, static_cast<uint16_t>(ordinal - base));
+	}
+	// the loader looks names up by binary search
+	std::sort(names.begin(), names.end());
+
+	uint32_t addrFunctions = 40;
+	uint32_t addrNames = addrFunctions + functions * 4;
+	uint32_t addrOrdinals = addrNames + static_cast<uint32_t>(names.size()) * 4;
+	std::vector<uint8_t> edata(addrOrdinals + names.size() * 2);
+	auto addString = [&](const std::string& s) {
+		uint32_t rva = EDATA_RVA + static_cast<uint32_t>(edata.size());
+		edata.insert(edata.end(), s.begin(), s.end());
+		edata.push_back(0);
+		return rva;
+	};
+
+	Put32(edata, 12, addString(dllName));
+	Put32(edata, 16, base);
+	Put32(edata, 20, functions);
+	Put32(edata, 24, static_cast<uint32_t>(names.size()));
+	Put32(edata, 28, EDATA_RVA + addrFunctions);
+	Put32(edata, 32, EDATA_RVA + addrNames);
+	Put32(edata, 36, EDATA_RVA + addrOrdinals);
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		Put32(edata, addrNames + i * 4, addString(names[i].first));
+		Put16(edata, addrOrdinals + i * 2, names[i].second);
+	}
+	for (auto& [ordinal, e] : exports)
+	{
+		// every code export gets its own byte of .text, forwarders point into the export directory
+		uint32_t rva = e.forward.empty() ? TEXT_RVA + (ordinal - base) : addString(e.forward);
+		Put32(edata, addrFunctions + (ordinal - base) * 4, rva);
+	}
+	return edata;
+}
+
+std::vector<uint8_t> Image(const std::string& dllName, const std::map<uint16_t, entry>& exports)
+{
+	std::vector<uint8_t> edata = ExportSection(dllName, exports);
+	uint32_t textSize = exports.rbegin()->first - exports.begin()->first + 1;
+	auto aligned = [](uint32_t v) { return (v + FILE_ALIGN - 1) & ~(FILE_ALIGN - 1); };
+	uint32_t textRaw = FILE_ALIGN, edataRaw = textRaw + aligned(textSize);
+	std::vector<uint8_t> image(edataRaw + aligned(static_cast<uint32_t>(edata.size())));
+
+	const uint32_t pe = 0x40, opt = pe + 24, optSize = 240;
+	Put16(image, 0, 0x5A4D); // MZ
+	Put32(image, 0x3C, pe);
+	Put32(image, pe, 0x00004550); // PE\0\0
+	Put16(image, pe + 4, 0x8664);
+	Put16(image, pe + 6, 2);
+	Put16(image, pe + 20, optSize);
+	Put16(image, pe + 22, 0x2022); // executable, large address aware, DLL
+	Put16(image, opt, 0x20B);
+	Put32(image, opt + 108, 16); // data directories
+	Put32(image, opt + 112, EDATA_RVA);
+	Put32(image, opt + 116, static_cast<uint32_t>(edata.size()));
+
+	struct { const char* name; uint32_t rva, size, raw, characteristics; } sections[] = {
+		{ ".text", TEXT_RVA, textSize, textRaw, 0x60000020 },
+		{ ".edata", EDATA_RVA, static_cast<uint32_t>(edata.size()), edataRaw, 0x40000040 },
+	};
+	uint32_t sec = opt + optSize;
+	for (auto& s : sections)
+	{
+		memcpy(&image[sec], s.name, strlen(s.name));
+		Put32(image, sec + 8, s.size);
+		Put32(image, sec + 12, s.rva);
+		Put32(image, sec + 16, aligned(s.size));
+		Put32(image, sec + 20, s.raw);
+		Put32(image, sec + 36, s.characteristics);
+		sec += 40;
+	}
+	memset(&image[textRaw], 0xC3, textSize);
+	std::copy(edata.begin(), edata.end(), image.begin() + edataRaw);
+	return image;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		fputs("Usage: pe-fixture exports.hpp out.dll\n", stderr);
+		return 1;
+	}
+	std::ifstream in(argv[1]);
+	if (!in)
+	{
+		fprintf(stderr, "pe-fixture: can not open %s\n", argv[1]);
+		return 1;
+	}
+
+	const std::regex generated(R"(^// Generated by tools/genexports from (\S+), do not edit\.)");
+	const std::regex line(R"re(^\w+_(EXPORT|FORWARD)(_NONAME)?\((\w+), (\d+)(?:, "((?:[^"\\]|\\.)*)")?\)\s*$)re");
+	std::string dllName;
+	std::map<uint16_t, entry> exports;
+	std::smatch m;
+	for (std::string s; std::getline(in, s);)
+	{
+		if (std::regex_search(s, m, generated))
+		{
+			dllName = m[1];
+		}
+		else if (std::regex_match(s, m, line))
+		{
+			bool forward = m[1] == "FORWARD";
+			if (forward != m[5].matched) continue;
+			entry e{ m[2].matched ? "" : m[3].str(), Unescape(m[5]) };
+			exports[static_cast<uint16_t>(std::stoul(m[4]))] = e;
+		}
+	}
+	if (dllName.empty() || exports.empty())
+	{
+		fprintf(stderr, "pe-fixture: %s is no genexports list\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<uint8_t> image = Image(dllName, exports);
+	std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(image.data()), image.size());
+	if (!out)
+	{
+		fprintf(stderr, "pe-fixture: can not write %s\n", argv[2]);
+		return 1;
+	}
+	return 0;
+}
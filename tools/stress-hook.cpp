@@ -0,0 +1,266 @@
+// Runs the CreateFontIndirectExW hook path from 1 to 64 threads at once: hookpath::Call with
+// the rule engine of a FontMod.yaml, the stats counters, the latency histograms and the
+// caller profile, GDI replaced by a stub. The fonts are the [CreateFont] lines of a
+// FontMod.log from debug mode, or a synthetic mix of faces with and without a rule.
+// With --log a thread turns FontMod.log tracing on and off all the time, as the `trace`
+// introspection command does. Rules with a `replace` list are resolved again and again
+// meanwhile, as after the fonts folder changes. Prints calls per second, the scaling over one thread and
+// the latency percentiles of a call, and checks every counter adds up after each round.
+// Build with -DCMAKE_CXX_FLAGS=-fsanitize=thread to have the races reported.
+//
+// Usage: stress-hook [--log] [FontMod.yaml] [max threads] [calls per thread] [FontMod.log] [GDI ns]
+// Build: cmake -S . -B build && cmake --build build --target stress-hook
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Config.hpp"
+#include "HookPath.hpp"
+#include "RuleEngine.hpp"
+#include "Transcode.hpp"
+
+namespace {
+
+// The fonts of the [CreateFont] lines, in call order
+bool ReadTrace(const char* path, std::vector<LOGFONTW>& trace)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	const std::string tag = "[CreateFont] name = \"";
+	std::string line;
+	std::wstring face;
+	while (std::getline(in, line))
+	{
+		auto at = line.find(tag);
+		if (at == std::string::npos) continue;
+		at += tag.size();
+		auto end = line.find("\", height = ", at);
+		if (end == std::string::npos || !Utf8ToUtf16(std::string_view(line).substr(at, end - at), face) || face.size() >= LF_FACESIZE) continue;
+		LOGFONTW lf = {};
+		face.copy(lf.lfFaceName, LF_FACESIZE - 1);
+		int height = 0, width = 0, escapement = 0, orientation = 0, weight = 0, charSet = 0;
+		char italic[8] = "";
+		sscanf(line.c_str() + end, "\", height = %d, width = %d, escapement = %d, orientation = %d, weight = %d, italic = %7[a-z]",
+			&height, &width, &escapement, &orientation, &weight, italic);
+		if (auto cs = line.find("charset = ", end); cs != std::string::npos)
+			charSet = atoi(line.c_str() + cs + 10);
+		lf.lfHeight = height;
+		lf.lfWidth = width;
+		lf.lfWeight = weight;
+		lf.lfItalic = strcmp(italic, "true") == 0;
+		lf.lfCharSet = static_cast<uint8_t>(charSet);
+		trace.push_back(lf);
+	}
+	return true;
+}
+
+// UI fonts at a few sizes, most of them without a rule
+std::vector<LOGFONTW> Synthesize(const std::vector<std::wstring>& keys)
+{
+	const wchar_t* const misses[] = { L"Segoe UI", L"Tahoma", L"Arial", L"Microsoft Sans Serif", L"Consolas",
+		L"Segoe UI Symbol", L"Marlett", L"Courier New", L"MS Shell Dlg 2" };
+	std::mt19937 rng(11);
+	std::vector<LOGFONTW> trace;
+	for (int i = 0; i < 8192; ++i)
+	{
+		LOGFONTW lf = {};
+		const wchar_t* face = keys.empty() || rng() % 3 ? misses[rng() % 9] : keys[rng() % keys.size()].c_str();
+		wcsncpy(lf.lfFaceName, face, LF_FACESIZE - 1);
+		lf.lfHeight = -static_cast<int>(12 + rng() % 4 * 2);
+		lf.lfWeight = rng() % 5 ? 400 : 700;
+		lf.lfCharSet = 1;
+		trace.push_back(lf);
+	}
+	return trace;
+}
+
+// Stands in for GDI: busy for `ns`, returns a handle derived from the font
+uintptr_t StubCreate(const LOGFONTW& lf, uint64_t ns)
+{
+	if (ns)
+	{
+		auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+		while (std::chrono::steady_clock::now() < until) {}
+	}
+	return 0x1000 | (static_cast<uintptr_t>(lf.lfFaceName[0]) << 16) | static_cast<uint16_t>(lf.lfHeight);
+}
+
+uint64_t Percentile(std::vector<uint32_t>& v, double p)
+{
+	size_t i = std::min(v.size() - 1, static_cast<size_t>(p * v.size()));
+	std::nth_element(v.begin(), v.begin() + i, v.end());
+	return v[i];
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bool toggleLog = argc > 1 && strcmp(argv[1], "--log") == 0;
+	if (toggleLog)
+	{
+		--argc;
+		++argv;
+	}
+	const char* path = argc > 1 ? argv[1] : "FontMod.yaml";
+	size_t maxThreads = argc > 2 ? strtoul(argv[2], nullptr, 10) : 64;
+	size_t calls = argc > 3 ? strtoul(argv[3], nullptr, 10) : 100000;
+	uint64_t gdiNs = argc > 5 ? strtoull(argv[5], nullptr, 10) : 0;
+
+	config::settings settings;
+	std::string errMsg;
+	if (!config::LoadSettings(path, errMsg, settings))
+	{
+		fprintf(stderr, "stress-hook: %s\n", errMsg.c_str());
+		return 1;
+	}
+	std::vector<LOGFONTW> trace;
+	if (argc > 4 && strcmp(argv[4], "-") != 0)
+	{
+		if (!ReadTrace(argv[4], trace) || trace.empty())
+		{
+			fprintf(stderr, "stress-hook: no [CreateFont] lines in %s\n", argv[4]);
+			return 1;
+		}
+	}
+	else
+	{
+		trace = Synthesize(settings.order);
+	}
+
+	// tracing starts off and is toggled like `trace on|off`, the sink stays mapped once opened
+	auto logPath = std::filesystem::temp_directory_path() / ("stress-hook." + std::to_string(std::random_device()()) + ".log");
+	logsink::MappedLog sink;
+	std::atomic<logsink::MappedLog*> log{ nullptr };
+	introspect::LatencyHistogram rewriteLatency, createLatency;
+	introspect::clients.store(1); // an attached client turns the latency histograms on
+
+	printf("%zu rules, %zu fonts in the stream, %zu calls per thread, %u hardware threads%s\n",
+		settings.order.size(), trace.size(), calls, std::thread::hardware_concurrency(), toggleLog ? ", logging toggled" : "");
+	printf("%8s %14s %9s %9s %9s %9s %11s\n", "threads", "calls/s", "scaling", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+
+	double single = 0;
+	bool ok = true;
+	for (size_t threads = 1; threads <= maxThreads && ok; threads *= 2)
+	{
+		rules::Engine engine; // fresh hit counters
+		engine.Build(settings.order, settings.fonts, nullptr, &settings.chains);
+		auto procStats = std::make_unique<stats::instance>();
+		callers::Table callerTable;
+		const hookpath::shared s = { procStats.get(), &log, &rewriteLatency, &createLatency, &callerTable };
+
+		std::vector<std::vector<uint32_t>> latency(threads, std::vector<uint32_t>(calls));
+		std::atomic<size_t> ready{ 0 }, done{ 0 };
+		std::atomic<bool> go{ false };
+		std::vector<std::thread> pool;
+		for (size_t t = 0; t < threads; ++t)
+		{
+			pool.emplace_back([&, t] {
+				// a few call sites per thread for the caller profile
+				uintptr_t frames[3] = { 0x7ff820001a0, 0x140000000 + (t % 8) * 0x100, 0x140010000 };
+				auto& lat = latency[t];
+				ready.fetch_add(1);
+				while (!go.load(std::memory_order_acquire)) {}
+				for (size_t i = 0; i < calls; ++i)
+				{
+					const LOGFONTW& requested = trace[(i + t * 7919) % trace.size()];
+					frames[2] = 0x140010000 + (i & 3) * 0x40;
+					auto begin = std::chrono::steady_clock::now();
+					stats::Add(procStats->hookCalls);
+					uintptr_t font = hookpath::Call<true, true, true, true>(s, requested, frames, 3,
+						[&](LOGFONTW& lf) { return engine.Rewrite(lf); },
+						[&](const LOGFONTW& lf, bool) { return StubCreate(lf, gdiNs); });
+					auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+					lat[i] = static_cast<uint32_t>(std::min<int64_t>(ns, UINT32_MAX));
+					if (!font) abort();
+				}
+				done.fetch_add(1, std::memory_order_release);
+			});
+		}
+
+		while (ready.load() != threads) {}
+		std::thread toggler;
+		if (toggleLog)
+		{
+			toggler = std::thread([&] {
+				bool on = false;
+				while (done.load(std::memory_order_acquire) != threads)
+				{
+					on = !on;
+					if (on && !sink.Open(logPath, 8 << 20, 2)) on = false;
+					log.store(on ? &sink : nullptr);
+					std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				}
+				log.store(nullptr);
+			});
+		}
+		std::thread resolver;
+		if (engine.Chained())
+		{
+			resolver = std::thread([&] {
+				// every chain alternates between its first and its last candidate
+				rules::FaceSet none, last;
+				for (auto& [key, candidates] : settings.chains)
+					last.Add(candidates.back());
+				for (bool flip = false; done.load(std::memory_order_acquire) != threads; flip = !flip)
+				{
+					engine.Resolve(flip ? last : none);
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			});
+		}
+		auto start = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& p : pool)
+			p.join();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if (toggler.joinable()) toggler.join();
+		if (resolver.joinable()) resolver.join();
+
+		// every call must have been counted once everywhere
+		uint64_t total = threads * calls;
+		std::vector<uint64_t> hits;
+		uint64_t misses, ruleHits = 0, profiled = callerTable.Dropped();
+		engine.ReadCounters(hits, misses);
+		for (auto h : hits)
+			ruleHits += h;
+		for (auto& e : callerTable.Snapshot())
+			profiled += e.count;
+		auto& st = *procStats;
+		if (st.hookCalls.load() != total || st.ruleHits.load() + st.ruleMisses.load() != total ||
+			st.ruleHits.load() != ruleHits || ruleHits + misses != total || st.fontsCreated.load() != total || profiled != total)
+		{
+			fprintf(stderr, "stress-hook: counters do not add up to %llu calls with %zu threads\n", static_cast<unsigned long long>(total), threads);
+			ok = false;
+		}
+
+		std::vector<uint32_t> all;
+		all.reserve(total);
+		for (auto& l : latency)
+			all.insert(all.end(), l.begin(), l.end());
+		double rate = total / elapsed.count();
+		if (threads == 1) single = rate;
+		uint64_t p50 = Percentile(all, 0.5), p99 = Percentile(all, 0.99), p999 = Percentile(all, 0.999);
+		printf("%8zu %14.0f %8.2fx %9llu %9llu %9llu %11llu\n", threads, rate, rate / single,
+			static_cast<unsigned long long>(p50), static_cast<unsigned long long>(p99), static_cast<unsigned long long>(p999),
+			static_cast<unsigned long long>(*std::max_element(all.begin(), all.end())));
+	}
+
+	sink.Close();
+	std::error_code ec;
+	for (auto p : { logPath, std::filesystem::path(logPath.native() + ".1") })
+		std::filesystem::remove(p, ec);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+// Checks the per-thread rule hit counters under thread churn: many short threads must reuse the
+// shards of the ones that exited, more threads alive at once than MAX_SHARDS must share the overflow
+// shard instead of adding shards, and every hit and miss must be counted either way.
+//
+// Usage: test-hitcounters
+// Build: cmake -S . -B build && cmake --build build --target test-hitcounters
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "RuleCounters.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-hitcounters: %s\n", what);
+	++failures;
+}
+
+const size_t RULES = 10;
+
+// Every thread counts each rule once and one miss
+void CountOnce(rules::HitCounters& counters)
+{
+	for (size_t r = 0; r < RULES; ++r)
+		counters.Hit(r);
+	counters.Miss();
+}
+
+bool Counted(const rules::HitCounters& counters, uint64_t threads)
+{
+	std::vector<uint64_t> hits;
+	uint64_t misses;
+	counters.Read(hits, misses);
+	bool ok = hits.size() == RULES && misses == threads;
+	for (auto h : hits)
+		ok = ok && h == threads;
+	return ok;
+}
+
+// Short threads one after the other, as a host running work on threads it starts and ends
+void TestChurn()
+{
+	rules::HitCounters counters;
+	counters.Reset(RULES);
+	const size_t threads = 2000;
+	for (size_t t = 0; t < threads; t += 4)
+	{
+		std::thread a([&] { CountOnce(counters); }), b([&] { CountOnce(counters); }),
+			c([&] { CountOnce(counters); }), d([&] { CountOnce(counters); });
+		a.join();
+		b.join();
+		c.join();
+		d.join();
+	}
+	Check(counters.Shards() <= 4, "shards of exited threads reused");
+	Check(Counted(counters, threads), "every hit counted under churn");
+}
+
+// More threads alive at once than there are shards, as when leases are never returned
+void TestCap()
+{
+	rules::HitCounters counters;
+	counters.Reset(RULES);
+	const size_t threads = rules::HitCounters::MAX_SHARDS * 3;
+	std::atomic<size_t> counted{ 0 };
+	std::atomic<bool> done{ false };
+	std::vector<std::thread> pool;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		pool.emplace_back([&] {
+			for (int i = 0; i < 100; ++i)
+				CountOnce(counters);
+			++counted;
+			// keeps the shard leased until every thread counted
+			while (!done) std::this_thread::yield();
+		});
+	}
+	while (counted != threads) std::this_thread::yield();
+	Check(counters.Shards() == rules::HitCounters::MAX_SHARDS, "shards capped with every thread alive");
+	done = true;
+	for (auto& th : pool)
+		th.join();
+	Check(Counted(counters, threads * 100), "threads past the cap counted in the shared shard");
+
+	// a reset starts a new pool, the threads after it get shards of their own again
+	counters.Reset(RULES);
+	std::thread([&] { CountOnce(counters); }).join();
+	Check(counters.Shards() == 1 && Counted(counters, 1), "reset counters start over");
+}
+
+} // namespace
+
+int main()
+{
+	TestChurn();
+	TestCap();
+	if (failures) return 1;
+	puts("test-hitcounters: ok");
+	return 0;
+}
@@ -0,0 +1,218 @@
+// Checks the hook engine's length decoder and relocator against known byte sequences:
+// common x86 and x64 prologues, rel32 call and jmp, short and near jcc, RIP-relative
+// operands, near and out of rel32 reach relocation, and the prologues that must be refused.
+// Relocated code is decoded again and every branch must still reach its original target.
+//
+// Usage: test-hookengine
+// Build: cmake -S . -B build && cmake --build build --target test-hookengine
+
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#include "HookEngine.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-hookengine: %s\n", what);
+	++failures;
+}
+
+using bytes = std::vector<uint8_t>;
+
+struct lengthCase
+{
+	const char* name;
+	hook::Arch arch;
+	bytes code;
+	size_t length;
+	hook::insnKind kind;
+	bool ripRelative;
+};
+
+// Where a relocated branch goes, 0 if `code` at `addr` is no branch.
+// Understands what Relocate emits: rel8/rel32 branches and the absolute forms.
+uint64_t BranchTarget(const uint8_t* code, size_t avail, uint64_t addr, hook::Arch arch, size_t& length)
+{
+	hook::insn ins;
+	if (!hook::Decode(code, avail, arch, ins)) return length = 0, 0;
+	length = ins.length;
+	if (ins.kind == hook::INSN_JMP || ins.kind == hook::INSN_CALL || ins.kind == hook::INSN_JCC)
+		return addr + ins.length + hook::detail::ReadRel(code + ins.relOffset, ins.relSize);
+	// jmp [rip+0] / call [rip+2] with the address inline
+	if (arch == hook::Arch::x64 && ins.ripRelative && ins.length == 6 && code[0] == 0xFF && (code[1] == 0x25 || code[1] == 0x15))
+	{
+		int32_t disp;
+		memcpy(&disp, code + 2, 4);
+		uint64_t target;
+		memcpy(&target, code + 6 + disp, 8);
+		return target;
+	}
+	return 0;
+}
+
+void TestLengths()
+{
+	using hook::Arch;
+	const lengthCase cases[] = {
+		{ "mov edi, edi", Arch::x86, { 0x8B, 0xFF }, 2, hook::INSN_PLAIN, false },
+		{ "push ebp", Arch::x86, { 0x55 }, 1, hook::INSN_PLAIN, false },
+		{ "mov ebp, esp", Arch::x86, { 0x8B, 0xEC }, 2, hook::INSN_PLAIN, false },
+		{ "sub esp, imm32", Arch::x86, { 0x81, 0xEC, 0x00, 0x01, 0x00, 0x00 }, 6, hook::INSN_PLAIN, false },
+		{ "mov ax, imm16", Arch::x86, { 0x66, 0xB8, 0x34, 0x12 }, 4, hook::INSN_PLAIN, false },
+		{ "mov eax, [moffs32]", Arch::x86, { 0xA1, 1, 2, 3, 4 }, 5, hook::INSN_PLAIN, false },
+		{ "mov [ebp-8], eax", Arch::x86, { 0x89, 0x45, 0xF8 }, 3, hook::INSN_PLAIN, false },
+		{ "mov eax, [esp+4]", Arch::x86, { 0x8B, 0x44, 0x24, 0x04 }, 4, hook::INSN_PLAIN, false },
+		{ "x86 mov eax, [disp32] is absolute", Arch::x86, { 0x8B, 0x05, 1, 2, 3, 4 }, 6, hook::INSN_PLAIN, false },
+		{ "mov [rsp+8], rbx", Arch::x64, { 0x48, 0x89, 0x5C, 0x24, 0x08 }, 5, hook::INSN_PLAIN, false },
+		{ "push rbx (REX)", Arch::x64, { 0x40, 0x53 }, 2, hook::INSN_PLAIN, false },
+		{ "sub rsp, 20h", Arch::x64, { 0x48, 0x83, 0xEC, 0x20 }, 4, hook::INSN_PLAIN, false },
+		{ "mov r11, rsp", Arch::x64, { 0x4C, 0x8B, 0xDC }, 3, hook::INSN_PLAIN, false },
+		{ "mov rax, imm64", Arch::x64, { 0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8 }, 10, hook::INSN_PLAIN, false },
+		{ "mov eax, [moffs64]", Arch::x64, { 0xA1, 1, 2, 3, 4, 5, 6, 7, 8 }, 9, hook::INSN_PLAIN, false },
+		{ "mov rax, [rip+disp]", Arch::x64, { 0x48, 0x8B, 0x05, 0x10, 0, 0, 0 }, 7, hook::INSN_PLAIN, true },
+		{ "cmp byte [rip+disp], imm8", Arch::x64, { 0x80, 0x3D, 0x10, 0, 0, 0, 0x01 }, 7, hook::INSN_PLAIN, true },
+		{ "lea rcx, [rip+disp]", Arch::x64, { 0x48, 0x8D, 0x0D, 0x10, 0, 0, 0 }, 7, hook::INSN_PLAIN, true },
+		{ "jmp [rip+disp]", Arch::x64, { 0xFF, 0x25, 0, 0, 0, 0 }, 6, hook::INSN_PLAIN, true },
+		{ "nop dword [rax+rax]", Arch::x64, { 0x0F, 0x1F, 0x44, 0x00, 0x00 }, 5, hook::INSN_PLAIN, false },
+		{ "xchg ax, ax", Arch::x64, { 0x66, 0x90 }, 2, hook::INSN_PLAIN, false },
+		{ "test ecx, imm32", Arch::x64, { 0xF7, 0xC1, 1, 2, 3, 4 }, 6, hook::INSN_PLAIN, false },
+		{ "call rel32", Arch::x64, { 0xE8, 0x10, 0, 0, 0 }, 5, hook::INSN_CALL, false },
+		{ "jmp rel32", Arch::x64, { 0xE9, 0x10, 0, 0, 0 }, 5, hook::INSN_JMP, false },
+		{ "jmp rel8", Arch::x64, { 0xEB, 0x10 }, 2, hook::INSN_JMP, false },
+		{ "jz rel8", Arch::x64, { 0x74, 0x05 }, 2, hook::INSN_JCC, false },
+		{ "jnz rel32", Arch::x64, { 0x0F, 0x85, 0x10, 0, 0, 0 }, 6, hook::INSN_JCC, false },
+		{ "x86 jz rel32", Arch::x86, { 0x0F, 0x84, 0x10, 0, 0, 0 }, 6, hook::INSN_JCC, false },
+		{ "loop rel8", Arch::x86, { 0xE2, 0xFE }, 2, hook::INSN_LOOP, false },
+		{ "ret", Arch::x64, { 0xC3 }, 1, hook::INSN_RET, false },
+		{ "ret imm16", Arch::x86, { 0xC2, 0x08, 0x00 }, 3, hook::INSN_RET, false },
+		{ "vzeroupper", Arch::x64, { 0xC5, 0xF8, 0x77 }, 3, hook::INSN_PLAIN, false },
+		{ "vmovdqu ymm0, [rcx]", Arch::x64, { 0xC5, 0xFE, 0x6F, 0x01 }, 4, hook::INSN_PLAIN, false },
+	};
+	for (auto& c : cases)
+	{
+		hook::insn ins;
+		bool ok = hook::Decode(c.code.data(), c.code.size(), c.arch, ins);
+		if (!ok || ins.length != c.length || ins.kind != c.kind || ins.ripRelative != c.ripRelative)
+		{
+			fprintf(stderr, "test-hookengine: %s decoded as length %d kind %d rip %d\n", c.name, ok ? ins.length : -1, ins.kind, ins.ripRelative);
+			++failures;
+		}
+		// one byte short is truncated, never a shorter instruction
+		Check(!hook::Decode(c.code.data(), c.code.size() - 1, c.arch, ins) || c.code.size() == 1, c.name);
+	}
+
+	hook::insn ins;
+	const uint8_t invalid64[] = { 0x06 }; // push es
+	Check(!hook::Decode(invalid64, 1, Arch::x64, ins), "push es is invalid in long mode");
+	const uint8_t prefixes[] = { 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x90 };
+	Check(!hook::Decode(prefixes, sizeof(prefixes), Arch::x64, ins), "an instruction longer than 15 bytes");
+}
+
+// Relocates `code` from `src` to `dst`, then decodes the result and collects the branch targets
+bool Relocated(const bytes& code, uint64_t src, uint64_t dst, hook::Arch arch, bytes& out, size_t& covered, std::vector<uint64_t>& targets)
+{
+	if (!hook::Relocate(code.data(), code.size(), src, hook::PATCH_SIZE, dst, arch, out, covered)) return false;
+	targets.clear();
+	for (size_t at = 0; at < out.size();)
+	{
+		size_t len;
+		uint64_t t = BranchTarget(out.data() + at, out.size() - at, dst + at, arch, len);
+		if (!len) break;
+		if (t) targets.push_back(t);
+		// the absolute forms carry their address inline
+		if (arch == hook::Arch::x64 && len == 6 && out[at] == 0xFF && out[at + 1] == 0x25) len += 8;
+		if (arch == hook::Arch::x64 && len == 6 && out[at] == 0xFF && out[at + 1] == 0x15) len += 10;
+		at += len;
+	}
+	return true;
+}
+
+void TestRelocation()
+{
+	using hook::Arch;
+	const uint64_t src = 0x7FF812340000;
+	const uint64_t nearDst = src + 0x10000000;
+	const uint64_t farDst = src + 0x200000000; // out of rel32 reach
+	bytes out;
+	size_t covered;
+	std::vector<uint64_t> targets;
+
+	// plain prologue is copied as is
+	bytes prologue = { 0x48, 0x89, 0x5C, 0x24, 0x08, 0x57, 0x48, 0x83, 0xEC, 0x20 };
+	Check(Relocated(prologue, src, farDst, Arch::x64, out, covered, targets) && covered == 5 && out == bytes(prologue.begin(), prologue.begin() + 5),
+		"plain prologue");
+
+	// call rel32 first: the call must still reach src + 5 + 0x100
+	bytes call = { 0xE8, 0x00, 0x01, 0x00, 0x00, 0x90 };
+	Check(Relocated(call, src, nearDst, Arch::x64, out, covered, targets) && out.size() == 5 && out[0] == 0xE8 &&
+		targets == std::vector<uint64_t>{ src + 0x105 }, "near call rel32");
+	Check(Relocated(call, src, farDst, Arch::x64, out, covered, targets) && out.size() == 16 && out[0] == 0xFF && out[1] == 0x15 &&
+		targets == std::vector<uint64_t>{ src + 0x105 }, "far call becomes call [rip]");
+
+	// short jcc is widened near and becomes an inverted jcc over the 14 byte jump far away
+	bytes jcc = { 0x74, 0x20, 0x48, 0x83, 0xEC, 0x20 };
+	Check(Relocated(jcc, src, nearDst, Arch::x64, out, covered, targets) && covered == 6 && out[0] == 0x0F && out[1] == 0x84 &&
+		targets == std::vector<uint64_t>{ src + 0x22 }, "near jz rel8 widened");
+	Check(Relocated(jcc, src, farDst, Arch::x64, out, covered, targets) && out.size() == 16 + 4 && out[0] == 0x75 && out[1] == 14 &&
+		out[2] == 0xFF && out[3] == 0x25 && targets.size() == 2 && targets[1] == src + 0x22, "far jz over an absolute jump");
+	// the inverted jcc must land right behind the absolute jump, where the next instruction is
+	if (out.size() > 16) Check(targets[0] == farDst + 16 && out[16] == 0x48, "far jz skip distance");
+
+	// a jcc whose rel32 just misses while a jmp rel32 one byte further would reach
+	bytes jccNear = { 0x0F, 0x85, 0x00, 0x00, 0x00, 0x00 };
+	const uint64_t edge = src + 6 - 6 - 0x80000000ull;
+	Check(Relocated(jccNear, src, edge, Arch::x64, out, covered, targets) && out.size() == 16 && out[1] == 14 &&
+		targets.size() == 2 && targets[0] == edge + 16 && targets[1] == src + 6, "jcc at the edge of rel32 reach");
+
+	// RIP-relative operands get a new displacement, or refuse out of reach
+	bytes rip = { 0x48, 0x8B, 0x05, 0x00, 0x10, 0x00, 0x00 };
+	if (Relocated(rip, src, nearDst, Arch::x64, out, covered, targets) && out.size() == 7)
+	{
+		int32_t disp;
+		memcpy(&disp, out.data() + 3, 4);
+		Check(nearDst + 7 + disp == src + 7 + 0x1000, "RIP-relative displacement adjusted");
+	}
+	else
+	{
+		Check(false, "RIP-relative near");
+	}
+	Check(!Relocated(rip, src, farDst, Arch::x64, out, covered, targets), "RIP-relative out of reach is refused");
+
+	// jmp rel32 relocates to a jump to the same place, anything behind it is not reached
+	bytes jmp = { 0xE9, 0x00, 0x02, 0x00, 0x00 };
+	Check(Relocated(jmp, src, farDst, Arch::x64, out, covered, targets) && targets == std::vector<uint64_t>{ src + 0x205 }, "far jmp rel32");
+
+	// refused: a jump before the patch is covered, a function shorter than the patch, a branch into the moved bytes
+	Check(!Relocated({ 0xEB, 0x10, 0x90, 0x90, 0x90, 0x90 }, src, nearDst, Arch::x64, out, covered, targets), "jmp rel8 inside the patch");
+	Check(!Relocated({ 0x31, 0xC0, 0xC3, 0xCC, 0xCC, 0xCC }, src, nearDst, Arch::x64, out, covered, targets), "function shorter than the patch");
+	Check(!Relocated({ 0x74, 0x01, 0x90, 0x90, 0x90, 0x90, 0x90 }, src, nearDst, Arch::x64, out, covered, targets), "branch into the moved bytes");
+	Check(!Relocated({ 0xE2, 0x10, 0x90, 0x90, 0x90 }, src, nearDst, Arch::x86, out, covered, targets), "loop can not be widened");
+
+	// x86: hot patch prologue and a relative call, no absolute forms
+	bytes x86 = { 0x8B, 0xFF, 0x55, 0x8B, 0xEC, 0x51 };
+	Check(Relocated(x86, 0x75000000, 0x10000000, Arch::x86, out, covered, targets) && covered == 5, "x86 prologue");
+	Check(Relocated({ 0xE8, 0x10, 0, 0, 0 }, 0x75000000, 0x10000000, Arch::x86, out, covered, targets) &&
+		targets == std::vector<uint64_t>{ 0x75000015 }, "x86 call rel32");
+
+	// the trampoline jumps back behind the covered bytes
+	bytes tramp;
+	Check(hook::BuildTrampoline(prologue.data(), prologue.size(), src, farDst, Arch::x64, tramp, covered) && tramp.size() == 5 + 14 &&
+		BranchTarget(tramp.data() + 5, 14, farDst + 5, Arch::x64, covered) == src + 5, "trampoline jumps back");
+}
+
+} // namespace
+
+int main()
+{
+	TestLengths();
+	TestRelocation();
+	if (failures) return 1;
+	puts("test-hookengine: ok");
+	return 0;
+}
@@ -0,0 +1,226 @@
+// Checks that every CreateFont API rewrites a font exactly once against a stub GDI laid out like
+// Windows 10: gdi32full implements CreateFontA/W, CreateFontIndirectA/W and CreateFontIndirectExA
+// on top of its own CreateFontIndirectExW, and gdi32's CreateFontIndirectExW is a stub jumping
+// there or an export forwarded to it. The hooks wrap hookpath::Call like MyCreateFontIndirectExW,
+// each guarded by hookpath::Reentry, and are installed the way InstallHooks installs them.
+//
+// Usage: test-hookpath
+// Build: cmake -S . -B build && cmake --build build --target test-hookpath
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HookPath.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-hookpath: %s\n", what);
+	++failures;
+}
+
+using CreateFn = size_t (*)(const LOGFONTW*);
+
+std::mutex createdLock;
+std::vector<std::wstring> created; // face of every font GDI created, its handle is the index + 1
+
+size_t RealCreateFontIndirectExW(const LOGFONTW* lf)
+{
+	std::lock_guard<std::mutex> hold(createdLock);
+	created.push_back(lf->lfFaceName);
+	return created.size();
+}
+
+// An inline hook patches a function's entry, so it is seen by every caller, gdi32full's own included
+CreateFn fullEntry = RealCreateFontIndirectExW;
+size_t Gdi32Stub(const LOGFONTW* lf) { return fullEntry(lf); }
+CreateFn gdi32Entry = Gdi32Stub;
+
+// What applications call
+size_t CreateFontIndirectExW(const LOGFONTW* lf) { return gdi32Entry(lf); }
+size_t CreateFontIndirectW(const LOGFONTW* lf) { return fullEntry(lf); }
+
+LOGFONTW Font(const wchar_t* face)
+{
+	LOGFONTW lf = {};
+	lf.lfHeight = -12;
+	wcsncpy(lf.lfFaceName, face, LF_FACESIZE - 1);
+	return lf;
+}
+
+size_t CreateFontW(int height, const wchar_t* face)
+{
+	LOGFONTW lf = Font(face);
+	lf.lfHeight = height;
+	return fullEntry(&lf);
+}
+
+// A names are widened before CreateFontIndirectExW, ASCII is enough here
+std::wstring Widen(const char* s)
+{
+	return std::wstring(s, s + strlen(s));
+}
+
+size_t CreateFontA(int height, const char* face) { return CreateFontW(height, Widen(face).c_str()); }
+size_t CreateFontIndirectA(const char* face) { LOGFONTW lf = Font(Widen(face).c_str()); return fullEntry(&lf); }
+size_t CreateFontIndirectExA(const char* face) { LOGFONTW lf = Font(Widen(face).c_str()); return fullEntry(&lf); }
+
+// The rule: Tahoma becomes Segoe UI and Segoe UI becomes Tahoma, a font rewritten twice keeps its face
+std::atomic<size_t> rewrites{ 0 };
+
+bool Rewrite(LOGFONTW& lf)
+{
+	++rewrites;
+	std::wstring face = lf.lfFaceName;
+	const wchar_t* to = face == L"Tahoma" ? L"Segoe UI" : face == L"Segoe UI" ? L"Tahoma" : nullptr;
+	if (!to) return false;
+	wcsncpy(lf.lfFaceName, to, LF_FACESIZE - 1);
+	return true;
+}
+
+std::unique_ptr<stats::instance> procStats;
+std::atomic<logsink::MappedLog*> noLog{ nullptr };
+introspect::LatencyHistogram rewriteLatency, createLatency;
+CreateFn origGdi32 = nullptr, origFull = nullptr;
+
+template <bool Full>
+size_t Hook(const LOGFONTW* lf)
+{
+	const auto orig = Full ? origFull : origGdi32;
+	hookpath::Reentry reentry;
+	if (reentry.Nested()) return orig(lf);
+	const hookpath::shared s = { procStats.get(), &noLog, &rewriteLatency, &createLatency, nullptr };
+	return hookpath::Call<false, true, false, false>(s, *lf, nullptr, 0, Rewrite, [orig](const LOGFONTW& l, bool) { return orig(&l); });
+}
+
+// `forwarded`: gdi32's export resolves to gdi32full's function, InstallHooks then hooks it once
+void Install(bool gdi32, bool full, bool forwarded)
+{
+	fullEntry = RealCreateFontIndirectExW;
+	gdi32Entry = forwarded ? nullptr : Gdi32Stub;
+	created.clear();
+	rewrites = 0;
+	procStats = std::make_unique<stats::instance>();
+	if (gdi32 && !forwarded)
+	{
+		origGdi32 = gdi32Entry;
+		gdi32Entry = Hook<false>;
+	}
+	if (full)
+	{
+		origFull = fullEntry;
+		fullEntry = Hook<true>;
+	}
+	if (forwarded) gdi32Entry = [](const LOGFONTW* lf) { return fullEntry(lf); };
+}
+
+struct api
+{
+	const char* name;
+	size_t (*call)();
+};
+
+const api apis[] = {
+	{ "CreateFontA", [] { return CreateFontA(-12, "Tahoma"); } },
+	{ "CreateFontW", [] { return CreateFontW(-12, L"Tahoma"); } },
+	{ "CreateFontIndirectA", [] { return CreateFontIndirectA("Tahoma"); } },
+	{ "CreateFontIndirectW", [] { LOGFONTW lf = Font(L"Tahoma"); return CreateFontIndirectW(&lf); } },
+	{ "CreateFontIndirectExA", [] { return CreateFontIndirectExA("Tahoma"); } },
+	{ "CreateFontIndirectExW", [] { LOGFONTW lf = Font(L"Tahoma"); return CreateFontIndirectExW(&lf); } },
+};
+
+// Every API once, each must be rewritten exactly once and create the rewritten face
+void CheckEveryApi(const char* layout)
+{
+	for (auto& a : apis)
+	{
+		size_t before = rewrites;
+		size_t font = a.call();
+		bool once = rewrites == before + 1 && font == created.size() && created.back() == L"Segoe UI";
+		if (!once)
+			fprintf(stderr, "test-hookpath: %s, %s rewritten %zu times, created \"%ls\"\n", layout, a.name, rewrites - before, created.back().c_str());
+		Check(once, "one rewrite per call");
+	}
+	Check(procStats->ruleHits == std::size(apis) && procStats->fontsCreated == std::size(apis), "hits and fonts counted once");
+}
+
+void TestGdi32Only()
+{
+	// what hooking gdi32 alone did: the APIs inside gdi32full never reach the hook
+	Install(true, false, false);
+	Check(CreateFontW(-12, L"Tahoma") && rewrites == 0 && created.back() == L"Tahoma", "gdi32 hook alone misses CreateFontW");
+	LOGFONTW lf = Font(L"Tahoma");
+	Check(CreateFontIndirectExW(&lf) && rewrites == 1 && created.back() == L"Segoe UI", "gdi32 hook alone sees its own export");
+}
+
+void TestBoth()
+{
+	Install(true, true, false);
+	CheckEveryApi("gdi32 stub into gdi32full");
+	Install(true, true, true);
+	CheckEveryApi("gdi32 forwarded to gdi32full");
+	// before Windows 10 gdi32 implements every API itself, the one module hooked is the implementing one
+	Install(false, true, false);
+	CheckEveryApi("one module");
+}
+
+// CreateFontUnhooked: FontMod's own fonts pass both hooks unchanged
+void TestBypass()
+{
+	Install(true, true, false);
+	{
+		hookpath::Reentry bypass;
+		LOGFONTW lf = Font(L"Tahoma");
+		CreateFontIndirectExW(&lf);
+		CreateFontIndirectW(&lf);
+	}
+	Check(rewrites == 0 && created.size() == 2 && created[0] == L"Tahoma" && created[1] == L"Tahoma", "bypass creates the font as it is");
+	LOGFONTW lf = Font(L"Tahoma");
+	Check(CreateFontIndirectExW(&lf) && rewrites == 1 && created.back() == L"Segoe UI", "hooks active again after the bypass");
+}
+
+// The guard is per thread: threads creating fonts at once do not pass each other's fonts on
+void TestThreads()
+{
+	Install(true, true, false);
+	const size_t threads = 4, calls = 2000;
+	std::vector<std::thread> pool;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		pool.emplace_back([t] {
+			for (size_t i = 0; i < calls; ++i)
+				apis[(t + i) % std::size(apis)].call();
+		});
+	}
+	for (auto& th : pool)
+		th.join();
+	size_t rewritten = 0;
+	for (auto& face : created)
+		rewritten += face == L"Segoe UI";
+	Check(rewrites == threads * calls && rewritten == threads * calls, "one rewrite per call from several threads");
+}
+
+} // namespace
+
+int main()
+{
+	TestGdi32Only();
+	TestBoth();
+	TestBypass();
+	TestThreads();
+	if (failures) return 1;
+	puts("test-hookpath: ok");
+	return 0;
+}
@@ -0,0 +1,125 @@
+// Checks the Unix socket standing in for the introspection pipe: the socket is private to the
+// user, requests split across or packed into writes get one reply each, a client counts as
+// attached while connected, and Stop returns with a client still connected and removes the socket.
+//
+// Usage: test-introspect
+// Build: cmake -S . -B build && cmake --build build --target test-introspect
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include "Introspect.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-introspect: %s\n", what);
+	++failures;
+}
+
+int Connect(const char* path)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+	if (fd >= 0) close(fd);
+	return -1;
+}
+
+void Send(int fd, const std::string& s)
+{
+	(void)!write(fd, s.data(), s.size());
+}
+
+// Reads until `replies` replies, each ending with an empty line, came in or the endpoint hung up
+std::string Receive(int fd, int replies)
+{
+	std::string in;
+	char buf[256];
+	auto count = [&in] {
+		int n = 0;
+		for (size_t at = 0; (at = in.find("\n\n", at)) != std::string::npos; at += 2) ++n;
+		return n;
+	};
+	while (count() < replies)
+	{
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n <= 0) break;
+		in.append(buf, n);
+	}
+	return in;
+}
+
+template <typename Pred>
+bool WaitFor(Pred pred)
+{
+	for (int i = 0; i < 500 && !pred(); ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	return pred();
+}
+
+} // namespace
+
+int main()
+{
+	introspect::Endpoint endpoint;
+	endpoint.On("ping", [](const std::string&) { return std::string("pong\n"); });
+	endpoint.On("echo", [](const std::string& args) { return args + "\n"; });
+	if (!endpoint.Start())
+	{
+		fprintf(stderr, "test-introspect: can not start the endpoint\n");
+		return 1;
+	}
+
+	struct stat st;
+	Check(stat(endpoint.Name(), &st) == 0 && S_ISSOCK(st.st_mode) && (st.st_mode & 0777) == 0600, "socket is private to the user");
+	Check(!introspect::Attached(), "attached before a client connected");
+
+	int fd = Connect(endpoint.Name());
+	Check(fd >= 0, "connect");
+	Send(fd, "ping\n");
+	Check(Receive(fd, 1) == "pong\n\n", "ping");
+	Check(introspect::Attached(), "client counts as attached");
+
+	// several requests in one write, one request over several, CRLF and empty lines
+	Send(fd, "echo a b\r\n\nping\nec");
+	Send(fd, "ho c\n");
+	Check(Receive(fd, 3) == "a b\n\npong\n\nc\n\n", "packed and split requests");
+	Send(fd, "what\n");
+	Check(Receive(fd, 1) == "unknown command, one of: echo ping\n\n", "unknown command");
+
+	close(fd);
+	Check(WaitFor([] { return !introspect::Attached(); }), "client still attached after closing");
+
+	// a second client after the first left, then Stop while it is connected
+	fd = Connect(endpoint.Name());
+	Send(fd, "ping\n");
+	Check(Receive(fd, 1) == "pong\n\n", "second client");
+	endpoint.Stop();
+	Check(Receive(fd, 1).empty(), "connected client dropped by Stop");
+	close(fd);
+	Check(!introspect::Attached(), "attached after Stop");
+	Check(stat(endpoint.Name(), &st) != 0, "socket removed by Stop");
+	Check(Connect(endpoint.Name()) < 0, "connect after Stop");
+
+	// and it starts again
+	Check(endpoint.Start(), "start after Stop");
+	fd = Connect(endpoint.Name());
+	Send(fd, "ping\n");
+	Check(Receive(fd, 1) == "pong\n\n", "ping after restart");
+	close(fd);
+	endpoint.Stop();
+
+	if (failures) return 1;
+	puts("test-introspect: ok");
+	return 0;
+}
@@ -0,0 +1,116 @@
+// Checks how fonts.pack entries are installed on first use: the entries of a family are installed
+// once, whatever case it is asked for in, faces not in the pack install nothing, and a thread asking
+// for a family another one is installing returns only after the fonts are in place.
+//
+// Usage: test-lazyfamilies
+// Build: cmake -S . -B build && cmake --build build --target test-lazyfamilies
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FontPack.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-lazyfamilies: %s\n", what);
+	++failures;
+}
+
+// An index like the one of a pack with a regular, bold and italic face of one family
+void Fill(pack::LazyFamilies& families)
+{
+	families.Add(L"Noto Sans SC", 0);
+	families.Add(L"Noto Sans SC", 1);
+	families.Add(L"Source Han Serif", 2);
+	families.Add(L"noto sans sc", 3);
+	families.Seal();
+}
+
+void TestOnce()
+{
+	pack::LazyFamilies empty;
+	empty.Seal();
+	Check(!empty.Pending() && empty.Install(L"Arial", [](size_t) {}) == 0, "an empty index has nothing pending");
+
+	pack::LazyFamilies families;
+	Fill(families);
+	Check(families.Pending() && families.Size() == 2, "two families pending");
+
+	std::vector<size_t> installed;
+	auto install = [&](size_t i) { installed.push_back(i); };
+	Check(families.Install(L"Arial", install) == 0 && installed.empty(), "a family the pack does not have");
+	Check(families.Install(L"Noto Sans", install) == 0 && families.Install(L"Noto Sans SC Bold", install) == 0 && installed.empty(),
+		"a prefix or a longer name is another family");
+	Check(families.Install(L"NOTO SANS SC", install) == 3, "every entry of the family");
+	Check(installed == std::vector<size_t>({ 0, 1, 3 }), "entries installed in pack order");
+	Check(families.Install(L"Noto Sans SC", install) == 0 && installed.size() == 3, "installed once");
+	Check(families.Pending(), "the other family still pending");
+
+	auto names = families.PendingNames();
+	Check(names.size() == 1 && names[0] == L"Source Han Serif", "pending names as the pack spells them");
+	Check(families.Install(L"source han serif", install) == 1 && !families.Pending(), "nothing pending once all are installed");
+	Check(families.PendingNames().empty() && installed.size() == 4, "no names left");
+}
+
+// The second thread asks while the first is inside install, it must not see the family as done before
+void TestWait()
+{
+	pack::LazyFamilies families;
+	Fill(families);
+	std::atomic<int> inside{ 0 }, done{ 0 };
+	std::atomic<bool> entered{ false };
+	auto slow = [&](size_t) {
+		++inside;
+		entered = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		++done;
+	};
+
+	std::thread first([&] { families.Install(L"Noto Sans SC", slow); });
+	while (!entered) std::this_thread::yield();
+	size_t second = families.Install(L"noto sans sc", slow);
+	Check(second == 0 && done == 3, "a waiting caller returns after the fonts are installed");
+	first.join();
+	Check(inside == 3, "a family installed by one thread only");
+
+	// callers from many threads, faces outside the pack among them, every entry exactly once
+	pack::LazyFamilies many;
+	for (size_t i = 0; i < 64; ++i)
+		many.Add(L"Family " + std::to_wstring(i % 8), i);
+	many.Seal();
+	std::vector<std::atomic<int>> counts(64);
+	std::vector<std::thread> pool;
+	for (int t = 0; t < 8; ++t)
+	{
+		pool.emplace_back([&, t] {
+			for (int i = 0; i < 16; ++i)
+				many.Install((i % 2 ? L"FAMILY " : L"Other ") + std::to_wstring((t + i) % 8), [&](size_t e) { ++counts[e]; });
+		});
+	}
+	for (auto& th : pool)
+		th.join();
+	bool once = true;
+	for (auto& c : counts)
+		once = once && c == 1;
+	Check(once && !many.Pending(), "every entry installed exactly once across threads");
+}
+
+} // namespace
+
+int main()
+{
+	TestOnce();
+	TestWait();
+	if (failures) return 1;
+	puts("test-lazyfamilies: ok");
+	return 0;
+}
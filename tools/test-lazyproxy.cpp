@@ -0,0 +1,133 @@
+// Checks the lazily resolved proxy slots: a slot keeps pointing at the resolver until its first
+// call, the DLL is opened once however many threads race on it, and an export the DLL lacks, or
+// every export of a DLL that did not load, resolves to the `missing` stub instead of nullptr.
+// The same table is then run against dlopen on the C library.
+//
+// Usage: test-lazyproxy
+// Build: cmake -S . -B build && cmake --build build --target test-lazyproxy
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "orig_winmm/LazyProxy.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-lazyproxy: %s\n", what);
+	++failures;
+}
+
+int resolver, missing, first, ordinal; // only their addresses matter
+
+// Knows "stub.dll" with `first` by name and `ordinal` at ordinal 3
+struct StubLoader
+{
+	static std::atomic<int> opens, finds;
+
+	static void* Open(const char* dllName)
+	{
+		++opens;
+		return strcmp(dllName, "stub.dll") == 0 ? &opens : nullptr;
+	}
+
+	static void* Find(void*, const proxy::symbol& sym)
+	{
+		++finds;
+		if (!sym.name) return sym.ordinal == 3 ? &ordinal : nullptr;
+		return strcmp(sym.name, "first") == 0 ? &first : nullptr;
+	}
+};
+
+std::atomic<int> StubLoader::opens, StubLoader::finds;
+
+const proxy::symbol symbols[4] = { { "first", 1 }, { "absent", 2 }, { nullptr, 3 }, { nullptr, 4 } };
+
+void TestStub()
+{
+	StubLoader::opens = StubLoader::finds = 0;
+	std::atomic<void*> slots[4];
+	proxy::LazyTable<4, StubLoader> table(slots, "stub.dll", symbols, &resolver, &missing);
+	Check(table.ResolvedCount() == 0 && slots[0].load() == &resolver, "slots start at the resolver");
+	Check(StubLoader::opens == 0, "the DLL is not opened before the first call");
+
+	Check(table.Resolve(&slots[0]) == &first && slots[0].load() == &first, "named export");
+	Check(table.Resolve(2) == &ordinal && table.IsResolved(2), "ordinal export");
+	Check(table.Resolve(1) == &missing && table.IsMissing(1), "absent export resolves to the stub");
+	Check(table.Resolve(3) == &missing, "absent ordinal resolves to the stub");
+	int finds = StubLoader::finds;
+	Check(table.Resolve(1) == &missing && table.Resolve(size_t(0)) == &first && StubLoader::finds == finds, "resolved slots are not looked up again");
+	Check(table.Resolve(4) == &missing, "index out of range");
+	Check(StubLoader::opens == 1 && table.ResolvedCount() == 4, "opened once");
+}
+
+void TestNotLoaded()
+{
+	StubLoader::opens = StubLoader::finds = 0;
+	std::atomic<void*> slots[4];
+	proxy::LazyTable<4, StubLoader> table(slots, "gone.dll", symbols, &resolver, &missing);
+	for (size_t i = 0; i < 4; ++i)
+		Check(table.Resolve(i) == &missing && table.IsMissing(i), "export of a DLL that did not load");
+	Check(StubLoader::opens == 1 && StubLoader::finds == 0, "a failed load is not retried");
+}
+
+void TestRace()
+{
+	StubLoader::opens = StubLoader::finds = 0;
+	std::atomic<void*> slots[4];
+	proxy::LazyTable<4, StubLoader> table(slots, "stub.dll", symbols, &resolver, &missing);
+	std::atomic<bool> wrong{ false };
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; ++t)
+	{
+		threads.emplace_back([&, t] {
+			for (size_t n = 0; n < 4; ++n)
+			{
+				size_t i = (n + t) % 4;
+				void* expected = i == 0 ? &first : i == 2 ? static_cast<void*>(&ordinal) : &missing;
+				if (table.Resolve(i) != expected) wrong = true;
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	Check(!wrong && StubLoader::opens == 1, "racing resolves");
+}
+
+void TestSystemLoader()
+{
+#ifdef __APPLE__
+	const char* libc = "libSystem.dylib";
+#else
+	const char* libc = "libc.so.6";
+#endif
+	const proxy::symbol libcSymbols[3] = { { "strlen", 1 }, { "no_such_function_here", 2 }, { nullptr, 3 } };
+	std::atomic<void*> slots[3];
+	proxy::LazyTable<3> table(slots, libc, libcSymbols, &resolver, &missing);
+	void* fn = table.Resolve(size_t(0));
+	Check(fn != &missing && table.Module() && reinterpret_cast<size_t (*)(const char*)>(fn)("winmm") == 5, "strlen through dlopen");
+	Check(table.Resolve(1) == &missing, "dlsym failure resolves to the stub");
+	Check(table.Resolve(2) == &missing, "ordinal without ELF ordinals resolves to the stub");
+
+	std::atomic<void*> none[3];
+	proxy::LazyTable<3> absent(none, "libfontmod-none.so", libcSymbols, &resolver, &missing);
+	Check(absent.Resolve(size_t(0)) == &missing && !absent.Module(), "dlopen failure resolves to the stub");
+}
+
+} // namespace
+
+int main()
+{
+	TestStub();
+	TestNotLoaded();
+	TestRace();
+	TestSystemLoader();
+	if (failures) return 1;
+	puts("test-lazyproxy: ok");
+	return 0;
+}
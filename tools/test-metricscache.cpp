@@ -0,0 +1,217 @@
+// Checks the metrics cache against a stub GDI that hands out font handles the way GDI does,
+// reusing a deleted font's handle for the next one. The hooks below wrap the stub like
+// MyGetTextMetricsW, MyGetCharWidth32W, MyGetCharABCWidthsW and MyDeleteObject wrap GDI:
+// a repeated query must be a hit, DeleteObject must drop the font, and a new font under the
+// reused handle must never see the old one's metrics, also when it is deleted mid-query.
+//
+// Usage: test-metricscache
+// Build: cmake -S . -B build && cmake --build build --target test-metricscache
+
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#include "MetricsCache.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-metricscache: %s\n", what);
+	++failures;
+}
+
+struct textMetrics
+{
+	int height, aveCharWidth;
+};
+
+struct abc
+{
+	int a;
+	unsigned b;
+	int c;
+};
+
+using handle = uintptr_t;
+
+// Fonts by handle, the lowest free handle is handed out first
+struct StubGdi
+{
+	std::map<handle, int> fonts; // handle -> point size
+	size_t calls = 0;
+
+	handle CreateFont(int size)
+	{
+		handle h = 0x100;
+		while (fonts.count(h)) h += 4;
+		fonts[h] = size;
+		return h;
+	}
+
+	bool DeleteObject(handle h) { return fonts.erase(h) != 0; }
+
+	bool GetTextMetrics(handle h, textMetrics& tm)
+	{
+		++calls;
+		auto it = fonts.find(h);
+		if (it == fonts.end()) return false;
+		tm = { it->second * 4 / 3, it->second / 2 };
+		return true;
+	}
+
+	bool GetCharWidth(handle h, uint32_t first, uint32_t last, int* out)
+	{
+		++calls;
+		auto it = fonts.find(h);
+		if (it == fonts.end()) return false;
+		for (uint32_t c = first; c <= last; ++c)
+			out[c - first] = it->second + static_cast<int>(c % 7);
+		return true;
+	}
+
+	bool GetCharABCWidths(handle h, uint32_t first, uint32_t last, abc* out)
+	{
+		++calls;
+		auto it = fonts.find(h);
+		if (it == fonts.end()) return false;
+		for (uint32_t c = first; c <= last; ++c)
+			out[c - first] = { 1, static_cast<unsigned>(it->second + c % 5), -1 };
+		return true;
+	}
+};
+
+// The hooks, `font` standing for the font selected into the DC
+struct Hooked
+{
+	StubGdi gdi;
+	metrics::MetricsCache<handle, textMetrics, abc> cache;
+
+	bool GetTextMetrics(handle font, textMetrics& tm)
+	{
+		return cache.TextMetricsFor(font, tm, [&](textMetrics& out) { return gdi.GetTextMetrics(font, out); });
+	}
+
+	bool GetCharWidth(handle font, uint32_t first, uint32_t last, int* out)
+	{
+		return cache.WidthsFor(font, first, last, out, [&](uint32_t from, uint32_t to, int* w) { return gdi.GetCharWidth(font, from, to, w); });
+	}
+
+	bool GetCharABCWidths(handle font, uint32_t first, uint32_t last, abc* out)
+	{
+		return cache.AbcWidthsFor(font, first, last, out, [&](uint32_t from, uint32_t to, abc* w) { return gdi.GetCharABCWidths(font, from, to, w); });
+	}
+
+	bool DeleteObject(handle font)
+	{
+		cache.Invalidate(font);
+		return gdi.DeleteObject(font);
+	}
+};
+
+void TestHits()
+{
+	Hooked h;
+	handle font = h.gdi.CreateFont(12);
+	textMetrics tm;
+	Check(h.GetTextMetrics(font, tm) && tm.height == 16 && h.gdi.calls == 1, "first GetTextMetrics asks GDI");
+	Check(h.GetTextMetrics(font, tm) && tm.height == 16 && h.gdi.calls == 1, "second GetTextMetrics is a hit");
+
+	std::vector<int> w(300);
+	Check(h.GetCharWidth(font, 'A', 'Z', w.data()) && w[0] == 12 + 'A' % 7 && h.gdi.calls == 2, "widths asked");
+	Check(h.GetCharWidth(font, 'C', 'F', w.data()) && w[0] == 12 + 'C' % 7 && h.gdi.calls == 2, "widths inside a known range are a hit");
+	Check(h.GetCharWidth(font, 'X', 'b', w.data()) && w[5] == 12 + ('X' + 5) % 7 && h.gdi.calls == 3,
+		"a range reaching past the known characters asks GDI");
+	// across a page boundary, then answered from both pages
+	Check(h.GetCharWidth(font, 0xF0, 0x110, w.data()) && h.gdi.calls == 4, "range across pages asked");
+	Check(h.GetCharWidth(font, 0xFA, 0x105, w.data()) && w[0] == 12 + 0xFA % 7 && w[11] == 12 + 0x105 % 7 && h.gdi.calls == 4,
+		"range across pages is a hit");
+
+	abc a[4];
+	Check(h.GetCharABCWidths(font, 'a', 'd', a) && a[3].b == 12u + 'd' % 5 && h.gdi.calls == 5, "ABC widths asked");
+	Check(h.GetCharABCWidths(font, 'b', 'c', a) && a[0].b == 12u + 'b' % 5 && h.gdi.calls == 5, "ABC widths are a hit");
+	// widths and ABC widths are kept apart
+	Check(h.GetCharABCWidths(font, 'A', 'B', a) && h.gdi.calls == 6, "ABC widths not answered from widths");
+
+	Check(h.cache.Stats().hits.load() == 4 && h.cache.Stats().misses.load() == 6, "hit and miss counts");
+}
+
+void TestDeleteAndReuse()
+{
+	Hooked h;
+	handle small = h.gdi.CreateFont(10);
+	textMetrics tm;
+	int w[3];
+	h.GetTextMetrics(small, tm);
+	h.GetCharWidth(small, 'a', 'c', w);
+	Check(h.cache.Size() == 1, "font cached");
+
+	Check(h.DeleteObject(small) && h.cache.Size() == 0 && h.cache.Stats().invalidations.load() == 1, "DeleteObject drops the font");
+	handle large = h.gdi.CreateFont(30);
+	Check(large == small, "the stub reuses the handle");
+	size_t calls = h.gdi.calls;
+	Check(h.GetTextMetrics(large, tm) && tm.height == 40 && h.gdi.calls == calls + 1, "reused handle gets its own metrics");
+	Check(h.GetCharWidth(large, 'a', 'c', w) && w[0] == 30 + 'a' % 7 && h.gdi.calls == calls + 2, "reused handle gets its own widths");
+	Check(h.GetTextMetrics(large, tm) && tm.height == 40 && h.gdi.calls == calls + 2, "and is cached again");
+
+	// deleting an unknown or non cached handle changes nothing
+	Check(!h.DeleteObject(0x9999) && h.cache.Size() == 1, "deleting an unknown handle");
+}
+
+// The font is deleted and its handle reused while a query for it is at GDI:
+// the old font's answer may be returned to that caller but must not be stored
+void TestDeleteWhileFetching()
+{
+	Hooked h;
+	handle font = h.gdi.CreateFont(10);
+	textMetrics tm;
+	bool ok = h.cache.TextMetricsFor(font, tm, [&](textMetrics& out) {
+		bool r = h.gdi.GetTextMetrics(font, out);
+		h.DeleteObject(font);
+		h.gdi.CreateFont(30); // same handle
+		return r;
+	});
+	Check(ok && tm.height == 13, "caller gets the old answer");
+	Check(h.GetTextMetrics(font, tm) && tm.height == 40, "old metrics not stored under the reused handle");
+
+	handle other = h.gdi.CreateFont(20);
+	int w[2];
+	h.cache.WidthsFor(other, 'a', 'b', w, [&](uint32_t from, uint32_t to, int* out) {
+		bool r = h.gdi.GetCharWidth(other, from, to, out);
+		h.DeleteObject(other);
+		h.gdi.CreateFont(8);
+		return r;
+	});
+	Check(h.GetCharWidth(other, 'a', 'b', w) && w[0] == 8 + 'a' % 7, "old widths not stored under the reused handle");
+}
+
+void TestFailures()
+{
+	Hooked h;
+	textMetrics tm;
+	int w[2];
+	Check(!h.GetTextMetrics(0x100, tm) && h.cache.Size() == 0, "failed call is not cached");
+	handle font = h.gdi.CreateFont(10);
+	Check(h.GetTextMetrics(font, tm), "font created after a failure");
+	// invalid ranges go to GDI untouched
+	size_t calls = h.gdi.calls;
+	h.GetCharWidth(font, 'b', 'a', w);
+	h.GetCharWidth(font, 'b', 'a', w);
+	Check(h.gdi.calls == calls + 2, "invalid range is not cached");
+}
+
+} // namespace
+
+int main()
+{
+	TestHits();
+	TestDeleteAndReuse();
+	TestDeleteWhileFetching();
+	TestFailures();
+	if (failures) return 1;
+	puts("test-metricscache: ok");
+	return 0;
+}
@@ -0,0 +1,163 @@
+// Checks the startup step scheduler: every step starts after its dependencies ended, helpers
+// only ever run the steps added as concurrent, the last step is gated on all the others, and a
+// helper that starts late, or never, leaves the run serial on the calling thread instead of stuck.
+//
+// Usage: test-startupgraph
+// Build: cmake -S . -B build && cmake --build build --target test-startupgraph
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "StartupGraph.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-startupgraph: %s\n", what);
+	++failures;
+}
+
+void Sleep(int ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Every step after the ones it depends on
+bool Ordered(const startup::Graph& graph)
+{
+	for (startup::task_id i = 0; i < graph.Size(); ++i)
+	{
+		auto t = graph.At(i);
+		if (t.begin < 0) return false;
+		for (auto d : t.deps)
+		{
+			auto dep = graph.At(d);
+			if (t.begin < dep.begin + dep.duration) return false;
+		}
+	}
+	return true;
+}
+
+// The shape of DllMain's graph: two concurrent steps, the rest on the calling thread
+struct DllMainShape
+{
+	startup::Graph graph;
+	startup::task_id settings, scan, log, fonts, cache, chains, hooks;
+	std::atomic<int> ran{ 0 };
+
+	explicit DllMainShape(int slow)
+	{
+		auto step = [this](int ms) { return [this, ms] { Sleep(ms); ++ran; }; };
+		scan = graph.Add("ScanUserFonts", step(slow), {}, true);
+		settings = graph.Add("LoadSettings", step(slow), {}, true);
+		log = graph.Add("OpenLogFile", step(1), { settings });
+		fonts = graph.Add("RegisterUserFonts", step(1), { scan, log });
+		cache = graph.Add("LoadEnumCache", step(1), { fonts });
+		chains = graph.Add("ResolveChains", step(1), { settings, log, fonts });
+		hooks = graph.Add("InstallHooks", step(1), { settings, log, fonts, cache, chains });
+	}
+};
+
+void TestSerial()
+{
+	DllMainShape shape(5);
+	shape.graph.Run();
+	Check(shape.ran == 7, "every step ran");
+	Check(Ordered(shape.graph), "serial run keeps the order");
+	bool caller = true;
+	for (startup::task_id i = 0; i < shape.graph.Size(); ++i)
+		caller = caller && shape.graph.At(i).worker == 0;
+	Check(caller, "without helpers every step runs on the calling thread");
+
+	std::vector<startup::task_id> path;
+	int64_t critical = shape.graph.CriticalPath(&path);
+	Check(critical > 0 && critical <= shape.graph.Elapsed() && !path.empty() && path.back() == shape.hooks, "critical path ends at the last step");
+}
+
+void TestHelper()
+{
+	DllMainShape shape(50);
+	std::vector<std::thread> helpers;
+	shape.graph.Run([&](std::function<void()> work) { helpers.emplace_back(std::move(work)); }, 1);
+	for (auto& h : helpers)
+		h.join();
+	Check(shape.ran == 7, "every step ran once");
+	Check(Ordered(shape.graph), "steps wait for their dependencies across threads");
+	// whichever of them the helper took first, the caller takes the other
+	Check(shape.graph.At(shape.scan).worker + shape.graph.At(shape.settings).worker == 1, "the helper ran one concurrent step");
+	bool caller = true;
+	for (auto i : { shape.log, shape.fonts, shape.cache, shape.chains, shape.hooks })
+		caller = caller && shape.graph.At(i).worker == 0;
+	Check(caller, "steps not added as concurrent never run on a helper");
+
+	// the hooks go in last, after everything else ended
+	auto hooks = shape.graph.At(shape.hooks);
+	bool gated = true;
+	for (startup::task_id i = 0; i < shape.graph.Size(); ++i)
+	{
+		auto t = shape.graph.At(i);
+		gated = gated && (i == shape.hooks || t.begin + t.duration <= hooks.begin);
+	}
+	Check(gated, "the last step is gated on all the others");
+}
+
+// A caller-only step ready while the caller is busy is left for the caller, not taken by an idle helper
+void TestCallerOnly()
+{
+	startup::Graph graph;
+	std::atomic<bool> helperIdle{ false };
+	auto busy = graph.Add("busy", [&] {
+		for (int i = 0; i < 200 && !helperIdle; ++i) Sleep(1);
+		Sleep(20);
+	});
+	auto gdi = graph.Add("gdi", [] {});
+	std::vector<std::thread> helpers;
+	graph.Run([&](std::function<void()> work) {
+		helpers.emplace_back([&, work] {
+			helperIdle = true;
+			work();
+		});
+	}, 1);
+	for (auto& h : helpers)
+		h.join();
+	Check(graph.At(busy).worker == 0 && graph.At(gdi).worker == 0, "caller-only steps stay on the calling thread");
+}
+
+// Under the loader lock a new thread starts after DllMain returned, or not at all
+void TestLateHelper()
+{
+	std::vector<std::function<void()>> pending;
+	std::atomic<int> ran{ 0 };
+	{
+		startup::Graph graph;
+		int local = 0; // a step may use the caller's locals, gone once Run returned
+		auto a = graph.Add("a", [&] { ++ran; ++local; }, {}, true);
+		graph.Add("b", [&] { ++ran; ++local; }, { a }, true);
+		graph.Run([&](std::function<void()> work) { pending.push_back(std::move(work)); }, 2);
+		Check(ran == 2 && local == 2, "helpers that do not start leave the run serial");
+		Check(graph.At(a).worker == 0, "run on the calling thread");
+	}
+	for (auto& work : pending)
+		work();
+	Check(ran == 2, "a helper starting after Run returned finds nothing to do");
+}
+
+} // namespace
+
+int main()
+{
+	TestSerial();
+	TestHelper();
+	TestCallerOnly();
+	TestLateHelper();
+	if (failures) return 1;
+	puts("test-startupgraph: ok");
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Checks the shared stats segment through shm_open: a child process publishes counters in a
+// segment of its own name, and a second, read-only mapping opened the way fontmod-top opens
+// it must see the same layout, the child's slot and its values. A slot whose process exited
+// is claimed again, one still owned is not.
+//
+// Usage: test-statssegment
+// Build: cmake -S . -B build && cmake --build build --target test-statssegment
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+
+#include "Stats.hpp"
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "test-statssegment: %s\n", what);
+	++failures;
+}
+
+// The values the child writes, all different so a shifted field shows
+void Publish(stats::instance& inst)
+{
+	stats::Add(inst.hookCalls, 101);
+	stats::Add(inst.ruleHits, 102);
+	stats::Add(inst.ruleMisses, 103);
+	stats::Add(inst.fontsCreated, 104);
+	stats::Add(inst.userFonts, 105);
+	inst.initTimeUs.store(106, std::memory_order_relaxed);
+	inst.firstHitNs.store(107, std::memory_order_relaxed);
+	inst.prewarmUs.store(108, std::memory_order_relaxed);
+}
+
+bool Published(const stats::instance& inst)
+{
+	return inst.hookCalls.load() == 101 && inst.ruleHits.load() == 102 && inst.ruleMisses.load() == 103 &&
+		inst.fontsCreated.load() == 104 && inst.userFonts.load() == 105 && inst.initTimeUs.load() == 106 &&
+		inst.firstHitNs.load() == 107 && inst.prewarmUs.load() == 108 && inst.startTime.load() > 0 &&
+		strcmp(inst.exe, "test-statssegment") == 0;
+}
+
+// The live slots of `pid`, as fontmod-top lists them
+size_t Slots(const stats::segment& seg, uint32_t pid, const stats::instance** found)
+{
+	size_t n = 0;
+	for (auto& inst : seg.instances)
+	{
+		if (inst.pid.load(std::memory_order_acquire) != pid || !stats::ProcessAlive(pid)) continue;
+		if (found) *found = &inst;
+		++n;
+	}
+	return n;
+}
+
+} // namespace
+
+int main()
+{
+	std::string name = "/fontmod.test." + std::to_string(getpid());
+	shm_unlink(name.c_str());
+
+	int ready[2], quit[2];
+	if (pipe(ready) != 0 || pipe(quit) != 0)
+	{
+		fputs("test-statssegment: can not create pipes\n", stderr);
+		return 1;
+	}
+	pid_t child = fork();
+	if (child == 0)
+	{
+		// the DLL's side: create, claim a slot, count
+		stats::SharedSegment seg;
+		char ok = 0;
+		if (seg.Open(false, name.c_str()))
+		{
+			if (auto inst = seg.Claim(stats::CurrentPid(), "test-statssegment"))
+			{
+				Publish(*inst);
+				ok = 1;
+			}
+		}
+		char c;
+		if (write(ready[1], &ok, 1) != 1 || read(quit[0], &c, 1) < 0) _exit(2);
+		_exit(0); // the slot is left claimed, as by a process that crashed
+	}
+
+	char ok = 0;
+	Check(child > 0 && read(ready[0], &ok, 1) == 1 && ok == 1, "child published its counters");
+
+	// fontmod-top's side
+	stats::SharedSegment reader;
+	Check(reader.Open(true, name.c_str()), "segment opened read-only");
+	Check(reader.Valid(), "layout understood");
+	auto* seg = reader.get();
+	Check(seg && seg->version == stats::SEGMENT_VERSION && seg->instanceSize == sizeof(stats::instance) &&
+		seg->maxInstances == stats::MAX_INSTANCES, "header as written");
+	const stats::instance* slot = nullptr;
+	Check(seg && Slots(*seg, static_cast<uint32_t>(child), &slot) == 1 && slot == &seg->instances[0], "child holds the first slot");
+	Check(slot && Published(*slot), "values read through the second mapping");
+
+	// a writer of its own in this process takes another slot while the child lives
+	stats::SharedSegment writer;
+	stats::instance* mine = writer.Open(false, name.c_str()) ? writer.Claim(stats::CurrentPid(), "parent") : nullptr;
+	Check(mine && mine != &writer.get()->instances[0], "an owned slot is not claimed");
+	Check(seg && Slots(*seg, stats::CurrentPid(), nullptr) == 1, "the reader sees the new slot");
+	stats::SharedSegment::Release(mine);
+	Check(seg && Slots(*seg, stats::CurrentPid(), nullptr) == 0, "a released slot is free");
+
+	// once the child is gone its slot is stale and claimed again, reset
+	char c = 0;
+	int status = 0;
+	Check(write(quit[1], &c, 1) == 1 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0, "child exited");
+	Check(seg && Slots(*seg, static_cast<uint32_t>(child), nullptr) == 0, "a dead process is not listed");
+	stats::instance* again = writer.Claim(stats::CurrentPid(), "parent");
+	Check(again == &writer.get()->instances[0] && again->hookCalls.load() == 0 && strcmp(again->exe, "parent") == 0,
+		"a dead process's slot is claimed and reset");
+	stats::SharedSegment::Release(again);
+
+	writer.Close();
+	reader.Close();
+	shm_unlink(name.c_str());
+	if (failures) return 1;
+	puts("test-statssegment: ok");
+	return 0;
+}